@@ -2,9 +2,12 @@
 
 #include <cstdint>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <memory>
 
 #include <memoc/allocators.h>
+#include <memoc/metrics.h>
 
 struct Test_data {
     std::vector<std::int64_t> allocation_sizes{};
@@ -53,6 +56,20 @@ void perform_allocations(Allocator* alloc, const Test_data& td) {
     }
 }
 
+// Runs f on each iteration, and fails the benchmark if an iteration allocated memory from the system.
+template <typename F>
+void run_without_allocations(benchmark::State& state, F&& f)
+{
+    for (auto _ : state) {
+        memoc::No_alloc_scope scope{};
+        f();
+        if (scope.allocations() != 0) {
+            state.SkipWithError("memory was allocated from the system in an iteration");
+            break;
+        }
+    }
+}
+
 static void BM_malloc_allocator(benchmark::State& state)
 {
     memoc::Malloc_allocator alloc{};
@@ -112,6 +129,39 @@ static void BM_free_list_allocator(benchmark::State& state)
 }
 BENCHMARK(BM_free_list_allocator);
 
+static void BM_runtime_free_list_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Runtime_free_list_allocator<Malloc_allocator> alloc{ { 16, 64, 64 } };
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK(BM_runtime_free_list_allocator);
+
+// Allocation sizes that shift between small and large ones
+template <class Allocator>
+static void BM_shifting_sizes(benchmark::State& state)
+{
+    Allocator alloc{};
+    auto small = test_data<16, 64, 64>();
+    auto large = test_data<1024, 4096, 64>();
+
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < 64; ++i) {
+            perform_allocations(&alloc, small);
+        }
+        for (std::int64_t i = 0; i < 64; ++i) {
+            perform_allocations(&alloc, large);
+        }
+    }
+}
+BENCHMARK_TEMPLATE(BM_shifting_sizes, memoc::Free_list_allocator<memoc::Malloc_allocator, 16, 64, 64>);
+BENCHMARK_TEMPLATE(BM_shifting_sizes, memoc::Adaptive_free_list_allocator<memoc::Malloc_allocator>);
+
 static void BM_hybrid_allocator(benchmark::State& state)
 {
     using namespace memoc;
@@ -127,6 +177,43 @@ static void BM_hybrid_allocator(benchmark::State& state)
 }
 BENCHMARK(BM_hybrid_allocator);
 
+// Allocations are too large for the stacks, so each one is resolved by the fourth level after probing the others.
+static void BM_nested_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Fallback_allocator<
+        Stack_allocator<memoc::details::Default_global_stack_memory<1, 8>>,
+        Fallback_allocator<
+            Stack_allocator<memoc::details::Default_global_stack_memory<2, 8>>,
+            Fallback_allocator<
+                Stack_allocator<memoc::details::Default_global_stack_memory<4, 8>>,
+                Free_list_allocator<Malloc_allocator, 16, 64, 64>>>> alloc{};
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK(BM_nested_allocator);
+
+static void BM_fallback_chain(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Fallback_chain<
+        Stack_allocator<memoc::details::Default_global_stack_memory<1, 8>>,
+        Stack_allocator<memoc::details::Default_global_stack_memory<2, 8>>,
+        Stack_allocator<memoc::details::Default_global_stack_memory<4, 8>>,
+        Free_list_allocator<Malloc_allocator, 16, 64, 64>> alloc{};
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK(BM_fallback_chain);
+
 template <class Allocator, typename T, std::int64_t Number_of_allocations>
 void perform_vector_allocations() {
     std::vector<T, Allocator> v{};
@@ -161,3 +248,234 @@ static void BM_stl_adapter_allocator(benchmark::State& state)
 }
 BENCHMARK(BM_stl_adapter_allocator);
 
+template <class Map, std::int64_t Number_of_elements>
+void perform_map_insertions(const typename Map::allocator_type& alloc) {
+    Map m{ alloc };
+    for (std::int64_t i = 0; i < Number_of_elements; ++i) {
+        m.emplace(static_cast<int>(i), static_cast<int>(i));
+    }
+    benchmark::DoNotOptimize(m);
+}
+
+template <template <typename> class Allocator>
+using Stl_map = std::map<int, int, std::less<int>, Allocator<std::pair<const int, int>>>;
+
+template <template <typename> class Allocator>
+using Stl_unordered_map = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Allocator<std::pair<const int, int>>>;
+
+template <typename T>
+using Free_list_stl_adapter = memoc::Stl_adapter_allocator<T, memoc::Free_list_allocator<memoc::Malloc_allocator, 16, 64, 1024>>;
+
+// The backend is shared by the container rebinds and kept across the iterations, so its free list is reused
+template <class Map>
+void BM_stl_map(benchmark::State& state)
+{
+    typename Map::allocator_type alloc{};
+
+    for (auto _ : state) {
+        perform_map_insertions<Map, 512>(alloc);
+    }
+}
+BENCHMARK_TEMPLATE(BM_stl_map, Stl_map<std::allocator>);
+BENCHMARK_TEMPLATE(BM_stl_map, Stl_map<Free_list_stl_adapter>);
+BENCHMARK_TEMPLATE(BM_stl_map, Stl_unordered_map<std::allocator>);
+BENCHMARK_TEMPLATE(BM_stl_map, Stl_unordered_map<Free_list_stl_adapter>);
+
+
+template <class Allocator, bool Warm_up, std::int64_t Warm_up_amount>
+void BM_first_allocations(benchmark::State& state)
+{
+    constexpr std::int64_t number_of_allocations = 10000;
+    constexpr memoc::Block<void>::Size_type allocation_size = 16;
+
+    std::vector<memoc::Block<void>> blocks(number_of_allocations);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            Allocator alloc{};
+            if constexpr (Warm_up) {
+                memoc::warm_up(alloc, Warm_up_amount);
+            }
+            state.ResumeTiming();
+
+            for (auto& b : blocks) {
+                b = alloc.allocate(allocation_size).value();
+                // First use of the memory is part of the startup cost.
+                *static_cast<std::uint8_t*>(b.data()) = 1;
+            }
+
+            state.PauseTiming();
+            for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+                alloc.deallocate(*it);
+            }
+        }
+        state.ResumeTiming();
+    }
+}
+
+using Startup_free_list_allocator = memoc::Free_list_allocator<memoc::Malloc_allocator, 16, 64, 10000>;
+BENCHMARK_TEMPLATE(BM_first_allocations, Startup_free_list_allocator, false, 0);
+BENCHMARK_TEMPLATE(BM_first_allocations, Startup_free_list_allocator, true, 10000);
+
+// Static stack memory is faulted in only once per process, hence a single iteration for each case.
+// Different buffer sizes are used so the cold and warm cases do not share memory.
+using Startup_cold_stack_allocator = memoc::Stack_allocator<memoc::details::Default_global_stack_memory<1, 10000 * 16>>;
+using Startup_warm_stack_allocator = memoc::Stack_allocator<memoc::details::Default_global_stack_memory<1, 10000 * 16 + 2>>;
+BENCHMARK_TEMPLATE(BM_first_allocations, Startup_cold_stack_allocator, false, 0)->Iterations(1);
+BENCHMARK_TEMPLATE(BM_first_allocations, Startup_warm_stack_allocator, true, 10000 * 16)->Iterations(1);
+
+// Interleaves long lived allocations with transient ones, which are released shortly after their allocation.
+// Long lived blocks pin the arena memory that follows them, so failed allocations indicate fragmentation.
+template <class Allocator>
+void BM_mixed_lifetimes(benchmark::State& state)
+{
+    constexpr std::int64_t number_of_allocations = 1024;
+    constexpr std::int64_t long_lived_period = 16;
+    constexpr std::int64_t transient_window = 4;
+    constexpr memoc::Block<void>::Size_type allocation_size = 64;
+    constexpr std::int64_t transient_site = 0;
+    [[maybe_unused]] constexpr std::int64_t long_lived_site = 1;
+
+    std::vector<memoc::Block<void>> long_lived{};
+    long_lived.reserve(number_of_allocations / long_lived_period);
+    memoc::Block<void> transients[transient_window]{};
+
+    Allocator alloc{};
+    std::int64_t failures = 0;
+
+    for (auto _ : state) {
+        for (std::int64_t i = 0; i < number_of_allocations; ++i) {
+            const bool is_long_lived = i % long_lived_period == 0;
+            memoc::Block<void>& transient = transients[i % transient_window];
+            if (!is_long_lived && !transient.empty()) {
+                alloc.deallocate(transient);
+            }
+
+            oc::Expected<memoc::Block<void>, memoc::Allocator_error> r = [&]() {
+                if constexpr (requires { alloc.allocate(allocation_size, memoc::Lifetime::transient); }) {
+                    return alloc.allocate(allocation_size, is_long_lived ? memoc::Lifetime::persistent : memoc::Lifetime::transient);
+                }
+                else if constexpr (requires { alloc.predict(transient_site); }) {
+                    return alloc.allocate(allocation_size, is_long_lived ? long_lived_site : transient_site);
+                }
+                else {
+                    return alloc.allocate(allocation_size);
+                }
+            }();
+            if (!r) {
+                ++failures;
+                continue;
+            }
+            if (is_long_lived) {
+                long_lived.push_back(r.value());
+            }
+            else {
+                transient = r.value();
+            }
+        }
+
+        for (auto& b : transients) {
+            if (!b.empty()) {
+                alloc.deallocate(b);
+            }
+        }
+        for (auto& b : long_lived) {
+            alloc.deallocate(b);
+        }
+        long_lived.clear();
+    }
+
+    state.counters["failures"] = benchmark::Counter(static_cast<double>(failures), benchmark::Counter::kAvgIterations);
+}
+
+using Mixed_lifetimes_arena = memoc::Ring_allocator<memoc::Malloc_allocator>;
+BENCHMARK_TEMPLATE(BM_mixed_lifetimes, Mixed_lifetimes_arena);
+BENCHMARK_TEMPLATE(BM_mixed_lifetimes, memoc::Lifetime_allocator<Mixed_lifetimes_arena, memoc::Malloc_allocator>);
+BENCHMARK_TEMPLATE(BM_mixed_lifetimes, memoc::Lifetime_predicting_allocator<Mixed_lifetimes_arena, memoc::Malloc_allocator, 2, 64>);
+
+static void BM_any_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Any_allocator alloc{ Free_list_allocator<Malloc_allocator, 16, 64, 64>{} };
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK(BM_any_allocator);
+
+// Calls the held allocator directly once its type is known.
+static void BM_any_allocator_target(benchmark::State& state)
+{
+    using namespace memoc;
+
+    using Free_list = Free_list_allocator<Malloc_allocator, 16, 64, 64>;
+    Any_allocator alloc{ Free_list{} };
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(alloc.target<Free_list>(), td);
+    }
+}
+BENCHMARK(BM_any_allocator_target);
+
+// Records the call site of each allocation over the plain Malloc_allocator.
+static void BM_site_stats_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Site_stats_allocator<Malloc_allocator> alloc{};
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK(BM_site_stats_allocator);
+
+// Measures one of every Sample_rate allocations and deallocations over the plain Malloc_allocator.
+template <std::int64_t Sample_rate>
+static void BM_latency_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Latency_allocator<Malloc_allocator, Sample_rate> alloc{};
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK_TEMPLATE(BM_latency_allocator, 1);
+BENCHMARK_TEMPLATE(BM_latency_allocator, 64);
+
+// Allocates only from the blocks cached by the warm up.
+static void BM_warm_free_list_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Free_list_allocator<Malloc_allocator, 16, 64, 64> alloc{};
+    warm_up(alloc, 64);
+    auto td = test_data<16, 64, 64>();
+
+    run_without_allocations(state, [&]() { perform_allocations(&alloc, td); });
+}
+BENCHMARK(BM_warm_free_list_allocator);
+
+// Publishes the metrics of the plain Malloc_allocator to a registry.
+static void BM_metrics_allocator(benchmark::State& state)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    Metrics_allocator<Malloc_allocator> alloc{ "malloc", &registry };
+    auto td = test_data<16, 64, 64>();
+
+    for (auto _ : state) {
+        perform_allocations(&alloc, td);
+    }
+}
+BENCHMARK(BM_metrics_allocator);
@@ -10,6 +10,25 @@
 #include <type_traits>
 #include <concepts>
 #include <memory>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include <tuple>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <cstdio>
+#include <source_location>
+#include <string_view>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(MEMOC_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#endif
 
 #include <oc/err.h>
 #include <genum/genum.h>
@@ -19,7 +38,16 @@
 GENUM_GENERATE(memoc, Allocator_error,
     invalid_size,
     out_of_memory,
-    unknown);
+    unknown,
+    invalid_alignment);
+
+// Statically defined tracing probes of the memoc provider, for tools such as bpftrace or perf.
+// Compiled in with MEMOC_ENABLE_USDT where <sys/sdt.h> is available, a probe is a single nop until attached.
+#if defined(MEMOC_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+#define MEMOC_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(memoc, name, a1, a2, a3)
+#else
+#define MEMOC_PROBE3(name, a1, a2, a3) static_cast<void>(0)
+#endif
 
 namespace memoc {
     namespace details {
@@ -41,541 +69,4859 @@ namespace memoc {
             {t.owns(std::cref(b))} noexcept -> std::same_as<bool>;
         };
 
-        template <Allocator Primary, Allocator Fallback>
-        class Fallback_allocator final {
-        public:
-            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
-            {
-                if (oc::Expected<Block<void>, Allocator_error> r = primary_.allocate(s)) {
-                    return r;
+        inline constexpr Block<void>::Size_type page_size = 4096;
+
+        // Faults in the pages of the given range, so first use of the memory does not pay for it.
+        inline Block<void>::Size_type prefault(void* p, Block<void>::Size_type s) noexcept
+        {
+            if (!p || s <= 0) {
+                return 0;
+            }
+            std::uint8_t* first = static_cast<std::uint8_t*>(p);
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+            const std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(first) + page_size - 1) & ~static_cast<std::uintptr_t>(page_size - 1);
+            const std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(first) + s) & ~static_cast<std::uintptr_t>(page_size - 1);
+            if (begin < end && madvise(reinterpret_cast<void*>(begin), end - begin, MADV_POPULATE_WRITE) == 0) {
+                // Only the partial pages at the edges are left to be touched.
+                if (begin > reinterpret_cast<std::uintptr_t>(first)) {
+                    *static_cast<volatile std::uint8_t*>(first) = *first;
                 }
-                return fallback_.allocate(s);
+                if (end < reinterpret_cast<std::uintptr_t>(first) + s) {
+                    *static_cast<volatile std::uint8_t*>(first + s - 1) = first[s - 1];
+                }
+                return s;
+            }
+#endif
+            for (Block<void>::Size_type i = 0; i < s; i += page_size) {
+                *static_cast<volatile std::uint8_t*>(first + i) = first[i];
             }
+            *static_cast<volatile std::uint8_t*>(first + s - 1) = first[s - 1];
+            return s;
+        }
 
-            constexpr void deallocate(Block<void>& b) noexcept
-            {
-                if (primary_.owns(b)) {
-                    return primary_.deallocate(b);
+        // Prepares an allocator for its first allocations, e.g. by prefilling caches or touching its memory pages.
+        // The amount is allocator specific - bytes for stack based allocators and blocks count for free lists.
+        // Returns the amount actually warmed up.
+        // Composite allocators take an amount per allocator, in its own unit, so they are warmed up by their warm_up member functions.
+        template <Allocator T>
+        inline constexpr std::int64_t warm_up(T& allocator, std::int64_t amount) noexcept
+        {
+            if constexpr (requires { {allocator.warm_up(amount)} noexcept -> std::same_as<std::int64_t>; }) {
+                return allocator.warm_up(amount);
+            }
+            else {
+                return 0;
+            }
+        }
+
+        // Optional allocator capabilities.
+        // A successful reallocation clears the original block, a failed one leaves it unchanged.
+        // Expansion grows or shrinks a block in place by delta bytes, and returns false if not possible.
+        template <class T>
+        concept Expanding_allocator = Allocator<T> &&
+            requires (T t, Block<void> b, Block<void>::Size_type delta)
+        {
+            {t.expand(std::ref(b), delta)} noexcept -> std::same_as<bool>;
+        };
+
+        template <class T>
+        concept Reallocating_allocator = Allocator<T> &&
+            requires (T t, Block<void> b, Block<void>::Size_type s)
+        {
+            {t.reallocate(std::ref(b), s)} noexcept -> std::same_as<oc::Expected<Block<void>, Allocator_error>>;
+        };
+
+        template <class T>
+        concept Aligned_allocator = Allocator<T> &&
+            requires (T t, Block<void>::Size_type s, Block<void>::Size_type alignment)
+        {
+            {t.allocate_aligned(s, alignment)} noexcept -> std::same_as<oc::Expected<Block<void>, Allocator_error>>;
+        };
+
+        template <class T>
+        concept Zeroing_allocator = Allocator<T> &&
+            requires (T t, Block<void>::Size_type s)
+        {
+            {t.allocate_zeroed(s)} noexcept -> std::same_as<oc::Expected<Block<void>, Allocator_error>>;
+        };
+
+        // Bulk allocation returns the number of blocks allocated.
+        template <class T>
+        concept Bulk_allocator = Allocator<T> &&
+            requires (T t, Block<void>::Size_type s, Block<void>* blocks, std::int64_t count)
+        {
+            {t.allocate_bulk(s, blocks, count)} noexcept -> std::same_as<std::int64_t>;
+            {t.deallocate_bulk(blocks, count)} noexcept -> std::same_as<void>;
+        };
+
+        // The usable size of the blocks allocated for s bytes, which can be used by the caller without reallocation.
+        template <class T>
+        concept Sizing_allocator = Allocator<T> &&
+            requires (const T t, Block<void>::Size_type s)
+        {
+            {t.good_size(s)} noexcept -> std::same_as<Block<void>::Size_type>;
+        };
+
+        // Allocators that attribute their allocations to call sites, by an allocate overload with a source location.
+        // Wrapping allocators take the call site as well and forward it to their internal allocators by allocate_at.
+        template <class T>
+        concept Site_allocator = Allocator<T> &&
+            requires (T t, Block<void>::Size_type s, std::source_location location)
+        {
+            {t.allocate(s, location)} noexcept -> std::same_as<oc::Expected<Block<void>, Allocator_error>>;
+        };
+
+        // Allocates with the call site for allocators that attribute their allocations to call sites, and without it for other allocators.
+        template <Allocator A>
+        [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_at(
+            A& allocator, Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+        {
+            if constexpr (Site_allocator<A>) {
+                return allocator.allocate(s, location);
+            }
+            else {
+                return allocator.allocate(s);
+            }
+        }
+
+        // Capabilities and properties of an allocator, for compile time selection of code paths.
+        // Properties are declared by static members of the allocator with the same names:
+        // - is_thread_safe: the allocator can be used concurrently, false by default.
+        // - is_stateless: instances are interchangeable, by default if the allocator is an empty class.
+        // - min_alignment: the alignment of all the allocated blocks, 1 by default.
+        template <Allocator A>
+        struct Allocator_traits {
+            static constexpr bool can_expand = Expanding_allocator<A>;
+            static constexpr bool can_reallocate = Reallocating_allocator<A>;
+            static constexpr bool can_allocate_aligned = Aligned_allocator<A>;
+            static constexpr bool can_allocate_zeroed = Zeroing_allocator<A>;
+            static constexpr bool can_allocate_bulk = Bulk_allocator<A>;
+            static constexpr bool can_report_good_size = Sizing_allocator<A>;
+
+            static constexpr bool is_thread_safe = []() {
+                if constexpr (requires { {A::is_thread_safe} -> std::convertible_to<bool>; }) {
+                    return static_cast<bool>(A::is_thread_safe);
+                }
+                else {
+                    return false;
+                }
+            }();
+
+            static constexpr bool is_stateless = []() {
+                if constexpr (requires { {A::is_stateless} -> std::convertible_to<bool>; }) {
+                    return static_cast<bool>(A::is_stateless);
+                }
+                else {
+                    return std::is_empty_v<A>;
+                }
+            }();
+
+            static constexpr Block<void>::Size_type min_alignment = []() {
+                if constexpr (requires { {A::min_alignment} -> std::convertible_to<Block<void>::Size_type>; }) {
+                    return static_cast<Block<void>::Size_type>(A::min_alignment);
                 }
-                else if(fallback_.owns(b)) {
-                    fallback_.deallocate(b);
+                else {
+                    return Block<void>::Size_type{ 1 };
                 }
+            }();
+        };
+
+        // A compile time identifier of a type, which allocators stamp into the hint of their blocks.
+        template <typename T>
+        [[nodiscard]] consteval std::int64_t type_id() noexcept
+        {
+            // FNV-1a hash of the function name, which contains the type name
+            std::uint64_t code = 14695981039346656037ull;
+            for (const char* p = std::source_location::current().function_name(); *p != '\0'; ++p) {
+                code ^= static_cast<std::uint8_t>(*p);
+                code *= 1099511628211ull;
             }
+            return static_cast<std::int64_t>(code >> 1);
+        }
 
-            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
-            {
-                return primary_.owns(b) || fallback_.owns(b);
+        // Allocators that stamp their blocks hints with an identifier
+        template <class T>
+        concept Stamping_allocator =
+            requires
+        {
+            {T::id} -> std::convertible_to<std::int64_t>;
+        };
+
+        // Memory accounting of an allocator, negative values are not tracked by it.
+        // - in use: held by the users of the allocator.
+        // - cached: held by the allocator and available for allocation, e.g. listed blocks.
+        // - overhead: held for bookkeeping, e.g. headers and records.
+        struct Allocator_usage {
+            Block<void>::Size_type bytes_in_use{ -1 };
+            Block<void>::Size_type bytes_cached{ -1 };
+            Block<void>::Size_type bytes_overhead{ -1 };
+            std::int64_t blocks_in_use{ -1 };
+            std::int64_t blocks_cached{ -1 };
+        };
+
+        // Receives the descriptions of an allocator and its internal allocators, depth first.
+        // Each allocator is described between enter and leave, by its type, parameters and usage, followed by its internal allocators.
+        // The role is the relation of the allocator to its parent, e.g. "internal" or "fallback", and is empty for the visited allocator.
+        class Allocator_visitor {
+        public:
+            virtual ~Allocator_visitor() = default;
+
+            virtual void enter(std::string_view role) = 0;
+            virtual void type(std::string_view name) = 0;
+            virtual void parameter(std::string_view name, std::int64_t value) = 0;
+            virtual void usage(const Allocator_usage& u) = 0;
+            virtual void leave() = 0;
+        };
+
+        // Allocators describe themselves by a 'visit(Allocator_visitor&) const' member function, others are of an unknown type.
+        template <Allocator A>
+        inline void visit(const A& allocator, Allocator_visitor& v, std::string_view role = {})
+        {
+            v.enter(role);
+            if constexpr (requires { allocator.visit(v); }) {
+                allocator.visit(v);
+            }
+            else {
+                v.type("unknown");
             }
+            v.leave();
+        }
 
-        private:
-            Primary primary_;
-            Fallback fallback_;
+        // Observes the allocations of allocators of type A, by specialization for the type or a family of types.
+        // The default observer is disabled and compiled out. An enabled observer is called by the allocator on each successful
+        // allocation and deallocation of a non empty block, and on each failed allocation. It should not use the observed allocator.
+        // All the allocators of the library are observable, including the wrapping ones, e.g. the rejections of Budget_allocator.
+        template <class A>
+        struct Allocator_observer {
+            static constexpr bool enabled = false;
+
+            static void on_allocate(const A&, const Block<void>&) noexcept {}
+            static void on_deallocate(const A&, const Block<void>&) noexcept {}
+            static void on_failure(const A&, Block<void>::Size_type, Allocator_error) noexcept {}
         };
 
-        [[nodiscard]] constexpr std::int64_t encode_string(const char* str) noexcept {
-            const char* p = str;
-            std::uint64_t code = 0;
-            while (!*p == '\0' && code < std::numeric_limits<std::int64_t>::max()) {
-                std::uint64_t char_code = static_cast<std::uint64_t>(*p++);
-                code |= char_code;
-                code <<= (sizeof(*p) * 8);
+        // Reports an allocation result of s bytes to the observer of the allocator and to the probes, and returns the result.
+        // The probes are memoc:allocate(id, size, pointer) and memoc:allocation_failure(id, size, error), where id is type_id<A>().
+        template <class A>
+        [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> observe_allocation(
+            const A& allocator, Block<void>::Size_type s, oc::Expected<Block<void>, Allocator_error> r) noexcept
+        {
+            if (std::is_constant_evaluated()) {
+                return r;
             }
-            return static_cast<std::int64_t>(code);
+            if (r) {
+                if (!r.value().empty()) {
+                    MEMOC_PROBE3(allocate, type_id<A>(), r.value().size(), r.value().data());
+                    if constexpr (Allocator_observer<A>::enabled) {
+                        Allocator_observer<A>::on_allocate(allocator, r.value());
+                    }
+                }
+            }
+            else {
+                MEMOC_PROBE3(allocation_failure, type_id<A>(), s, static_cast<std::int64_t>(r.error()));
+                if constexpr (Allocator_observer<A>::enabled) {
+                    Allocator_observer<A>::on_failure(allocator, s, r.error());
+                }
+            }
+            return r;
         }
 
-        class Malloc_allocator final {
+        // Reports a deallocation to the observer of the allocator and to the memoc:deallocate(id, size, pointer) probe.
+        template <class A>
+        constexpr void observe_deallocation(const A& allocator, const Block<void>& b) noexcept
+        {
+            if (std::is_constant_evaluated() || b.empty()) {
+                return;
+            }
+            MEMOC_PROBE3(deallocate, type_id<A>(), b.size(), b.data());
+            if constexpr (Allocator_observer<A>::enabled) {
+                Allocator_observer<A>::on_deallocate(allocator, b);
+            }
+        }
+
+        // Guards the calling thread against memory obtained from the system, e.g. a hot path after its pools are warmed up.
+        // Allocators that obtain memory from the system, by malloc, mmap or a memory resource, report each attempt with
+        // on_system_allocation, so every allocator, buffer and pointer over them is guarded. Blocks reused by an allocator are not counted.
+        // A scope counts the allocations of its thread while it is alive, an aborting scope also aborts the process on the first one.
+        // Scopes nest, and should be destructed by their thread in reverse order of construction.
+        class No_alloc_scope final {
         public:
-            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            explicit No_alloc_scope(bool abort_on_allocation = false) noexcept
+                : abort_on_allocation_(abort_on_allocation), allocations_at_entry_(state_.allocations)
             {
-                if (s < 0) {
-                    return oc::Unexpected(Allocator_error::invalid_size);
-                }
-                if (s == 0) {
-                    return Block<void>();
+                if (state_.depth++ == 0) {
+                    guarded_threads_.fetch_add(1, std::memory_order_relaxed);
                 }
-                Block<void> b(s, std::malloc(s), uuid_);
-                if (b.empty()) {
-                    return oc::Unexpected(Allocator_error::unknown);
+                state_.aborting_depth += abort_on_allocation_ ? 1 : 0;
+            }
+
+            No_alloc_scope(const No_alloc_scope&) = delete;
+            No_alloc_scope& operator=(const No_alloc_scope&) = delete;
+            No_alloc_scope(No_alloc_scope&&) = delete;
+            No_alloc_scope& operator=(No_alloc_scope&&) = delete;
+
+            ~No_alloc_scope() noexcept
+            {
+                state_.aborting_depth -= abort_on_allocation_ ? 1 : 0;
+                if (--state_.depth == 0) {
+                    guarded_threads_.fetch_sub(1, std::memory_order_relaxed);
                 }
-                return b;
             }
 
-            void deallocate(Block<void>& b) noexcept
+            // The allocations of the thread since the scope construction, including those of nested scopes.
+            [[nodiscard]] std::int64_t allocations() const noexcept
             {
-                std::free(b.data());
-                b = Block<void>();
+                return state_.allocations - allocations_at_entry_;
             }
 
-            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            // Whether the calling thread is in a scope.
+            [[nodiscard]] static bool active() noexcept
             {
-                return b.data() && b.hint() == uuid_;
+                return state_.depth > 0;
+            }
+
+            // The check of threads not in a scope is a single relaxed load, while any thread is in one also a thread local access.
+            static constexpr void on_system_allocation(Block<void>::Size_type s) noexcept
+            {
+                if (std::is_constant_evaluated() || guarded_threads_.load(std::memory_order_relaxed) == 0 || state_.depth == 0) {
+                    return;
+                }
+                ++state_.allocations;
+                if (state_.aborting_depth > 0) {
+                    std::fprintf(stderr, "memoc: allocation of %lld bytes in a No_alloc_scope\n", static_cast<long long>(s));
+                    std::abort();
+                }
             }
 
         private:
-            constexpr static std::int64_t uuid_ = encode_string("095deb2c-f51a-4193-b177-d6d686087c72");
-        };
+            struct State {
+                std::int64_t depth{ 0 };
+                std::int64_t aborting_depth{ 0 };
+                std::int64_t allocations{ 0 };
+            };
 
-        template <class T>
-        concept Stack_memory =
-            requires
-        {
-            std::is_default_constructible_v<T>;
-            std::is_copy_constructible_v<T>;
-            std::is_copy_assignable_v<T>;
-            std::is_move_constructible_v<T>;
-            std::is_move_assignable_v<T>;
-            std::is_destructible_v<T>;
-        }&&
-            requires (T t, Block<void>::Size_type s, void* p)
-        {
-            {t.stack_malloc(s)} noexcept -> std::same_as<void*>;
-            {t.stack_free(p, s)} noexcept -> std::same_as<void>;
-            {t.stack_owns(p)} noexcept -> std::same_as<bool>;
+            bool abort_on_allocation_;
+            std::int64_t allocations_at_entry_;
+
+            // Threads in a scope
+            inline static std::atomic<std::int64_t> guarded_threads_{ 0 };
+            static thread_local State state_;
         };
 
-        template <std::int64_t Stacks_count, Block<void>::Size_type Buffer_size>
-        class Default_global_stack_memory final {
-            static_assert(Stacks_count > 0);
-            static_assert(Buffer_size > 1 && Buffer_size % 2 == 0);
+        // Defined after the class, which completes the default member initializers of the state
+        inline thread_local No_alloc_scope::State No_alloc_scope::state_{};
+
+        // Blocks are deallocated by the allocator that owns them, blocks owned by neither are ignored.
+        // Nested fallback allocators resolve the ownership with a single query per allocator.
+        // There is no process wide ownership index: the owners are mostly malloc and stack memory, which share pages and are not segment aligned,
+        // so neither a page to owner map nor masking a pointer to a segment header can identify them, and the latter reads foreign memory.
+        template <Allocator Primary, Allocator Fallback>
+        class Fallback_allocator final {
         public:
-            constexpr Default_global_stack_memory() noexcept {
-                if (!initialized_) {
-                    for (std::int64_t i = 0; i < Stacks_count; ++i) {
-                        ptrs_[i] = buffers_[i];
-                    }
-                    initialized_ = true;
+            static constexpr bool is_thread_safe = Allocator_traits<Primary>::is_thread_safe && Allocator_traits<Fallback>::is_thread_safe;
+            static constexpr bool is_stateless = Allocator_traits<Primary>::is_stateless && Allocator_traits<Fallback>::is_stateless;
+            static constexpr Block<void>::Size_type min_alignment = std::min(Allocator_traits<Primary>::min_alignment, Allocator_traits<Fallback>::min_alignment);
+
+            constexpr Fallback_allocator() = default;
+            constexpr Fallback_allocator(Primary primary, Fallback fallback) noexcept
+                : primary_(std::move(primary)), fallback_(std::move(fallback)) {}
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                if (oc::Expected<Block<void>, Allocator_error> r = allocate_at(primary_, s, location)) {
+                    return observe_allocation(*this, s, r);
                 }
+                return observe_allocation(*this, s, allocate_at(fallback_, s, location));
             }
 
-            [[nodiscard]] constexpr void* stack_malloc(Block<void>::Size_type s) noexcept
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_aligned(Block<void>::Size_type s, Block<void>::Size_type alignment) noexcept
+                requires (Aligned_allocator<Primary> && Aligned_allocator<Fallback>)
             {
-                for (std::int64_t i = 0; i < Stacks_count; ++i) {
-                    if (Buffer_size - (ptrs_[i] - buffers_[i]) >= s) {
-                        void* tmp = ptrs_[i];
-                        ptrs_[i] += s;
-                        return tmp;
-                    }
+                if (oc::Expected<Block<void>, Allocator_error> r = primary_.allocate_aligned(s, alignment)) {
+                    return r;
                 }
-                return nullptr;
+                return fallback_.allocate_aligned(s, alignment);
             }
 
-            constexpr void stack_free(void* p, Block<void>::Size_type s) noexcept
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_zeroed(Block<void>::Size_type s) noexcept
+                requires (Zeroing_allocator<Primary> && Zeroing_allocator<Fallback>)
             {
-                for (std::int64_t i = 0; i < Stacks_count; ++i) {
-                    if (p == ptrs_[i] - s) {
-                        ptrs_[i] = reinterpret_cast<std::uint8_t*>(p);
-                        break;
+                if (oc::Expected<Block<void>, Allocator_error> r = primary_.allocate_zeroed(s)) {
+                    return r;
+                }
+                return fallback_.allocate_zeroed(s);
+            }
+
+            // Reallocated by the owner of the block.
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> reallocate(Block<void>& b, Block<void>::Size_type s) noexcept
+                requires (Reallocating_allocator<Primary> && Reallocating_allocator<Fallback>)
+            {
+                if (primary_.owns(b)) {
+                    return primary_.reallocate(b, s);
+                }
+                return fallback_.reallocate(b, s);
+            }
+
+            [[nodiscard]] constexpr bool expand(Block<void>& b, Block<void>::Size_type delta) noexcept
+                requires (Expanding_allocator<Primary> || Expanding_allocator<Fallback>)
+            {
+                if (primary_.owns(b)) {
+                    if constexpr (Expanding_allocator<Primary>) {
+                        return primary_.expand(b, delta);
                     }
+                    else {
+                        return false;
+                    }
+                }
+                if constexpr (Expanding_allocator<Fallback>) {
+                    return fallback_.expand(b, delta);
+                }
+                else {
+                    return false;
                 }
             }
 
-            [[nodiscard]] constexpr bool stack_owns(void* p) const noexcept
+            constexpr void deallocate(Block<void>& b) noexcept
             {
-                for (std::int64_t i = 0; i < Stacks_count; ++i) {
-                    const std::uint8_t* lp = reinterpret_cast<const std::uint8_t*>(p);
-                    if (lp >= buffers_[i] && lp < buffers_[i] + Buffer_size) {
+                observe_deallocation(*this, b);
+                deallocate_owned(b);
+            }
+
+            // Deallocates the block if owned, returns whether it was owned.
+            constexpr bool deallocate_owned(Block<void>& b) noexcept
+            {
+                if (primary_.owns(b)) {
+                    primary_.deallocate(b);
+                    return true;
+                }
+                if constexpr (requires { fallback_.deallocate_owned(b); }) {
+                    return fallback_.deallocate_owned(b);
+                }
+                else {
+                    if (fallback_.owns(b)) {
+                        fallback_.deallocate(b);
                         return true;
                     }
+                    return false;
                 }
-                return false;
             }
 
-        private:
-            inline static std::uint8_t buffers_[Stacks_count][Buffer_size];
-            inline static std::uint8_t* ptrs_[Stacks_count];
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return primary_.owns(b) || fallback_.owns(b);
+            }
+
+            // Returns the amounts warmed up by each allocator.
+            constexpr std::pair<std::int64_t, std::int64_t> warm_up(std::int64_t primary_amount, std::int64_t fallback_amount) noexcept
+            {
+                return { memoc::details::warm_up(primary_, primary_amount), memoc::details::warm_up(fallback_, fallback_amount) };
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Fallback_allocator");
+                details::visit(primary_, v, "primary");
+                details::visit(fallback_, v, "fallback");
+            }
 
-            inline static bool initialized_{ false };
+        private:
+            Primary primary_;
+            Fallback fallback_;
         };
 
-        template <Stack_memory Internal_stack_memory = Default_global_stack_memory<16, 128>>
-        class Stack_allocator final {
+        // Tries the allocators in order and returns the first successful allocation.
+        // Deallocation is dispatched by the block hint to allocators with a unique stamp identifier that only stamping allocators follow,
+        // since wrapping allocators carry the hints of the allocators they wrap.
+        // Other allocators are queried for ownership, and blocks not owned by any preceding allocator are deallocated by the last one.
+        // Allocators whose ownership queries cannot tell their blocks apart, e.g. Malloc_allocator and a wrapper of it, should not be chained together.
+        template <Allocator... As>
+            requires (sizeof...(As) > 0)
+        class Fallback_chain final {
         public:
-            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            static constexpr bool is_thread_safe = (Allocator_traits<As>::is_thread_safe && ...);
+            static constexpr bool is_stateless = (Allocator_traits<As>::is_stateless && ...);
+            static constexpr Block<void>::Size_type min_alignment = std::min({ Allocator_traits<As>::min_alignment... });
+
+            constexpr Fallback_chain() = default;
+            constexpr explicit Fallback_chain(As... as) noexcept
+                : allocators_(std::move(as)...) {}
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
             {
-                if (s < 0) {
-                    return oc::Unexpected(Allocator_error::invalid_size);
-                }
-                if (s == 0) {
-                    return Block<void>();
-                }
-                void* p = sm_.stack_malloc(align(s));
-                if (!p) {
-                    return oc::Unexpected(Allocator_error::out_of_memory);
-                }
-                return Block<void>(s, p);
+                return observe_allocation(*this, s, allocate([s, &location](auto& a) { return allocate_at(a, s, location); }, std::index_sequence_for<As...>{}));
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_aligned(Block<void>::Size_type s, Block<void>::Size_type alignment) noexcept
+                requires (Aligned_allocator<As> && ...)
+            {
+                return allocate([s, alignment](auto& a) { return a.allocate_aligned(s, alignment); }, std::index_sequence_for<As...>{});
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_zeroed(Block<void>::Size_type s) noexcept
+                requires (Zeroing_allocator<As> && ...)
+            {
+                return allocate([s](auto& a) { return a.allocate_zeroed(s); }, std::index_sequence_for<As...>{});
             }
 
             constexpr void deallocate(Block<void>& b) noexcept
             {
-                sm_.stack_free(b.data(), align(b.size()));
-                b = {};
+                observe_deallocation(*this, b);
+                deallocate(b, std::index_sequence_for<As...>{});
             }
 
             [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
             {
-                return sm_.stack_owns(b.data());
+                return std::apply([&b](const As&... as) { return (as.owns(b) || ...); }, allocators_);
             }
 
-        private:
-            static constexpr Block<void>::Size_type align(Block<void>::Size_type s)
+            // Takes an amount per allocator and returns the amounts warmed up by each of them.
+            template <std::convertible_to<std::int64_t>... Amounts>
+                requires (sizeof...(Amounts) == sizeof...(As))
+            constexpr std::array<std::int64_t, sizeof...(As)> warm_up(Amounts... amounts) noexcept
             {
-                return s % 2 == 0 ? s : s + 1;
+                return std::apply([&](As&... as) { return std::array<std::int64_t, sizeof...(As)>{ memoc::details::warm_up(as, static_cast<std::int64_t>(amounts))... }; }, allocators_);
             }
 
-            Internal_stack_memory sm_{};
-        };
+            // Number of allocations served by the I'th allocator.
+            template <std::size_t I>
+                requires (I < sizeof...(As))
+            [[nodiscard]] constexpr std::int64_t hits() const noexcept
+            {
+                return hits_[I];
+            }
 
-        template <
-            Allocator Internal_allocator,
-            Block<void>::Size_type Min_size, Block<void>::Size_type Max_size, std::int64_t Max_list_size>
-            class Free_list_allocator final {
-            static_assert(Min_size > 1 && Min_size % 2 == 0);
-            static_assert(Max_size > 1 && Max_size % 2 == 0);
-            static_assert(Max_list_size > 0);
-            public:
-                constexpr Free_list_allocator() = default;
-                constexpr Free_list_allocator(const Free_list_allocator& other) noexcept
-                    : internal_(other.internal_), root_(nullptr), list_size_(0) {}
-                constexpr Free_list_allocator operator=(const Free_list_allocator& other) noexcept
-                {
+            template <std::size_t I>
+                requires (I < sizeof...(As))
+            [[nodiscard]] constexpr const std::tuple_element_t<I, std::tuple<As...>>& get() const noexcept
+            {
+                return std::get<I>(allocators_);
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Fallback_chain");
+                std::apply([&v](const As&... as) { (details::visit(as, v, "link"), ...); }, allocators_);
+            }
+
+        private:
+            template <class A, class B>
+            static consteval bool same_stamp() noexcept
+            {
+                if constexpr (Stamping_allocator<A> && Stamping_allocator<B>) {
+                    return static_cast<std::int64_t>(A::id) == static_cast<std::int64_t>(B::id);
+                }
+                else {
+                    return false;
+                }
+            }
+
+            template <std::size_t I, std::size_t... Js>
+            static consteval bool followed_by_stamping(std::index_sequence<Js...>) noexcept
+            {
+                return ((Js <= I || Stamping_allocator<std::tuple_element_t<Js, std::tuple<As...>>>) && ...);
+            }
+
+            template <std::size_t I>
+            static consteval bool dispatched_by_hint() noexcept
+            {
+                using A = std::tuple_element_t<I, std::tuple<As...>>;
+                return Stamping_allocator<A> && (static_cast<int>(same_stamp<A, As>()) + ...) == 1
+                    && followed_by_stamping<I>(std::index_sequence_for<As...>{});
+            }
+
+            template <typename F, std::size_t... Is>
+            constexpr oc::Expected<Block<void>, Allocator_error> allocate(F&& f, std::index_sequence<Is...>) noexcept
+            {
+                Block<void> b{};
+                Allocator_error error{ Allocator_error::unknown };
+                if ((try_allocate<Is>(f, b, error) || ...)) {
+                    return b;
+                }
+                return oc::Unexpected(error);
+            }
+
+            template <std::size_t I, typename F>
+            constexpr bool try_allocate(F& f, Block<void>& b, Allocator_error& error) noexcept
+            {
+                oc::Expected<Block<void>, Allocator_error> r = f(std::get<I>(allocators_));
+                if (!r) {
+                    error = r.error();
+                    return false;
+                }
+                b = r.value();
+                ++hits_[I];
+                return true;
+            }
+
+            template <std::size_t... Is>
+            constexpr void deallocate(Block<void>& b, std::index_sequence<Is...>) noexcept
+            {
+                (try_deallocate<Is>(b) || ...);
+            }
+
+            template <std::size_t I>
+            constexpr bool try_deallocate(Block<void>& b) noexcept
+            {
+                using A = std::tuple_element_t<I, std::tuple<As...>>;
+                if constexpr (I + 1 < sizeof...(As)) {
+                    if constexpr (dispatched_by_hint<I>()) {
+                        // Blocks without a hint, e.g. ones deallocated through standard allocator interfaces, are queried for ownership
+                        if (b.hint() != A::id && (b.hint() != no_hint_ || !std::get<I>(allocators_).owns(b))) {
+                            return false;
+                        }
+                    }
+                    else if (!std::get<I>(allocators_).owns(b)) {
+                        return false;
+                    }
+                }
+                std::get<I>(allocators_).deallocate(b);
+                return true;
+            }
+
+            static constexpr std::int64_t no_hint_ = Block<void>{}.hint();
+
+            std::tuple<As...> allocators_{};
+            std::int64_t hits_[sizeof...(As)]{};
+        };
+
+        // Blocks of up to Threshold bytes are allocated by the small allocator, larger ones by the large allocator.
+        // Blocks are dispatched by their size, so no ownership query is needed.
+        template <Block<void>::Size_type Threshold, Allocator Small_allocator, Allocator Large_allocator>
+        class Segregator final {
+        public:
+            static constexpr bool is_thread_safe = Allocator_traits<Small_allocator>::is_thread_safe && Allocator_traits<Large_allocator>::is_thread_safe;
+            static constexpr bool is_stateless = Allocator_traits<Small_allocator>::is_stateless && Allocator_traits<Large_allocator>::is_stateless;
+            static constexpr Block<void>::Size_type min_alignment = std::min(Allocator_traits<Small_allocator>::min_alignment, Allocator_traits<Large_allocator>::min_alignment);
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                return observe_allocation(*this, s, s <= Threshold ? allocate_at(small_, s, location) : allocate_at(large_, s, location));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (b.size() <= Threshold) {
+                    small_.deallocate(b);
+                }
+                else {
+                    large_.deallocate(b);
+                }
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return b.size() <= Threshold ? small_.owns(b) : large_.owns(b);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                requires (Sizing_allocator<Small_allocator> || Sizing_allocator<Large_allocator>)
+            {
+                if (s <= Threshold) {
+                    if constexpr (Sizing_allocator<Small_allocator>) {
+                        const Block<void>::Size_type gs = small_.good_size(s);
+                        return gs <= Threshold ? gs : Threshold;
+                    }
+                    return s;
+                }
+                if constexpr (Sizing_allocator<Large_allocator>) {
+                    return large_.good_size(s);
+                }
+                return s;
+            }
+
+            [[nodiscard]] constexpr Small_allocator& small() noexcept
+            {
+                return small_;
+            }
+
+            [[nodiscard]] constexpr Large_allocator& large() noexcept
+            {
+                return large_;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Segregator");
+                v.parameter("threshold", Threshold);
+                details::visit(small_, v, "small");
+                details::visit(large_, v, "large");
+            }
+
+        private:
+            [[no_unique_address]] Small_allocator small_{};
+            [[no_unique_address]] Large_allocator large_{};
+        };
+
+        enum class Lifetime {
+            transient,
+            persistent
+        };
+
+        template <class T>
+        concept Lifetime_tag =
+            requires
+        {
+            {T::lifetime} -> std::convertible_to<Lifetime>;
+        };
+
+        // Routes each lifetime class to a separate allocator, so long lived blocks do not fragment the memory of transient ones.
+        // Allocations with an unspecified lifetime are considered persistent.
+        template <Allocator Transient_allocator, Allocator Persistent_allocator>
+        class Lifetime_allocator final {
+        public:
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                return observe_allocation(*this, s, persistent_.allocate(s));
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, Lifetime lifetime) noexcept
+            {
+                return observe_allocation(*this, s, lifetime == Lifetime::transient ? transient_.allocate(s) : persistent_.allocate(s));
+            }
+
+            template <Lifetime_tag Tag>
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                return allocate(s, Tag::lifetime);
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (transient_.owns(b)) {
+                    return transient_.deallocate(b);
+                }
+                persistent_.deallocate(b);
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return transient_.owns(b) || persistent_.owns(b);
+            }
+
+            // Returns the amounts warmed up by each allocator.
+            constexpr std::pair<std::int64_t, std::int64_t> warm_up(std::int64_t transient_amount, std::int64_t persistent_amount) noexcept
+            {
+                return { memoc::details::warm_up(transient_, transient_amount), memoc::details::warm_up(persistent_, persistent_amount) };
+            }
+
+            [[nodiscard]] constexpr const Transient_allocator& transient() const noexcept
+            {
+                return transient_;
+            }
+
+            [[nodiscard]] constexpr const Persistent_allocator& persistent() const noexcept
+            {
+                return persistent_;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Lifetime_allocator");
+                details::visit(transient_, v, "transient");
+                details::visit(persistent_, v, "persistent");
+            }
+
+        private:
+            Transient_allocator transient_{};
+            Persistent_allocator persistent_{};
+        };
+
+        // Predicts the lifetime class of allocations per allocation site, from the observed lifetimes of previous allocations of the site.
+        // A lifetime is measured in the number of allocations made between the allocation and the deallocation of a block.
+        // Sites with an average lifetime of up to Transient_threshold are transient, sites without observations are persistent.
+        // Each block is preceded by a header that holds its site, allocation time and hint.
+        // Blocks are stamped with the allocator's id, so the header of a block is only read once it is known to be allocated by it.
+        template <Allocator Transient_allocator, Allocator Persistent_allocator, std::int64_t Sites_count = 256, std::int64_t Transient_threshold = 1024>
+        class Lifetime_predicting_allocator final {
+            static_assert(Sites_count > 0 && Sites_count <= std::numeric_limits<std::int32_t>::max());
+            static_assert(Transient_threshold >= 0);
+        public:
+            static constexpr std::int64_t id = type_id<Lifetime_predicting_allocator>();
+            static constexpr std::int64_t unknown_site = -1;
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                return allocate(s, unknown_site);
+            }
+
+            // Sites are in [0, Sites_count), other values are not tracked.
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::int64_t site) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                if (s > std::numeric_limits<Block<void>::Size_type>::max() - header_size_) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+
+                const bool tracked = site >= 0 && site < Sites_count;
+                oc::Expected<Block<void>, Allocator_error> r = tracked && predict(site) == Lifetime::transient
+                    ? transient_.allocate(s + header_size_)
+                    : persistent_.allocate(s + header_size_);
+                if (!r || r.value().empty()) {
+                    return observe_allocation(*this, s, r);
+                }
+
+                Header* h = reinterpret_cast<Header*>(r.value().data());
+                h->site = tracked ? static_cast<std::int32_t>(site) : -1;
+                h->birth = clock_++;
+                h->hint = r.value().hint();
+                return observe_allocation(*this, s, Block<void>(s, reinterpret_cast<std::uint8_t*>(h) + header_size_, id));
+            }
+
+            // Blocks without a hint, e.g. ones deallocated through standard allocator interfaces, are considered allocated by it.
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                if (b.empty() || (b.hint() != id && b.hint() != no_hint_)) {
+                    return;
+                }
+                observe_deallocation(*this, b);
+                Header* h = reinterpret_cast<Header*>(static_cast<std::uint8_t*>(b.data()) - header_size_);
+                if (h->site >= 0) {
+                    observe(h->site, static_cast<std::uint32_t>(clock_ - h->birth));
+                }
+                Block<void> ib{ b.size() + header_size_, h, h->hint };
+                if (transient_.owns(ib)) {
+                    transient_.deallocate(ib);
+                }
+                else {
+                    persistent_.deallocate(ib);
+                }
+                b = {};
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                if (b.empty() || b.hint() != id) {
+                    return false;
+                }
+                const Header* h = reinterpret_cast<const Header*>(static_cast<const std::uint8_t*>(b.data()) - header_size_);
+                const Block<void> ib{ b.size() + header_size_, h, h->hint };
+                return transient_.owns(ib) || persistent_.owns(ib);
+            }
+
+            [[nodiscard]] constexpr Lifetime predict(std::int64_t site) const noexcept
+            {
+                if (site < 0 || site >= Sites_count || observations_[site] == 0) {
+                    return Lifetime::persistent;
+                }
+                return average_lifetimes_[site] <= Transient_threshold ? Lifetime::transient : Lifetime::persistent;
+            }
+
+            // The smoothed lifetime of the site's blocks, or -1 if not observed.
+            [[nodiscard]] constexpr std::int64_t average_lifetime(std::int64_t site) const noexcept
+            {
+                if (site < 0 || site >= Sites_count || observations_[site] == 0) {
+                    return -1;
+                }
+                return average_lifetimes_[site];
+            }
+
+            // Returns the amounts warmed up by each allocator.
+            constexpr std::pair<std::int64_t, std::int64_t> warm_up(std::int64_t transient_amount, std::int64_t persistent_amount) noexcept
+            {
+                return { memoc::details::warm_up(transient_, transient_amount), memoc::details::warm_up(persistent_, persistent_amount) };
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Lifetime_predicting_allocator");
+                v.parameter("sites_count", Sites_count);
+                v.parameter("transient_threshold", Transient_threshold);
+                details::visit(transient_, v, "transient");
+                details::visit(persistent_, v, "persistent");
+            }
+
+        private:
+            struct Header {
+                std::int32_t site{ -1 };
+                std::uint32_t birth{ 0 };
+                std::int64_t hint{ std::numeric_limits<std::int64_t>::min() };
+            };
+            static constexpr Block<void>::Size_type header_size_ = MEMOC_SSIZEOF(Header) > static_cast<Block<void>::Size_type>(alignof(std::max_align_t))
+                ? MEMOC_SSIZEOF(Header) : static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+            static constexpr std::int64_t no_hint_ = Block<void>{}.hint();
+
+            constexpr void observe(std::int64_t site, std::int64_t lifetime) noexcept
+            {
+                // Exponential moving average with a weight of 1/8 for the last observation
+                if (observations_[site]++ == 0) {
+                    average_lifetimes_[site] = lifetime;
+                }
+                else {
+                    average_lifetimes_[site] += (lifetime - average_lifetimes_[site]) / 8;
+                }
+            }
+
+            Transient_allocator transient_{};
+            Persistent_allocator persistent_{};
+
+            std::uint32_t clock_{ 0 };
+            std::int64_t observations_[Sites_count]{};
+            std::int64_t average_lifetimes_[Sites_count]{};
+        };
+
+        [[nodiscard]] constexpr std::int64_t encode_string(const char* str) noexcept {
+            const char* p = str;
+            std::uint64_t code = 0;
+            while (!*p == '\0' && code < std::numeric_limits<std::int64_t>::max()) {
+                std::uint64_t char_code = static_cast<std::uint64_t>(*p++);
+                code |= char_code;
+                code <<= (sizeof(*p) * 8);
+            }
+            return static_cast<std::int64_t>(code);
+        }
+
+        class Malloc_allocator final {
+        public:
+            static constexpr std::int64_t id = encode_string("095deb2c-f51a-4193-b177-d6d686087c72");
+            static constexpr bool is_thread_safe = true;
+            static constexpr Block<void>::Size_type min_alignment = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                No_alloc_scope::on_system_allocation(s);
+                Block<void> b(s, std::malloc(s), id);
+                if (b.empty()) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::unknown));
+                }
+                return observe_allocation(*this, s, b);
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (b.empty()) {
+                    return;
+                }
+                std::free(b.data());
+                b = Block<void>();
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return b.data() && b.hint() == id;
+            }
+
+            // Blocks allocated with an alignment above min_alignment should not be reallocated.
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> reallocate(Block<void>& b, Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return oc::Unexpected(Allocator_error::invalid_size);
+                }
+                if (b.empty()) {
+                    return allocate(s);
+                }
+                if (s == 0) {
+                    deallocate(b);
+                    return Block<void>();
+                }
+                No_alloc_scope::on_system_allocation(s);
+                void* p = std::realloc(b.data(), s);
+                if (!p) {
+                    return oc::Unexpected(Allocator_error::unknown);
+                }
+                b = Block<void>();
+                return Block<void>(s, p, id);
+            }
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate_aligned(Block<void>::Size_type s, Block<void>::Size_type alignment) noexcept
+            {
+                if (alignment <= 0 || (alignment & (alignment - 1)) != 0) {
+                    return oc::Unexpected(Allocator_error::invalid_alignment);
+                }
+                if (alignment <= min_alignment) {
+                    return allocate(s);
+                }
+                if (s < 0) {
+                    return oc::Unexpected(Allocator_error::invalid_size);
+                }
+                if (s == 0) {
+                    return Block<void>();
+                }
+                No_alloc_scope::on_system_allocation(s);
+                // The size of an aligned allocation should be a multiple of the alignment
+                Block<void> b(s, std::aligned_alloc(alignment, (s + alignment - 1) & ~(alignment - 1)), id);
+                if (b.empty()) {
+                    return oc::Unexpected(Allocator_error::unknown);
+                }
+                return b;
+            }
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate_zeroed(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return oc::Unexpected(Allocator_error::invalid_size);
+                }
+                if (s == 0) {
+                    return Block<void>();
+                }
+                No_alloc_scope::on_system_allocation(s);
+                Block<void> b(s, std::calloc(1, s), id);
+                if (b.empty()) {
+                    return oc::Unexpected(Allocator_error::unknown);
+                }
+                return b;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Malloc_allocator");
+            }
+        };
+
+        // Memory pages mapped from the operating system, for large blocks.
+        // Sizes are rounded up to whole pages, and the pages are zeroed.
+        class Mmap_allocator final {
+        public:
+            static constexpr std::int64_t id = type_id<Mmap_allocator>();
+            static constexpr bool is_thread_safe = true;
+            static constexpr Block<void>::Size_type min_alignment = page_size;
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0 || s > std::numeric_limits<Block<void>::Size_type>::max() - page_size) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                No_alloc_scope::on_system_allocation(s);
+#if defined(__linux__)
+                void* p = mmap(nullptr, static_cast<std::size_t>(good_size(s)), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+#else
+                void* p = std::aligned_alloc(static_cast<std::size_t>(page_size), static_cast<std::size_t>(good_size(s)));
+                if (!p) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+                std::memset(p, 0, static_cast<std::size_t>(good_size(s)));
+#endif
+                return observe_allocation(*this, s, Block<void>(s, p, id));
+            }
+
+            void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (b.empty()) {
+                    return;
+                }
+#if defined(__linux__)
+                munmap(b.data(), static_cast<std::size_t>(good_size(b.size())));
+#else
+                std::free(b.data());
+#endif
+                b = Block<void>();
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return b.data() && b.hint() == id;
+            }
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate_zeroed(Block<void>::Size_type s) noexcept
+            {
+                return allocate(s);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+            {
+                return (s + page_size - 1) & ~(page_size - 1);
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Mmap_allocator");
+            }
+        };
+
+        template <class T>
+        concept Stack_memory =
+            requires
+        {
+            std::is_default_constructible_v<T>;
+            std::is_copy_constructible_v<T>;
+            std::is_copy_assignable_v<T>;
+            std::is_move_constructible_v<T>;
+            std::is_move_assignable_v<T>;
+            std::is_destructible_v<T>;
+        }&&
+            requires (T t, Block<void>::Size_type s, void* p)
+        {
+            {t.stack_malloc(s)} noexcept -> std::same_as<void*>;
+            {t.stack_free(p, s)} noexcept -> std::same_as<void>;
+            {t.stack_owns(p)} noexcept -> std::same_as<bool>;
+        };
+
+        // Stacks in static storage, shared by all the instances of the same type.
+        // The stacks are constant initialized, so no initialization is required on construction.
+        template <std::int64_t Stacks_count, Block<void>::Size_type Buffer_size>
+        class Default_global_stack_memory final {
+            static_assert(Stacks_count > 0);
+            static_assert(Buffer_size > 1 && Buffer_size % 2 == 0);
+        public:
+            [[nodiscard]] constexpr void* stack_malloc(Block<void>::Size_type s) noexcept
+            {
+                for (std::int64_t i = 0; i < Stacks_count; ++i) {
+                    if (Buffer_size - offsets_[i] >= s) {
+                        void* tmp = buffers_[i] + offsets_[i];
+                        offsets_[i] += s;
+                        return tmp;
+                    }
+                }
+                return nullptr;
+            }
+
+            constexpr void stack_free(void* p, Block<void>::Size_type s) noexcept
+            {
+                for (std::int64_t i = 0; i < Stacks_count; ++i) {
+                    if (s <= offsets_[i] && p == buffers_[i] + offsets_[i] - s) {
+                        offsets_[i] -= s;
+                        break;
+                    }
+                }
+            }
+
+            // Resizes the top block of a stack.
+            [[nodiscard]] constexpr bool stack_expand(void* p, Block<void>::Size_type s, Block<void>::Size_type new_s) noexcept
+            {
+                for (std::int64_t i = 0; i < Stacks_count; ++i) {
+                    if (s <= offsets_[i] && p == buffers_[i] + offsets_[i] - s) {
+                        if (new_s < 0 || Buffer_size - (offsets_[i] - s) < new_s) {
+                            return false;
+                        }
+                        offsets_[i] += new_s - s;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // The stacks are contiguous, hence a single range check.
+            [[nodiscard]] constexpr bool stack_owns(void* p) const noexcept
+            {
+                const std::uint8_t* lp = reinterpret_cast<const std::uint8_t*>(p);
+                const std::uint8_t* first = reinterpret_cast<const std::uint8_t*>(buffers_);
+                return lp >= first && lp < first + sizeof(buffers_);
+            }
+
+            struct Marker {
+                Block<void>::Size_type offsets[Stacks_count]{};
+            };
+
+            [[nodiscard]] constexpr Marker stack_checkpoint() const noexcept
+            {
+                Marker m{};
+                for (std::int64_t i = 0; i < Stacks_count; ++i) {
+                    m.offsets[i] = offsets_[i];
+                }
+                return m;
+            }
+
+            // Releases everything allocated after the checkpoint, stacks that are already below it are not changed.
+            constexpr void stack_rollback(const Marker& m) noexcept
+            {
+                for (std::int64_t i = 0; i < Stacks_count; ++i) {
+                    if (offsets_[i] > m.offsets[i]) {
+                        offsets_[i] = m.offsets[i];
+                    }
+                }
+            }
+
+            // Touches the free pages of the stacks, up to s bytes in total.
+            Block<void>::Size_type stack_warm_up(Block<void>::Size_type s) noexcept
+            {
+                Block<void>::Size_type warmed = 0;
+                for (std::int64_t i = 0; i < Stacks_count && warmed < s; ++i) {
+                    const Block<void>::Size_type available = Buffer_size - offsets_[i];
+                    warmed += prefault(buffers_[i] + offsets_[i], available < s - warmed ? available : s - warmed);
+                }
+                return warmed;
+            }
+
+            // Bytes allocated from the stacks, and their total size.
+            [[nodiscard]] constexpr Block<void>::Size_type stack_used() const noexcept
+            {
+                Block<void>::Size_type used = 0;
+                for (std::int64_t i = 0; i < Stacks_count; ++i) {
+                    used += offsets_[i];
+                }
+                return used;
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type stack_capacity() const noexcept
+            {
+                return Stacks_count * Buffer_size;
+            }
+
+        private:
+            constinit inline static std::uint8_t buffers_[Stacks_count][Buffer_size]{};
+            constinit inline static Block<void>::Size_type offsets_[Stacks_count]{};
+        };
+
+        // A stack held by the memory object itself, usable in constant evaluation.
+        // Copies and moves start with an empty stack, since the blocks of the source are in its own buffer.
+        template <Block<void>::Size_type Buffer_size>
+        class Local_stack_memory final {
+            static_assert(Buffer_size > 1 && Buffer_size % 2 == 0);
+        public:
+            // The buffer is left uninitialized
+            constexpr Local_stack_memory() noexcept {}
+            constexpr Local_stack_memory(const Local_stack_memory&) noexcept
+                : Local_stack_memory() {}
+            constexpr Local_stack_memory& operator=(const Local_stack_memory& other) noexcept
+            {
+                if (this != &other) {
+                    offset_ = 0;
+                }
+                return *this;
+            }
+            constexpr Local_stack_memory(Local_stack_memory&&) noexcept
+                : Local_stack_memory() {}
+            constexpr Local_stack_memory& operator=(Local_stack_memory&& other) noexcept
+            {
+                if (this != &other) {
+                    offset_ = 0;
+                }
+                return *this;
+            }
+            constexpr ~Local_stack_memory() noexcept = default;
+
+            [[nodiscard]] constexpr void* stack_malloc(Block<void>::Size_type s) noexcept
+            {
+                if (Buffer_size - offset_ < s) {
+                    return nullptr;
+                }
+                void* tmp = buffer_ + offset_;
+                offset_ += s;
+                return tmp;
+            }
+
+            constexpr void stack_free(void* p, Block<void>::Size_type s) noexcept
+            {
+                if (s <= offset_ && p == buffer_ + offset_ - s) {
+                    offset_ -= s;
+                }
+            }
+
+            [[nodiscard]] constexpr bool stack_expand(void* p, Block<void>::Size_type s, Block<void>::Size_type new_s) noexcept
+            {
+                if (s > offset_ || p != buffer_ + offset_ - s || new_s < 0 || Buffer_size - (offset_ - s) < new_s) {
+                    return false;
+                }
+                offset_ += new_s - s;
+                return true;
+            }
+
+            [[nodiscard]] constexpr bool stack_owns(void* p) const noexcept
+            {
+                if (std::is_constant_evaluated()) {
+                    // Pointers to unrelated objects cannot be ordered in constant evaluation
+                    for (Block<void>::Size_type i = 0; i < Buffer_size; ++i) {
+                        if (p == buffer_ + i) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+                const std::uint8_t* lp = reinterpret_cast<const std::uint8_t*>(p);
+                return lp >= buffer_ && lp < buffer_ + Buffer_size;
+            }
+
+            struct Marker {
+                Block<void>::Size_type offset{ 0 };
+            };
+
+            [[nodiscard]] constexpr Marker stack_checkpoint() const noexcept
+            {
+                return { offset_ };
+            }
+
+            constexpr void stack_rollback(const Marker& m) noexcept
+            {
+                if (offset_ > m.offset) {
+                    offset_ = m.offset;
+                }
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type stack_used() const noexcept
+            {
+                return offset_;
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type stack_capacity() const noexcept
+            {
+                return Buffer_size;
+            }
+
+        private:
+            alignas(std::max_align_t) std::uint8_t buffer_[Buffer_size];
+            Block<void>::Size_type offset_{ 0 };
+        };
+
+        // Stacks allocated on construction, for stack sizes known at run time.
+        // A default constructed memory has no stacks. Copies allocate stacks of their own with the same parameters.
+        class Runtime_stack_memory final {
+        public:
+            struct Parameters {
+                std::int64_t stacks_count{ 1 };
+                Block<void>::Size_type buffer_size{ 0 };
+            };
+
+            Runtime_stack_memory() = default;
+            // Invalid parameters, or failure to allocate the stacks, result in a memory without stacks
+            explicit Runtime_stack_memory(const Parameters& parameters) noexcept
+            {
+                if (parameters.stacks_count <= 0 || parameters.buffer_size <= 1 || parameters.buffer_size % 2 != 0
+                    || parameters.buffer_size > (std::numeric_limits<Block<void>::Size_type>::max() - header_size(parameters.stacks_count)) / parameters.stacks_count) {
+                    return;
+                }
+                oc::Expected<Block<void>, Allocator_error> r = Malloc_allocator{}.allocate(
+                    header_size(parameters.stacks_count) + parameters.stacks_count * parameters.buffer_size);
+                if (!r) {
+                    return;
+                }
+                memory_ = r.value();
+                parameters_ = parameters;
+                offsets_ = static_cast<Block<void>::Size_type*>(memory_.data());
+                buffers_ = static_cast<std::uint8_t*>(memory_.data()) + header_size(parameters.stacks_count);
+                for (std::int64_t i = 0; i < parameters_.stacks_count; ++i) {
+                    offsets_[i] = 0;
+                }
+            }
+            Runtime_stack_memory(const Runtime_stack_memory& other) noexcept
+                : Runtime_stack_memory(other.parameters_) {}
+            Runtime_stack_memory& operator=(const Runtime_stack_memory& other) noexcept
+            {
+                if (this != &other) {
+                    *this = Runtime_stack_memory(other.parameters_);
+                }
+                return *this;
+            }
+            Runtime_stack_memory(Runtime_stack_memory&& other) noexcept
+                : parameters_(other.parameters_), memory_(other.memory_), offsets_(other.offsets_), buffers_(other.buffers_)
+            {
+                other.parameters_ = {};
+                other.memory_ = {};
+                other.offsets_ = nullptr;
+                other.buffers_ = nullptr;
+            }
+            Runtime_stack_memory& operator=(Runtime_stack_memory&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                Malloc_allocator{}.deallocate(memory_);
+                parameters_ = other.parameters_;
+                memory_ = other.memory_;
+                offsets_ = other.offsets_;
+                buffers_ = other.buffers_;
+                other.parameters_ = {};
+                other.memory_ = {};
+                other.offsets_ = nullptr;
+                other.buffers_ = nullptr;
+                return *this;
+            }
+            ~Runtime_stack_memory() noexcept
+            {
+                Malloc_allocator{}.deallocate(memory_);
+            }
+
+            [[nodiscard]] void* stack_malloc(Block<void>::Size_type s) noexcept
+            {
+                for (std::int64_t i = 0; i < stacks_count(); ++i) {
+                    if (parameters_.buffer_size - offsets_[i] >= s) {
+                        void* tmp = buffer(i) + offsets_[i];
+                        offsets_[i] += s;
+                        return tmp;
+                    }
+                }
+                return nullptr;
+            }
+
+            void stack_free(void* p, Block<void>::Size_type s) noexcept
+            {
+                for (std::int64_t i = 0; i < stacks_count(); ++i) {
+                    if (s <= offsets_[i] && p == buffer(i) + offsets_[i] - s) {
+                        offsets_[i] -= s;
+                        break;
+                    }
+                }
+            }
+
+            [[nodiscard]] bool stack_expand(void* p, Block<void>::Size_type s, Block<void>::Size_type new_s) noexcept
+            {
+                for (std::int64_t i = 0; i < stacks_count(); ++i) {
+                    if (s <= offsets_[i] && p == buffer(i) + offsets_[i] - s) {
+                        if (new_s < 0 || parameters_.buffer_size - (offsets_[i] - s) < new_s) {
+                            return false;
+                        }
+                        offsets_[i] += new_s - s;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // The stacks are contiguous, hence a single range check.
+            [[nodiscard]] bool stack_owns(void* p) const noexcept
+            {
+                const std::uint8_t* lp = reinterpret_cast<const std::uint8_t*>(p);
+                return buffers_ && lp >= buffers_ && lp < buffers_ + stacks_count() * parameters_.buffer_size;
+            }
+
+            Block<void>::Size_type stack_warm_up(Block<void>::Size_type s) noexcept
+            {
+                Block<void>::Size_type warmed = 0;
+                for (std::int64_t i = 0; i < stacks_count() && warmed < s; ++i) {
+                    const Block<void>::Size_type available = parameters_.buffer_size - offsets_[i];
+                    warmed += prefault(buffer(i) + offsets_[i], available < s - warmed ? available : s - warmed);
+                }
+                return warmed;
+            }
+
+            [[nodiscard]] const Parameters& parameters() const noexcept
+            {
+                return parameters_;
+            }
+
+            [[nodiscard]] Block<void>::Size_type stack_used() const noexcept
+            {
+                Block<void>::Size_type used = 0;
+                for (std::int64_t i = 0; i < stacks_count(); ++i) {
+                    used += offsets_[i];
+                }
+                return used;
+            }
+
+            [[nodiscard]] Block<void>::Size_type stack_capacity() const noexcept
+            {
+                return stacks_count() * parameters_.buffer_size;
+            }
+
+        private:
+            static constexpr Block<void>::Size_type header_size(std::int64_t stacks_count) noexcept
+            {
+                const Block<void>::Size_type alignment = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+                return (stacks_count * MEMOC_SSIZEOF(Block<void>::Size_type) + alignment - 1) & ~(alignment - 1);
+            }
+
+            [[nodiscard]] std::int64_t stacks_count() const noexcept
+            {
+                return buffers_ ? parameters_.stacks_count : 0;
+            }
+
+            [[nodiscard]] std::uint8_t* buffer(std::int64_t i) const noexcept
+            {
+                return buffers_ + i * parameters_.buffer_size;
+            }
+
+            Parameters parameters_{};
+            Block<void> memory_{};
+            Block<void>::Size_type* offsets_{ nullptr };
+            std::uint8_t* buffers_{ nullptr };
+        };
+
+        // A single stack in constant initialized static storage, shared by all the arenas with the same size and id.
+        template <Block<void>::Size_type Bytes, std::int64_t Id = 0>
+        class Static_arena final {
+            static_assert(Bytes > 1 && Bytes % 2 == 0);
+        public:
+            static constexpr Block<void>::Size_type capacity = Bytes;
+
+            [[nodiscard]] constexpr void* stack_malloc(Block<void>::Size_type s) noexcept
+            {
+                if (Bytes - offset_ < s) {
+                    return nullptr;
+                }
+                void* tmp = buffer_ + offset_;
+                offset_ += s;
+                return tmp;
+            }
+
+            constexpr void stack_free(void* p, Block<void>::Size_type s) noexcept
+            {
+                if (s <= offset_ && p == buffer_ + offset_ - s) {
+                    offset_ -= s;
+                }
+            }
+
+            [[nodiscard]] constexpr bool stack_expand(void* p, Block<void>::Size_type s, Block<void>::Size_type new_s) noexcept
+            {
+                if (s > offset_ || p != buffer_ + offset_ - s || new_s < 0 || Bytes - (offset_ - s) < new_s) {
+                    return false;
+                }
+                offset_ += new_s - s;
+                return true;
+            }
+
+            [[nodiscard]] constexpr bool stack_owns(void* p) const noexcept
+            {
+                const std::uint8_t* lp = reinterpret_cast<const std::uint8_t*>(p);
+                return lp >= buffer_ && lp < buffer_ + Bytes;
+            }
+
+            struct Marker {
+                Block<void>::Size_type offset{ 0 };
+            };
+
+            [[nodiscard]] constexpr Marker stack_checkpoint() const noexcept
+            {
+                return { offset_ };
+            }
+
+            constexpr void stack_rollback(const Marker& m) noexcept
+            {
+                if (offset_ > m.offset) {
+                    offset_ = m.offset;
+                }
+            }
+
+            Block<void>::Size_type stack_warm_up(Block<void>::Size_type s) noexcept
+            {
+                const Block<void>::Size_type available = Bytes - offset_;
+                return prefault(buffer_ + offset_, available < s ? available : s);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type stack_used() const noexcept
+            {
+                return offset_;
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type stack_capacity() const noexcept
+            {
+                return Bytes;
+            }
+
+        private:
+            alignas(std::max_align_t) constinit inline static std::uint8_t buffer_[Bytes]{};
+            constinit inline static Block<void>::Size_type offset_{ 0 };
+        };
+
+        // Enough memory for one allocation of each of the types by a Stack_allocator.
+        template <typename ...Ts>
+        [[nodiscard]] consteval Block<void>::Size_type static_arena_size() noexcept
+        {
+            return ((MEMOC_SSIZEOF(Ts) % 2 == 0 ? MEMOC_SSIZEOF(Ts) : MEMOC_SSIZEOF(Ts) + 1) + ... + 0);
+        }
+
+        template <typename ...Ts>
+            requires (sizeof...(Ts) > 0)
+        using Static_arena_for = Static_arena<static_arena_size<Ts...>()>;
+
+        template <Stack_memory Internal_stack_memory = Default_global_stack_memory<16, 128>>
+        class Stack_allocator final {
+        public:
+            static constexpr std::int64_t id = type_id<Stack_allocator>();
+            static constexpr bool is_stateless = std::is_empty_v<Internal_stack_memory>;
+
+            constexpr Stack_allocator() = default;
+            constexpr explicit Stack_allocator(Internal_stack_memory sm) noexcept
+                : sm_(std::move(sm)) {}
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                void* p = sm_.stack_malloc(align(s));
+                if (!p) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+                return observe_allocation(*this, s, Block<void>(s, p, id));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                sm_.stack_free(b.data(), align(b.size()));
+                b = {};
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return sm_.stack_owns(b.data());
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+            {
+                return s > 0 ? align(s) : s;
+            }
+
+            // Only the last allocated block can be expanded, if supported by the stack memory.
+            [[nodiscard]] constexpr bool expand(Block<void>& b, Block<void>::Size_type delta) noexcept
+                requires requires (Internal_stack_memory& sm, void* p, Block<void>::Size_type s) { {sm.stack_expand(p, s, s)} noexcept -> std::same_as<bool>; }
+            {
+                if (b.empty() || b.size() + delta <= 0) {
+                    return false;
+                }
+                if (!sm_.stack_expand(b.data(), align(b.size()), align(b.size() + delta))) {
+                    return false;
+                }
+                b = Block<void>(b.size() + delta, b.data(), b.hint());
+                return true;
+            }
+
+            // Checkpoint and rollback are available if supported by the stack memory.
+            // A rollback releases all the allocations made after the checkpoint, whatever the order of their deallocation.
+            [[nodiscard]] constexpr auto checkpoint() const noexcept
+                requires requires (const Internal_stack_memory& sm) { {sm.stack_checkpoint()} noexcept; }
+            {
+                return sm_.stack_checkpoint();
+            }
+
+            template <typename Marker>
+                requires requires (Internal_stack_memory& sm, const Marker& m) { {sm.stack_rollback(m)} noexcept; }
+            constexpr void rollback(const Marker& m) noexcept
+            {
+                sm_.stack_rollback(m);
+            }
+
+            // Prefaults up to s bytes of the free stack memory, if supported by the stack memory.
+            constexpr std::int64_t warm_up(Block<void>::Size_type s) noexcept
+            {
+                if constexpr (requires { {sm_.stack_warm_up(s)} noexcept -> std::same_as<Block<void>::Size_type>; }) {
+                    return sm_.stack_warm_up(s);
+                }
+                else {
+                    return 0;
+                }
+            }
+
+            // The usage is reported if supported by the stack memory.
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Stack_allocator");
+                if constexpr (requires { {sm_.stack_used()} noexcept; {sm_.stack_capacity()} noexcept; }) {
+                    v.parameter("capacity", sm_.stack_capacity());
+                    v.usage({ .bytes_in_use = sm_.stack_used() });
+                }
+            }
+
+        private:
+            static constexpr Block<void>::Size_type align(Block<void>::Size_type s)
+            {
+                return s % 2 == 0 ? s : s + 1;
+            }
+
+            Internal_stack_memory sm_{};
+        };
+
+        // Rolls back a stack allocator to its state at the scope construction.
+        // The allocator should outlive the scope.
+        template <Allocator Internal_allocator>
+            requires requires (Internal_allocator a) { a.rollback(a.checkpoint()); }
+        class Stack_scope final {
+        public:
+            using Marker = decltype(std::declval<const Internal_allocator&>().checkpoint());
+
+            constexpr explicit Stack_scope(Internal_allocator& allocator) noexcept
+                : allocator_(allocator), marker_(allocator.checkpoint()) {}
+            Stack_scope(const Stack_scope&) = delete;
+            Stack_scope& operator=(const Stack_scope&) = delete;
+            Stack_scope(Stack_scope&&) = delete;
+            Stack_scope& operator=(Stack_scope&&) = delete;
+            constexpr ~Stack_scope() noexcept
+            {
+                allocator_.rollback(marker_);
+            }
+
+            [[nodiscard]] constexpr const Marker& marker() const noexcept
+            {
+                return marker_;
+            }
+
+        private:
+            Internal_allocator& allocator_;
+            Marker marker_;
+        };
+
+        enum class Stack_end {
+            bottom,
+            top
+        };
+
+        // Two stacks that grow towards each other in a single region, e.g. retained blocks from the bottom and scratch blocks from the top.
+        // Each end is reset independently and an allocation fails when the ends would collide.
+        // Allocations are aligned relative to the beginning of the internal allocator's block.
+        template <Allocator Internal_allocator>
+        class Double_ended_stack_allocator final {
+        public:
+            static constexpr Block<void>::Size_type default_size = 4096;
+
+            // Allocator of a single end, to be used where an allocator of a specific lifetime is expected.
+            // The double ended stack allocator should outlive it.
+            template <Stack_end End>
+            class End_allocator final {
+            public:
+                constexpr End_allocator() = default;
+                constexpr explicit End_allocator(Double_ended_stack_allocator& stack) noexcept
+                    : stack_(&stack) {}
+
+                [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+                {
+                    if (!stack_) {
+                        return oc::Unexpected(Allocator_error::out_of_memory);
+                    }
+                    return stack_->allocate(s, End);
+                }
+
+                constexpr void deallocate(Block<void>& b) noexcept
+                {
+                    if (stack_) {
+                        stack_->deallocate(b);
+                    }
+                }
+
+                [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+                {
+                    return stack_ && stack_->owns(b, End);
+                }
+
+                void visit(Allocator_visitor& v) const
+                {
+                    v.type(End == Stack_end::bottom ? "Bottom_allocator" : "Top_allocator");
+                    if (stack_) {
+                        v.usage({ .bytes_in_use = stack_->used(End) });
+                    }
+                }
+
+            private:
+                Double_ended_stack_allocator* stack_{ nullptr };
+            };
+
+            using Bottom_allocator = End_allocator<Stack_end::bottom>;
+            using Top_allocator = End_allocator<Stack_end::top>;
+
+            struct Marker {
+                Block<void>::Size_type bottom{ 0 };
+                Block<void>::Size_type top{ 0 };
+            };
+
+            constexpr explicit Double_ended_stack_allocator(Block<void>::Size_type size = default_size) noexcept
+                : size_(size > 0 ? align(size) : 0)
+            {
+                allocate_region();
+            }
+            constexpr Double_ended_stack_allocator(const Double_ended_stack_allocator& other) noexcept
+                : internal_(other.internal_), size_(other.size_)
+            {
+                allocate_region();
+            }
+            constexpr Double_ended_stack_allocator& operator=(const Double_ended_stack_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release_region();
+                internal_ = other.internal_;
+                size_ = other.size_;
+                allocate_region();
+                return *this;
+            }
+            constexpr Double_ended_stack_allocator(Double_ended_stack_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), size_(other.size_), region_(other.region_), bottom_(other.bottom_), top_(other.top_)
+            {
+                other.region_ = {};
+                other.bottom_ = other.top_ = 0;
+            }
+            constexpr Double_ended_stack_allocator& operator=(Double_ended_stack_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release_region();
+                internal_ = std::move(other.internal_);
+                size_ = other.size_;
+                region_ = other.region_;
+                bottom_ = other.bottom_;
+                top_ = other.top_;
+                other.region_ = {};
+                other.bottom_ = other.top_ = 0;
+                return *this;
+            }
+            constexpr ~Double_ended_stack_allocator() noexcept
+            {
+                release_region();
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                return allocate(s, Stack_end::bottom);
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, Stack_end end) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                const Block<void>::Size_type as = align(s);
+                if (as > top_ - bottom_) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+                if (end == Stack_end::bottom) {
+                    void* p = begin() + bottom_;
+                    bottom_ += as;
+                    return observe_allocation(*this, s, Block<void>(s, p));
+                }
+                top_ -= as;
+                return observe_allocation(*this, s, Block<void>(s, begin() + top_));
+            }
+
+            // Memory is reclaimed only for the last allocation of each end, otherwise when the end is reset.
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (!b.empty() && !region_.empty()) {
+                    const Block<void>::Size_type as = align(b.size());
+                    if (b.data() == begin() + bottom_ - as) {
+                        bottom_ -= as;
+                    }
+                    else if (b.data() == begin() + top_) {
+                        top_ += as;
+                    }
+                }
+                b = {};
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                const std::uint8_t* p = static_cast<const std::uint8_t*>(b.data());
+                return p && !region_.empty() && p >= begin() && p < begin() + size_;
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b, Stack_end end) const noexcept
+            {
+                const std::uint8_t* p = static_cast<const std::uint8_t*>(b.data());
+                if (!p || region_.empty()) {
+                    return false;
+                }
+                return end == Stack_end::bottom ? (p >= begin() && p < begin() + bottom_) : (p >= begin() + top_ && p < begin() + size_);
+            }
+
+            constexpr void reset(Stack_end end) noexcept
+            {
+                if (end == Stack_end::bottom) {
+                    bottom_ = 0;
+                }
+                else {
+                    top_ = region_.empty() ? 0 : size_;
+                }
+            }
+
+            constexpr void reset() noexcept
+            {
+                reset(Stack_end::bottom);
+                reset(Stack_end::top);
+            }
+
+            [[nodiscard]] constexpr Marker checkpoint() const noexcept
+            {
+                return { bottom_, top_ };
+            }
+
+            // Releases everything allocated after the checkpoint, ends that are already below it are not changed.
+            constexpr void rollback(const Marker& m) noexcept
+            {
+                if (bottom_ > m.bottom) {
+                    bottom_ = m.bottom;
+                }
+                if (top_ < m.top) {
+                    top_ = m.top;
+                }
+            }
+
+            constexpr std::int64_t warm_up(Block<void>::Size_type s) noexcept
+            {
+                return prefault(region_.data(), s < region_.size() ? s : region_.size());
+            }
+
+            [[nodiscard]] constexpr Bottom_allocator bottom() noexcept
+            {
+                return Bottom_allocator{ *this };
+            }
+
+            [[nodiscard]] constexpr Top_allocator top() noexcept
+            {
+                return Top_allocator{ *this };
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type size() const noexcept
+            {
+                return region_.empty() ? 0 : size_;
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type used(Stack_end end) const noexcept
+            {
+                return end == Stack_end::bottom ? bottom_ : size() - top_;
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type available() const noexcept
+            {
+                return top_ - bottom_;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Double_ended_stack_allocator");
+                v.parameter("size", size());
+                v.usage({ .bytes_in_use = used(Stack_end::bottom) + used(Stack_end::top), .bytes_cached = available() });
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            static constexpr Block<void>::Size_type alignment_ = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+
+            static constexpr Block<void>::Size_type align(Block<void>::Size_type s) noexcept
+            {
+                return (s + alignment_ - 1) / alignment_ * alignment_;
+            }
+
+            constexpr std::uint8_t* begin() const noexcept
+            {
+                return static_cast<std::uint8_t*>(region_.data());
+            }
+
+            constexpr void allocate_region() noexcept
+            {
+                if (size_ == 0) {
+                    return;
+                }
+                if (oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(size_)) {
+                    region_ = r.value();
+                }
+                reset();
+            }
+
+            constexpr void release_region() noexcept
+            {
+                if (!region_.empty()) {
+                    internal_.deallocate(region_);
+                }
+                region_ = {};
+                reset();
+            }
+
+            Internal_allocator internal_{};
+            Block<void>::Size_type size_{ 0 };
+            Block<void> region_{};
+
+            Block<void>::Size_type bottom_{ 0 };
+            Block<void>::Size_type top_{ 0 };
+        };
+
+        // Rotating bump arenas for tick based workloads, each arena serves a single frame.
+        // Memory allocated during a frame is valid for Frames_count - 1 more frames, until its arena is reused.
+        // Allocations are aligned relative to the beginning of the internal allocator's block.
+        // Frame sizes above max_frame_size, for which the frames size overflows, are invalid and leave the allocator without memory.
+        template <Allocator Internal_allocator, std::int64_t Frames_count = 2>
+        class Frame_allocator final {
+            static_assert(Frames_count > 1);
+        public:
+            static constexpr Block<void>::Size_type default_frame_size = 4096;
+
+            constexpr explicit Frame_allocator(Block<void>::Size_type frame_size = default_frame_size) noexcept
+                : frame_size_(frame_size > 0 && frame_size <= max_frame_size ? align(frame_size) : 0)
+            {
+                allocate_frames();
+            }
+            constexpr Frame_allocator(const Frame_allocator& other) noexcept
+                : internal_(other.internal_), frame_size_(other.frame_size_)
+            {
+                allocate_frames();
+            }
+            constexpr Frame_allocator& operator=(const Frame_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release_frames();
+                internal_ = other.internal_;
+                frame_size_ = other.frame_size_;
+                allocate_frames();
+                return *this;
+            }
+            constexpr Frame_allocator(Frame_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), frame_size_(other.frame_size_), frames_(other.frames_),
+                current_(other.current_), frame_number_(other.frame_number_), high_water_mark_(other.high_water_mark_)
+            {
+                for (std::int64_t i = 0; i < Frames_count; ++i) {
+                    offsets_[i] = other.offsets_[i];
+                    frame_high_water_marks_[i] = other.frame_high_water_marks_[i];
+                }
+                other.frames_ = {};
+                other.reset();
+            }
+            constexpr Frame_allocator& operator=(Frame_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release_frames();
+                internal_ = std::move(other.internal_);
+                frame_size_ = other.frame_size_;
+                frames_ = other.frames_;
+                current_ = other.current_;
+                frame_number_ = other.frame_number_;
+                high_water_mark_ = other.high_water_mark_;
+                for (std::int64_t i = 0; i < Frames_count; ++i) {
+                    offsets_[i] = other.offsets_[i];
+                    frame_high_water_marks_[i] = other.frame_high_water_marks_[i];
+                }
+                other.frames_ = {};
+                other.reset();
+                return *this;
+            }
+            constexpr ~Frame_allocator() noexcept
+            {
+                release_frames();
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                const Block<void>::Size_type as = align(s);
+                if (frames_.empty() || as > frame_size_ - offsets_[current_]) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+                void* p = frame_begin(current_) + offsets_[current_];
+                offsets_[current_] += as;
+                if (offsets_[current_] > frame_high_water_marks_[current_]) {
+                    frame_high_water_marks_[current_] = offsets_[current_];
+                    if (offsets_[current_] > high_water_mark_) {
+                        high_water_mark_ = offsets_[current_];
+                    }
+                }
+                return observe_allocation(*this, s, Block<void>(s, p));
+            }
+
+            // Memory is reclaimed only for the last allocation of the current frame, otherwise when the frame is reused.
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (!b.empty() && !frames_.empty() && b.data() == frame_begin(current_) + offsets_[current_] - align(b.size())) {
+                    offsets_[current_] -= align(b.size());
+                }
+                b = {};
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                const std::uint8_t* p = static_cast<const std::uint8_t*>(b.data());
+                const std::uint8_t* first = static_cast<const std::uint8_t*>(frames_.data());
+                return p && first && p >= first && p < first + frames_.size();
+            }
+
+            // Moves to the next frame, the arena of the oldest frame is reset and reused.
+            constexpr void advance_frame() noexcept
+            {
+                current_ = (current_ + 1) % Frames_count;
+                offsets_[current_] = 0;
+                frame_high_water_marks_[current_] = 0;
+                ++frame_number_;
+            }
+
+            // Resets all the frames, their numbering and high water marks, any memory allocated before is no longer valid.
+            constexpr void reset() noexcept
+            {
+                for (std::int64_t i = 0; i < Frames_count; ++i) {
+                    offsets_[i] = 0;
+                    frame_high_water_marks_[i] = 0;
+                }
+                current_ = 0;
+                frame_number_ = 0;
+                high_water_mark_ = 0;
+            }
+
+            constexpr std::int64_t warm_up(Block<void>::Size_type s) noexcept
+            {
+                return prefault(frames_.data(), s < frames_.size() ? s : frames_.size());
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type frame_size() const noexcept
+            {
+                return frame_size_;
+            }
+
+            [[nodiscard]] constexpr std::int64_t frame_number() const noexcept
+            {
+                return frame_number_;
+            }
+
+            // Bytes currently in use by the current frame.
+            [[nodiscard]] constexpr Block<void>::Size_type used() const noexcept
+            {
+                return offsets_[current_];
+            }
+
+            // The maximal number of bytes used by the frame that started 'age' frames ago, 0 is the current frame.
+            [[nodiscard]] constexpr Block<void>::Size_type frame_high_water_mark(std::int64_t age = 0) const noexcept
+            {
+                if (age < 0 || age >= Frames_count || age > frame_number_) {
+                    return 0;
+                }
+                return frame_high_water_marks_[(current_ - age + Frames_count) % Frames_count];
+            }
+
+            // The maximal number of bytes used by any of the frames.
+            [[nodiscard]] constexpr Block<void>::Size_type high_water_mark() const noexcept
+            {
+                return high_water_mark_;
+            }
+
+            // Bytes in use are the ones of all the frames whose memory is still valid.
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Frame_allocator");
+                v.parameter("frames_count", Frames_count);
+                v.parameter("frame_size", frames_.empty() ? 0 : frame_size_);
+                v.parameter("high_water_mark", high_water_mark_);
+                Block<void>::Size_type used = 0;
+                for (std::int64_t i = 0; i < Frames_count; ++i) {
+                    used += offsets_[i];
+                }
+                v.usage({ .bytes_in_use = used });
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            static constexpr Block<void>::Size_type alignment_ = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+
+        public:
+            // A multiple of the alignment, so aligned frame sizes up to it do not overflow the frames size.
+            static constexpr Block<void>::Size_type max_frame_size = std::numeric_limits<Block<void>::Size_type>::max() / Frames_count / alignment_ * alignment_;
+
+        private:
+            static constexpr Block<void>::Size_type align(Block<void>::Size_type s) noexcept
+            {
+                return (s + alignment_ - 1) / alignment_ * alignment_;
+            }
+
+            constexpr std::uint8_t* frame_begin(std::int64_t i) const noexcept
+            {
+                return static_cast<std::uint8_t*>(frames_.data()) + i * frame_size_;
+            }
+
+            constexpr void allocate_frames() noexcept
+            {
+                if (frame_size_ == 0) {
+                    return;
+                }
+                if (oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(frame_size_ * Frames_count)) {
+                    frames_ = r.value();
+                }
+            }
+
+            constexpr void release_frames() noexcept
+            {
+                if (!frames_.empty()) {
+                    internal_.deallocate(frames_);
+                }
+                frames_ = {};
+                reset();
+            }
+
+            Internal_allocator internal_{};
+            Block<void>::Size_type frame_size_{ 0 };
+            Block<void> frames_{};
+
+            Block<void>::Size_type offsets_[Frames_count]{};
+            Block<void>::Size_type frame_high_water_marks_[Frames_count]{};
+            std::int64_t current_{ 0 };
+            std::int64_t frame_number_{ 0 };
+            Block<void>::Size_type high_water_mark_{ 0 };
+        };
+
+        // A circular region for blocks that are released roughly in their allocation order.
+        // Blocks are allocated at the head and released from the tail, blocks released out of order are marked
+        // in a side bitmap and reclaimed when the tail reaches them. A block that does not fit before the end of
+        // the region is allocated from its beginning, it is never split.
+        // Each block is preceded by a header of a single granule that holds its size.
+        template <Allocator Internal_allocator>
+        class Ring_allocator final {
+        public:
+            static constexpr Block<void>::Size_type default_capacity = 4096;
+
+            constexpr explicit Ring_allocator(Block<void>::Size_type capacity = default_capacity) noexcept
+                : granules_(capacity > 0 ? (capacity + granule_size_ - 1) / granule_size_ : 0)
+            {
+                allocate_region();
+            }
+            constexpr Ring_allocator(const Ring_allocator& other) noexcept
+                : internal_(other.internal_), granules_(other.granules_)
+            {
+                allocate_region();
+            }
+            constexpr Ring_allocator& operator=(const Ring_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release_region();
+                internal_ = other.internal_;
+                granules_ = other.granules_;
+                allocate_region();
+                return *this;
+            }
+            constexpr Ring_allocator(Ring_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), granules_(other.granules_), region_(other.region_), bitmap_(other.bitmap_),
+                head_(other.head_), tail_(other.tail_), used_(other.used_)
+            {
+                other.region_ = other.bitmap_ = {};
+                other.head_ = other.tail_ = other.used_ = 0;
+            }
+            constexpr Ring_allocator& operator=(Ring_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release_region();
+                internal_ = std::move(other.internal_);
+                granules_ = other.granules_;
+                region_ = other.region_;
+                bitmap_ = other.bitmap_;
+                head_ = other.head_;
+                tail_ = other.tail_;
+                used_ = other.used_;
+                other.region_ = other.bitmap_ = {};
+                other.head_ = other.tail_ = other.used_ = 0;
+                return *this;
+            }
+            constexpr ~Ring_allocator() noexcept
+            {
+                release_region();
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                const std::int64_t n = 1 + (s + granule_size_ - 1) / granule_size_;
+                if (region_.empty() || n > granules_ - used_) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+
+                std::int64_t at = head_;
+                if (head_ >= tail_ && n > granules_ - head_) {
+                    // Not enough space before the end of the region, the rest of it is skipped as an already released block.
+                    if (n > tail_) {
+                        return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                    }
+                    header(head_) = granules_ - head_;
+                    mark(head_);
+                    used_ += granules_ - head_;
+                    at = 0;
+                }
+                else if (head_ < tail_ && n > tail_ - head_) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+
+                header(at) = n;
+                head_ = (at + n) % granules_;
+                used_ += n;
+                return observe_allocation(*this, s, Block<void>(s, granule(at + 1)));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (!owns(b)) {
+                    return;
+                }
+                mark((static_cast<std::uint8_t*>(b.data()) - granule(0)) / granule_size_ - 1);
+                b = {};
+
+                while (used_ > 0 && marked(tail_)) {
+                    unmark(tail_);
+                    const std::int64_t n = header(tail_);
+                    tail_ = (tail_ + n) % granules_;
+                    used_ -= n;
+                }
+                if (used_ == 0) {
+                    head_ = tail_ = 0;
+                }
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                const std::uint8_t* p = static_cast<const std::uint8_t*>(b.data());
+                return p && !region_.empty() && p >= granule(0) && p < granule(granules_);
+            }
+
+            constexpr std::int64_t warm_up(Block<void>::Size_type s) noexcept
+            {
+                return prefault(region_.data(), s < region_.size() ? s : region_.size());
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type capacity() const noexcept
+            {
+                return region_.empty() ? 0 : granules_ * granule_size_;
+            }
+
+            // Bytes between the tail and the head, including headers, padding and blocks that wait for the tail.
+            [[nodiscard]] constexpr Block<void>::Size_type used() const noexcept
+            {
+                return used_ * granule_size_;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Ring_allocator");
+                v.parameter("capacity", capacity());
+                v.usage({ .bytes_in_use = used(), .bytes_cached = capacity() - used(), .bytes_overhead = bitmap_.empty() ? 0 : bitmap_.size() });
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            static constexpr Block<void>::Size_type granule_size_ = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+            static_assert(granule_size_ >= MEMOC_SSIZEOF(std::int64_t));
+
+            constexpr std::uint8_t* granule(std::int64_t i) const noexcept
+            {
+                return static_cast<std::uint8_t*>(region_.data()) + i * granule_size_;
+            }
+
+            constexpr std::int64_t& header(std::int64_t i) const noexcept
+            {
+                return *reinterpret_cast<std::int64_t*>(granule(i));
+            }
+
+            constexpr std::uint64_t* bits() const noexcept
+            {
+                return static_cast<std::uint64_t*>(bitmap_.data());
+            }
+
+            constexpr void mark(std::int64_t i) noexcept
+            {
+                bits()[i / 64] |= (std::uint64_t{ 1 } << (i % 64));
+            }
+
+            constexpr void unmark(std::int64_t i) noexcept
+            {
+                bits()[i / 64] &= ~(std::uint64_t{ 1 } << (i % 64));
+            }
+
+            [[nodiscard]] constexpr bool marked(std::int64_t i) const noexcept
+            {
+                return (bits()[i / 64] >> (i % 64)) & 1;
+            }
+
+            constexpr void allocate_region() noexcept
+            {
+                if (granules_ == 0) {
+                    return;
+                }
+                oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(granules_ * granule_size_);
+                if (!r || r.value().empty()) {
+                    return;
+                }
+                oc::Expected<Block<void>, Allocator_error> rb = internal_.allocate((granules_ + 63) / 64 * MEMOC_SSIZEOF(std::uint64_t));
+                if (!rb || rb.value().empty()) {
+                    Block<void> b = r.value();
+                    internal_.deallocate(b);
+                    return;
+                }
+                region_ = r.value();
+                bitmap_ = rb.value();
+                set(bitmap_, std::uint64_t{ 0 });
+            }
+
+            constexpr void release_region() noexcept
+            {
+                if (!bitmap_.empty()) {
+                    internal_.deallocate(bitmap_);
+                }
+                if (!region_.empty()) {
+                    internal_.deallocate(region_);
+                }
+                region_ = bitmap_ = {};
+                head_ = tail_ = used_ = 0;
+            }
+
+            Internal_allocator internal_{};
+            std::int64_t granules_{ 0 };
+            Block<void> region_{};
+            Block<void> bitmap_{};
+
+            std::int64_t head_{ 0 };
+            std::int64_t tail_{ 0 };
+            std::int64_t used_{ 0 };
+        };
+
+        // Bump allocation from chunks of the internal allocator, for blocks that are released together.
+        // Deallocation is a no-op, the chunks are released when the allocator is destructed.
+        // Blocks larger than a chunk are allocated in chunks of their own. Copies start without chunks.
+        template <Allocator Internal_allocator, Block<void>::Size_type Chunk_size = 64 * 1024>
+        class Monotonic_allocator final {
+            static_assert(Chunk_size > 0);
+        public:
+            static constexpr std::int64_t id = type_id<Monotonic_allocator>();
+            static constexpr Block<void>::Size_type min_alignment = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+
+            constexpr Monotonic_allocator() = default;
+            constexpr Monotonic_allocator(const Monotonic_allocator& other) noexcept
+                : internal_(other.internal_) {}
+            constexpr Monotonic_allocator& operator=(const Monotonic_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release();
+                internal_ = other.internal_;
+                return *this;
+            }
+            constexpr Monotonic_allocator(Monotonic_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), chunks_(other.chunks_), top_(other.top_), end_(other.end_)
+            {
+                other.chunks_ = nullptr;
+                other.top_ = other.end_ = nullptr;
+            }
+            constexpr Monotonic_allocator& operator=(Monotonic_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release();
+                internal_ = std::move(other.internal_);
+                chunks_ = other.chunks_;
+                top_ = other.top_;
+                end_ = other.end_;
+                other.chunks_ = nullptr;
+                other.top_ = other.end_ = nullptr;
+                return *this;
+            }
+            constexpr ~Monotonic_allocator() noexcept
+            {
+                release();
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0 || s > std::numeric_limits<Block<void>::Size_type>::max() - Chunk_size - header_size_) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+
+                const Block<void>::Size_type as = align(s);
+                if (!top_ || end_ - top_ < as) {
+                    const Block<void>::Size_type cs = as + header_size_ > Chunk_size ? as + header_size_ : Chunk_size;
+                    oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(cs);
+                    if (!r) {
+                        return observe_allocation(*this, s, r);
+                    }
+                    Chunk* c = static_cast<Chunk*>(r.value().data());
+                    c->block = r.value();
+                    c->next = chunks_;
+                    chunks_ = c;
+                    top_ = static_cast<std::uint8_t*>(r.value().data()) + header_size_;
+                    end_ = static_cast<std::uint8_t*>(r.value().data()) + cs;
+                }
+
+                void* p = top_;
+                top_ += as;
+                return observe_allocation(*this, s, Block<void>(s, p, id));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                b = Block<void>();
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return b.data() && b.hint() == id;
+            }
+
+            // Bytes in use include the unused ends of the previous chunks, which are not reused.
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Monotonic_allocator");
+                v.parameter("chunk_size", Chunk_size);
+                Allocator_usage u{ .bytes_in_use = 0, .bytes_cached = end_ - top_, .bytes_overhead = 0 };
+                for (const Chunk* c = chunks_; c; c = c->next) {
+                    u.bytes_in_use += c->block.size() - header_size_;
+                    u.bytes_overhead += header_size_;
+                }
+                u.bytes_in_use -= u.bytes_cached;
+                v.usage(u);
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            struct Chunk {
+                Block<void> block{};
+                Chunk* next{ nullptr };
+            };
+
+            static constexpr Block<void>::Size_type alignment_ = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+            static constexpr Block<void>::Size_type header_size_ = (MEMOC_SSIZEOF(Chunk) + alignment_ - 1) & ~(alignment_ - 1);
+
+            static constexpr Block<void>::Size_type align(Block<void>::Size_type s) noexcept
+            {
+                return (s + alignment_ - 1) & ~(alignment_ - 1);
+            }
+
+            constexpr void release() noexcept
+            {
+                while (chunks_) {
+                    Chunk* n = chunks_->next;
+                    Block<void> b = chunks_->block;
+                    internal_.deallocate(b);
+                    chunks_ = n;
+                }
+                top_ = end_ = nullptr;
+            }
+
+            Internal_allocator internal_{};
+            Chunk* chunks_{ nullptr };
+            std::uint8_t* top_{ nullptr };
+            std::uint8_t* end_{ nullptr };
+        };
+
+        template <
+            Allocator Internal_allocator,
+            Block<void>::Size_type Min_size, Block<void>::Size_type Max_size, std::int64_t Max_list_size>
+            class Free_list_allocator final {
+            static_assert(Min_size > 1 && Min_size % 2 == 0);
+            static_assert(Max_size > 1 && Max_size % 2 == 0);
+            static_assert(Max_list_size > 0);
+            public:
+                constexpr Free_list_allocator() = default;
+                constexpr Free_list_allocator(const Free_list_allocator& other) noexcept
+                    : internal_(other.internal_), root_(nullptr), list_size_(0) {}
+                constexpr Free_list_allocator operator=(const Free_list_allocator& other) noexcept
+                {
+                    if (this == &other) {
+                        return *this;
+                    }
+
+                    internal_ = other.internal_;
+                    root_ = nullptr;
+                    list_size_ = 0;
+                    return *this;
+                }
+                constexpr Free_list_allocator(Free_list_allocator&& other) noexcept
+                    : internal_(std::move(other.internal_)), root_(other.root_), list_size_(other.list_size_)
+                {
+                    other.root_ = nullptr;
+                    other.list_size_ = 0;
+                }
+                constexpr Free_list_allocator& operator=(Free_list_allocator&& other) noexcept
+                {
                     if (this == &other) {
                         return *this;
                     }
 
-                    internal_ = other.internal_;
-                    root_ = nullptr;
-                    list_size_ = 0;
-                    return *this;
+                    internal_ = std::move(other.internal_);
+                    root_ = other.root_;
+                    list_size_ = other.list_size_;
+                    other.root_ = nullptr;
+                    other.list_size_ = 0;
+                    return *this;
+                }
+                // Responsible to release the saved memory blocks
+                constexpr ~Free_list_allocator() noexcept
+                {
+                    for (std::int64_t i = 0; i < list_size_; ++i) {
+                        Node* n = root_;
+                        root_ = root_->next;
+                        Block<void> b{ Max_size, n, n->hint };
+                        internal_.deallocate(b);
+                    }
+                }
+
+                [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+                {
+                    if (s >= Min_size && s <= Max_size && list_size_ > 0 && root_) {
+                        Block<void> b(s, root_, root_->hint);
+                        root_ = root_->next;
+                        --list_size_;
+                        return observe_allocation(*this, s, b);
+                    }
+                    oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, (s < Min_size || s > Max_size) ? s : Max_size, location);
+                    if (!r) {
+                        return observe_allocation(*this, s, r);
+                    }
+                    return observe_allocation(*this, s, Block<void>(s, r.value().data(), r.value().hint()));
+                }
+
+                constexpr void deallocate(Block<void>& b) noexcept
+                {
+                    observe_deallocation(*this, b);
+                    if (b.size() < Min_size || b.size() > Max_size || list_size_ > Max_list_size) {
+                        Block<void> nb{ Max_size, b.data(), b.hint() };
+                        b = Block<void>();
+                        return internal_.deallocate(nb);
+                    }
+                    Node* node = reinterpret_cast<Node*>(b.data());
+                    node->hint = b.hint();
+                    node->next = root_;
+                    root_ = node;
+                    ++list_size_;
+                    b = Block<void>();
+                }
+
+                [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+                {
+                    return (b.size() >= Min_size && b.size() <= Max_size) || internal_.owns(b);
+                }
+
+                // Listed sizes are served by blocks of Max_size.
+                [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                {
+                    if (s >= Min_size && s <= Max_size) {
+                        return Max_size;
+                    }
+                    if constexpr (Sizing_allocator<Internal_allocator>) {
+                        return internal_.good_size(s);
+                    }
+                    else {
+                        return s;
+                    }
+                }
+
+                // Prefills the list with up to count blocks of Max_size, returns the number of blocks added.
+                constexpr std::int64_t warm_up(std::int64_t count) noexcept
+                {
+                    std::int64_t added = 0;
+                    while (added < count && list_size_ < Max_list_size) {
+                        oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(Max_size);
+                        if (!r || r.value().empty()) {
+                            break;
+                        }
+                        Node* node = reinterpret_cast<Node*>(r.value().data());
+                        node->hint = r.value().hint();
+                        node->next = root_;
+                        root_ = node;
+                        ++list_size_;
+                        ++added;
+                    }
+                    return added;
+                }
+
+                void visit(Allocator_visitor& v) const
+                {
+                    v.type("Free_list_allocator");
+                    v.parameter("min_size", Min_size);
+                    v.parameter("max_size", Max_size);
+                    v.parameter("max_list_size", Max_list_size);
+                    v.usage({ .bytes_cached = list_size_ * Max_size, .blocks_cached = list_size_ });
+                    details::visit(internal_, v, "internal");
+                }
+
+            private:
+                Internal_allocator internal_;
+
+                struct Node {
+                    std::int64_t hint{ std::numeric_limits<std::int64_t>::min() };
+                    Node* next{ nullptr };
+                };
+
+                Node* root_{ nullptr };
+                std::int64_t list_size_{ 0 };
+        };
+
+        struct Runtime_free_list_parameters {
+            Block<void>::Size_type min_size{ 0 };
+            Block<void>::Size_type max_size{ -1 };
+            std::int64_t max_list_size{ 0 };
+        };
+
+        // Free_list_allocator with parameters set on construction, for sizes known at run time.
+        // A default constructed allocator has an empty size range, so all the blocks are allocated by the internal allocator.
+        template <Allocator Internal_allocator>
+        class Runtime_free_list_allocator final {
+        public:
+            using Parameters = Runtime_free_list_parameters;
+
+            constexpr Runtime_free_list_allocator() = default;
+            // Invalid parameters result in an empty size range
+            constexpr explicit Runtime_free_list_allocator(const Parameters& parameters, Internal_allocator internal = {}) noexcept
+                : internal_(std::move(internal))
+            {
+                if (parameters.min_size > 1 && parameters.min_size % 2 == 0 && parameters.max_size >= parameters.min_size && parameters.max_size % 2 == 0
+                    && parameters.max_list_size > 0 && parameters.max_size >= MEMOC_SSIZEOF(Node)) {
+                    parameters_ = parameters;
+                    first_ = static_cast<std::uint64_t>(parameters.min_size);
+                    span_ = static_cast<std::uint64_t>(parameters.max_size - parameters.min_size);
+                }
+            }
+            constexpr Runtime_free_list_allocator(const Runtime_free_list_allocator& other) noexcept
+                : internal_(other.internal_), parameters_(other.parameters_), first_(other.first_), span_(other.span_), root_(nullptr), list_size_(0) {}
+            constexpr Runtime_free_list_allocator& operator=(const Runtime_free_list_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release();
+                internal_ = other.internal_;
+                parameters_ = other.parameters_;
+                first_ = other.first_;
+                span_ = other.span_;
+                return *this;
+            }
+            constexpr Runtime_free_list_allocator(Runtime_free_list_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), parameters_(other.parameters_), first_(other.first_), span_(other.span_), root_(other.root_), list_size_(other.list_size_)
+            {
+                other.root_ = nullptr;
+                other.list_size_ = 0;
+            }
+            constexpr Runtime_free_list_allocator& operator=(Runtime_free_list_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release();
+                internal_ = std::move(other.internal_);
+                parameters_ = other.parameters_;
+                first_ = other.first_;
+                span_ = other.span_;
+                root_ = other.root_;
+                list_size_ = other.list_size_;
+                other.root_ = nullptr;
+                other.list_size_ = 0;
+                return *this;
+            }
+            constexpr ~Runtime_free_list_allocator() noexcept
+            {
+                release();
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                const bool listed = in_range(s);
+                if (listed && root_) {
+                    Block<void> b(s, root_, root_->hint);
+                    root_ = root_->next;
+                    --list_size_;
+                    return observe_allocation(*this, s, b);
+                }
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, listed ? parameters_.max_size : s, location);
+                if (!r) {
+                    return observe_allocation(*this, s, r);
+                }
+                return observe_allocation(*this, s, Block<void>(s, r.value().data(), r.value().hint()));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                const bool listed = in_range(b.size());
+                if (!listed || list_size_ > parameters_.max_list_size) {
+                    Block<void> nb{ listed ? parameters_.max_size : b.size(), b.data(), b.hint() };
+                    b = Block<void>();
+                    return internal_.deallocate(nb);
+                }
+                Node* node = reinterpret_cast<Node*>(b.data());
+                node->hint = b.hint();
+                node->next = root_;
+                root_ = node;
+                ++list_size_;
+                b = Block<void>();
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return in_range(b.size()) || internal_.owns(b);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+            {
+                if (in_range(s)) {
+                    return parameters_.max_size;
+                }
+                if constexpr (Sizing_allocator<Internal_allocator>) {
+                    return internal_.good_size(s);
+                }
+                else {
+                    return s;
+                }
+            }
+
+            // Prefills the list with up to count blocks of max_size, returns the number of blocks added.
+            constexpr std::int64_t warm_up(std::int64_t count) noexcept
+            {
+                std::int64_t added = 0;
+                while (added < count && list_size_ < parameters_.max_list_size) {
+                    oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(parameters_.max_size);
+                    if (!r || r.value().empty()) {
+                        break;
+                    }
+                    Node* node = reinterpret_cast<Node*>(r.value().data());
+                    node->hint = r.value().hint();
+                    node->next = root_;
+                    root_ = node;
+                    ++list_size_;
+                    ++added;
+                }
+                return added;
+            }
+
+            [[nodiscard]] constexpr const Parameters& parameters() const noexcept
+            {
+                return parameters_;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Runtime_free_list_allocator");
+                v.parameter("min_size", parameters_.min_size);
+                v.parameter("max_size", parameters_.max_size);
+                v.parameter("max_list_size", parameters_.max_list_size);
+                v.usage({ .bytes_cached = list_size_ * parameters_.max_size, .blocks_cached = list_size_ });
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            struct Node {
+                std::int64_t hint{ std::numeric_limits<std::int64_t>::min() };
+                Node* next{ nullptr };
+            };
+
+            // A single comparison, since sizes below min_size wrap around to large unsigned values.
+            // The range of invalid parameters contains only the minimal size value, which is invalid for allocation.
+            [[nodiscard]] constexpr bool in_range(Block<void>::Size_type s) const noexcept
+            {
+                return static_cast<std::uint64_t>(s) - first_ <= span_;
+            }
+
+            constexpr void release() noexcept
+            {
+                while (root_) {
+                    Node* n = root_;
+                    root_ = root_->next;
+                    Block<void> b{ parameters_.max_size, n, n->hint };
+                    internal_.deallocate(b);
+                }
+                list_size_ = 0;
+            }
+
+            Internal_allocator internal_{};
+            Parameters parameters_{};
+            std::uint64_t first_{ static_cast<std::uint64_t>(std::numeric_limits<Block<void>::Size_type>::min()) };
+            std::uint64_t span_{ 0 };
+
+            Node* root_{ nullptr };
+            std::int64_t list_size_{ 0 };
+        };
+
+        // Free lists of power of two size classes from Min_size to Max_size, each block is served by the list of its size class.
+        // Larger blocks are allocated by the internal allocator.
+        template <Allocator Internal_allocator, Block<void>::Size_type Min_size, Block<void>::Size_type Max_size, std::int64_t Max_list_size>
+        class Bucketizer final {
+            static_assert(Min_size > 1 && (Min_size & (Min_size - 1)) == 0);
+            static_assert(Max_size >= Min_size && (Max_size & (Max_size - 1)) == 0);
+        public:
+            static constexpr bool is_stateless = Allocator_traits<Internal_allocator>::is_stateless && Max_list_size == 0;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                if (s <= 0 || s > Max_size) {
+                    return observe_allocation(*this, s, allocate_at(internal_, s, location));
+                }
+
+                oc::Expected<Block<void>, Allocator_error> r = oc::Unexpected(Allocator_error::unknown);
+                for_class(class_of(s), [&](auto& bucket, Block<void>::Size_type cs) { r = allocate_at(bucket, cs, location); });
+                if (!r) {
+                    return observe_allocation(*this, s, r);
+                }
+                return observe_allocation(*this, s, Block<void>(s, r.value().data(), r.value().hint()));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (b.empty() || b.size() > Max_size) {
+                    return internal_.deallocate(b);
+                }
+
+                for_class(class_of(b.size()), [&](auto& bucket, Block<void>::Size_type cs) {
+                    Block<void> cb{ cs, b.data(), b.hint() };
+                    bucket.deallocate(cb);
+                });
+                b = Block<void>();
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+            {
+                if (s > 0 && s <= Max_size) {
+                    return Min_size << class_of(s);
+                }
+                if constexpr (Sizing_allocator<Internal_allocator>) {
+                    return internal_.good_size(s);
+                }
+                else {
+                    return s;
+                }
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Bucketizer");
+                v.parameter("min_size", Min_size);
+                v.parameter("max_size", Max_size);
+                v.parameter("max_list_size", Max_list_size);
+                std::apply([&v](const auto&... buckets) { (details::visit(buckets, v, "bucket"), ...); }, buckets_);
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            static constexpr std::int64_t classes_count_ = std::bit_width(static_cast<std::uint64_t>(Max_size / Min_size));
+
+            static constexpr std::int64_t class_of(Block<void>::Size_type s) noexcept
+            {
+                return s <= Min_size ? 0 : std::bit_width(static_cast<std::uint64_t>((s - 1) / Min_size));
+            }
+
+            template <std::size_t... Is>
+            static auto buckets_of(std::index_sequence<Is...>)
+                -> std::tuple<Free_list_allocator<Internal_allocator, (Min_size << Is), (Min_size << Is), Max_list_size>...>;
+
+            template <typename F>
+            constexpr void for_class(std::int64_t c, F&& f) noexcept
+            {
+                [&]<std::size_t... Is>(std::index_sequence<Is...>) {
+                    static_cast<void>(((static_cast<std::int64_t>(Is) == c ? (f(std::get<Is>(buckets_), Min_size << Is), true) : false) || ...));
+                }(std::make_index_sequence<classes_count_>{});
+            }
+
+            Internal_allocator internal_{};
+            decltype(buckets_of(std::make_index_sequence<classes_count_>{})) buckets_{};
+        };
+
+        // Free lists of power of two size classes from Min_size to Max_size, whose caching adapts to the observed allocation sizes.
+        // Allocations are counted in a histogram of the classes, and every Adapt_interval allocations the cached classes and
+        // their limits are derived from it: classes of at least 1/64 of the allocations are cached, with limits proportional
+        // to their share of Cache_capacity blocks. Blocks beyond the new limits are released, and the histogram is halved
+        // so that older allocations weigh less.
+        // Blocks of the classes are allocated in their class sizes whether cached or not, larger blocks are allocated by the internal allocator.
+        template <
+            Allocator Internal_allocator,
+            Block<void>::Size_type Min_size = 16, Block<void>::Size_type Max_size = 64 * 1024,
+            std::int64_t Cache_capacity = 1024, std::int64_t Adapt_interval = 4096>
+        class Adaptive_free_list_allocator final {
+            static_assert(Min_size >= 16 && (Min_size & (Min_size - 1)) == 0);
+            static_assert(Max_size >= Min_size && (Max_size & (Max_size - 1)) == 0);
+            static_assert(Cache_capacity > 0);
+            static_assert(Adapt_interval > 0);
+        public:
+            static constexpr std::int64_t classes_count = std::bit_width(static_cast<std::uint64_t>(Max_size / Min_size));
+
+            struct Class_info {
+                Block<void>::Size_type size{ 0 };
+                std::int64_t limit{ 0 };
+                std::int64_t cached{ 0 };
+                std::int64_t allocations{ 0 };
+            };
+
+            struct Configuration {
+                // Sizes of the smallest and largest cached classes, 0 if no class is cached
+                Block<void>::Size_type min_size{ 0 };
+                Block<void>::Size_type max_size{ 0 };
+                std::int64_t adaptations{ 0 };
+                Class_info classes[classes_count]{};
+            };
+
+            constexpr Adaptive_free_list_allocator() noexcept
+            {
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    classes_[c].limit = initial_limit_;
+                }
+            }
+            // Copies start with empty lists and the configuration of the source
+            constexpr Adaptive_free_list_allocator(const Adaptive_free_list_allocator& other) noexcept
+                : internal_(other.internal_), ticks_(other.ticks_), adaptations_(other.adaptations_)
+            {
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    classes_[c].limit = other.classes_[c].limit;
+                    counts_[c] = other.counts_[c];
+                }
+            }
+            constexpr Adaptive_free_list_allocator& operator=(const Adaptive_free_list_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release();
+                internal_ = other.internal_;
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    classes_[c].limit = other.classes_[c].limit;
+                    counts_[c] = other.counts_[c];
+                }
+                ticks_ = other.ticks_;
+                adaptations_ = other.adaptations_;
+                return *this;
+            }
+            constexpr Adaptive_free_list_allocator(Adaptive_free_list_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), ticks_(other.ticks_), adaptations_(other.adaptations_)
+            {
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    classes_[c] = other.classes_[c];
+                    counts_[c] = other.counts_[c];
+                    other.classes_[c].root = nullptr;
+                    other.classes_[c].cached = 0;
+                }
+            }
+            constexpr Adaptive_free_list_allocator& operator=(Adaptive_free_list_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                release();
+                internal_ = std::move(other.internal_);
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    classes_[c] = other.classes_[c];
+                    counts_[c] = other.counts_[c];
+                    other.classes_[c].root = nullptr;
+                    other.classes_[c].cached = 0;
+                }
+                ticks_ = other.ticks_;
+                adaptations_ = other.adaptations_;
+                return *this;
+            }
+            constexpr ~Adaptive_free_list_allocator() noexcept
+            {
+                release();
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                if (s <= 0 || s > Max_size) {
+                    return observe_allocation(*this, s, allocate_at(internal_, s, location));
+                }
+
+                const std::int64_t c = class_of(s);
+                ++counts_[c];
+                if (++ticks_ >= Adapt_interval) {
+                    adapt();
+                }
+
+                Class& k = classes_[c];
+                if (k.root) {
+                    Node* n = k.root;
+                    k.root = n->next;
+                    --k.cached;
+                    return observe_allocation(*this, s, Block<void>(s, n, n->hint));
+                }
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, class_size(c), location);
+                if (!r) {
+                    return observe_allocation(*this, s, r);
+                }
+                return observe_allocation(*this, s, Block<void>(s, r.value().data(), r.value().hint()));
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (b.empty() || b.size() > Max_size) {
+                    return internal_.deallocate(b);
+                }
+
+                const std::int64_t c = class_of(b.size());
+                Class& k = classes_[c];
+                if (k.cached < k.limit) {
+                    Node* n = reinterpret_cast<Node*>(b.data());
+                    n->hint = b.hint();
+                    n->next = k.root;
+                    k.root = n;
+                    ++k.cached;
+                }
+                else {
+                    Block<void> cb{ class_size(c), b.data(), b.hint() };
+                    internal_.deallocate(cb);
+                }
+                b = Block<void>();
+            }
+
+            // Cached blocks are allocated by the internal allocator, which therefore owns them.
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+            {
+                if (s > 0 && s <= Max_size) {
+                    return class_size(class_of(s));
+                }
+                if constexpr (Sizing_allocator<Internal_allocator>) {
+                    return internal_.good_size(s);
+                }
+                else {
+                    return s;
+                }
+            }
+
+            // Derives the cached classes and their limits from the histogram, called every Adapt_interval allocations.
+            constexpr void adapt() noexcept
+            {
+                std::int64_t total = 0;
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    total += counts_[c];
+                }
+
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    Class& k = classes_[c];
+                    const bool cached = total > 0 && counts_[c] > 0 && counts_[c] * 64 >= total;
+                    k.limit = cached ? std::max<std::int64_t>(1, Cache_capacity * counts_[c] / total) : 0;
+                    while (k.cached > k.limit) {
+                        Node* n = k.root;
+                        k.root = n->next;
+                        --k.cached;
+                        Block<void> b{ class_size(c), n, n->hint };
+                        internal_.deallocate(b);
+                    }
+                    counts_[c] /= 2;
+                }
+                ticks_ = 0;
+                ++adaptations_;
+            }
+
+            [[nodiscard]] constexpr Configuration configuration() const noexcept
+            {
+                Configuration conf{};
+                conf.adaptations = adaptations_;
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    conf.classes[c] = { class_size(c), classes_[c].limit, classes_[c].cached, counts_[c] };
+                    if (classes_[c].limit > 0) {
+                        conf.min_size = conf.min_size == 0 ? class_size(c) : conf.min_size;
+                        conf.max_size = class_size(c);
+                    }
+                }
+                return conf;
+            }
+
+            // Prefills each class list with up to count blocks, within its limit, returns the number of blocks added.
+            constexpr std::int64_t warm_up(std::int64_t count) noexcept
+            {
+                std::int64_t added = 0;
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    Class& k = classes_[c];
+                    for (std::int64_t i = 0; i < count && k.cached < k.limit; ++i) {
+                        oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(class_size(c));
+                        if (!r || r.value().empty()) {
+                            return added;
+                        }
+                        Node* n = static_cast<Node*>(r.value().data());
+                        n->hint = r.value().hint();
+                        n->next = k.root;
+                        k.root = n;
+                        ++k.cached;
+                        ++added;
+                    }
+                }
+                return added;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Adaptive_free_list_allocator");
+                v.parameter("min_size", Min_size);
+                v.parameter("max_size", Max_size);
+                v.parameter("cache_capacity", Cache_capacity);
+                v.parameter("adapt_interval", Adapt_interval);
+                v.parameter("adaptations", adaptations_);
+                Allocator_usage u{ .bytes_cached = 0, .blocks_cached = 0 };
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    u.bytes_cached += classes_[c].cached * class_size(c);
+                    u.blocks_cached += classes_[c].cached;
+                }
+                v.usage(u);
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            struct Node {
+                std::int64_t hint{ std::numeric_limits<std::int64_t>::min() };
+                Node* next{ nullptr };
+            };
+
+            struct Class {
+                Node* root{ nullptr };
+                std::int64_t cached{ 0 };
+                std::int64_t limit{ 0 };
+            };
+
+            static constexpr std::int64_t initial_limit_ = Cache_capacity / classes_count > 0 ? Cache_capacity / classes_count : 1;
+
+            static constexpr std::int64_t class_of(Block<void>::Size_type s) noexcept
+            {
+                return s <= Min_size ? 0 : std::bit_width(static_cast<std::uint64_t>((s - 1) / Min_size));
+            }
+
+            static constexpr Block<void>::Size_type class_size(std::int64_t c) noexcept
+            {
+                return Min_size << c;
+            }
+
+            constexpr void release() noexcept
+            {
+                for (std::int64_t c = 0; c < classes_count; ++c) {
+                    while (classes_[c].root) {
+                        Node* n = classes_[c].root;
+                        classes_[c].root = n->next;
+                        Block<void> b{ class_size(c), n, n->hint };
+                        internal_.deallocate(b);
+                    }
+                    classes_[c].cached = 0;
+                }
+            }
+
+            Internal_allocator internal_{};
+            Class classes_[classes_count]{};
+            std::int64_t counts_[classes_count]{};
+            std::int64_t ticks_{ 0 };
+            std::int64_t adaptations_{ 0 };
+        };
+
+        template <Allocator Internal_allocator>
+        struct Stl_adapter_backend {
+            Internal_allocator allocator{};
+            std::atomic<std::int64_t> references{ 1 };
+        };
+
+        // Standard allocator over an allocator instance, which is shared by the copies and rebinds of the adapter,
+        // so node based containers and container copies use the same backend.
+        // Stateless allocators are held by value.
+        // The backend is not synchronized, unless the allocator is thread safe.
+        // Throws std::bad_alloc if memory allocation failed.
+        template <typename T, Allocator Internal_allocator>
+            requires (!std::is_reference_v<T>)
+        class Stl_adapter_allocator {
+        public:
+            using value_type = T;
+            using propagate_on_container_copy_assignment = std::true_type;
+            using propagate_on_container_move_assignment = std::true_type;
+            using propagate_on_container_swap = std::true_type;
+            using is_always_equal = std::bool_constant<Allocator_traits<Internal_allocator>::is_stateless>;
+
+#if defined(__cpp_lib_allocate_at_least)
+            using Allocation_result = std::allocation_result<T*, std::size_t>;
+#else
+            struct Allocation_result {
+                T* ptr{ nullptr };
+                std::size_t count{ 0 };
+            };
+#endif
+
+            constexpr Stl_adapter_allocator()
+                : Stl_adapter_allocator(Internal_allocator{}) {}
+            constexpr explicit Stl_adapter_allocator(Internal_allocator allocator)
+            {
+                if constexpr (shares_backend_) {
+                    Block<void> b = Malloc_allocator{}.allocate(MEMOC_SSIZEOF(Backend)).value();
+                    internal_ = std::construct_at(static_cast<Backend*>(b.data()), std::move(allocator));
+                }
+                else {
+                    internal_ = std::move(allocator);
+                }
+            }
+            constexpr Stl_adapter_allocator(const Stl_adapter_allocator& other) noexcept
+                : internal_(other.internal_)
+            {
+                acquire();
+            }
+            constexpr Stl_adapter_allocator& operator=(const Stl_adapter_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+                release();
+                internal_ = other.internal_;
+                acquire();
+                return *this;
+            }
+            // A moved from adapter shares the backend as well, since standard containers may still use it
+            constexpr Stl_adapter_allocator(Stl_adapter_allocator&& other) noexcept
+                : Stl_adapter_allocator(std::as_const(other)) {}
+            constexpr Stl_adapter_allocator& operator=(Stl_adapter_allocator&& other) noexcept
+            {
+                return *this = std::as_const(other);
+            }
+            constexpr ~Stl_adapter_allocator() noexcept
+            {
+                release();
+            }
+
+            template <typename U>
+                requires (!std::is_reference_v<U>)
+            constexpr Stl_adapter_allocator(const Stl_adapter_allocator<U, Internal_allocator>& other) noexcept
+                : internal_(other.internal_)
+            {
+                acquire();
+            }
+
+            [[nodiscard]] constexpr T* allocate(std::size_t n)
+            {
+                oc::Expected<Block<void>, Allocator_error> r = allocator().allocate(safe_64_unsigned_to_signed_cast(n) * MEMOC_SSIZEOF(T));
+                if (!r) {
+                    throw std::bad_alloc{};
+                }
+                return reinterpret_cast<T*>(r.value().data());
+            }
+
+            // Allocates at least n objects, up to the usable size of the allocator blocks.
+            [[nodiscard]] constexpr Allocation_result allocate_at_least(std::size_t n)
+            {
+                std::size_t count = n;
+                if constexpr (Sizing_allocator<Internal_allocator>) {
+                    count = static_cast<std::size_t>(allocator().good_size(safe_64_unsigned_to_signed_cast(n) * MEMOC_SSIZEOF(T)) / MEMOC_SSIZEOF(T));
+                    count = count > n ? count : n;
+                }
+                return { allocate(count), count };
+            }
+
+            constexpr void deallocate(T* p, std::size_t n) noexcept
+            {
+                Block<void> b = { safe_64_unsigned_to_signed_cast(n) * MEMOC_SSIZEOF(T), reinterpret_cast<void*>(p), hint_ };
+                allocator().deallocate(b);
+            }
+
+            [[nodiscard]] constexpr Internal_allocator& allocator() const noexcept
+            {
+                if constexpr (shares_backend_) {
+                    return internal_->allocator;
+                }
+                else {
+                    return internal_;
+                }
+            }
+
+            template <typename U>
+            [[nodiscard]] constexpr bool operator==(const Stl_adapter_allocator<U, Internal_allocator>& other) const noexcept
+            {
+                if constexpr (shares_backend_) {
+                    return internal_ == other.internal_;
+                }
+                else {
+                    return true;
+                }
+            }
+
+        private:
+            template <typename U, Allocator A>
+                requires (!std::is_reference_v<U>)
+            friend class Stl_adapter_allocator;
+
+            using Backend = Stl_adapter_backend<Internal_allocator>;
+
+            static constexpr bool shares_backend_ = !Allocator_traits<Internal_allocator>::is_stateless;
+
+            // Blocks of stamping allocators are deallocated with their hint
+            static constexpr std::int64_t hint_ = []() {
+                if constexpr (Stamping_allocator<Internal_allocator>) {
+                    return static_cast<std::int64_t>(Internal_allocator::id);
+                }
+                else {
+                    return Block<void>{}.hint();
+                }
+            }();
+
+            constexpr void acquire() noexcept
+            {
+                if constexpr (shares_backend_) {
+                    internal_->references.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            constexpr void release() noexcept
+            {
+                if constexpr (shares_backend_) {
+                    if (internal_->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        std::destroy_at(internal_);
+                        Block<void> b{ MEMOC_SSIZEOF(Backend), internal_ };
+                        Malloc_allocator{}.deallocate(b);
+                    }
+                }
+            }
+
+            [[no_unique_address]] mutable std::conditional_t<shares_backend_, Backend*, Internal_allocator> internal_{};
+        };
+
+        template <Allocator Internal_allocator, std::int64_t Number_of_records>
+        class Stats_allocator final {
+        public:
+            struct Record {
+                void* record_address{ nullptr };
+                void* request_address{ nullptr };
+                Block<void>::Size_type amount{ 0 };
+                std::chrono::time_point<std::chrono::system_clock> time;
+                Record* next{ nullptr };
+            };
+
+            constexpr Stats_allocator() = default;
+            constexpr Stats_allocator(const Stats_allocator& other) noexcept
+                : internal_(other.internal_)
+            {
+                for (Record* r = other.root_; r != nullptr; r = r->next) {
+                    add_record(r->request_address, r->amount - MEMOC_SSIZEOF(Record), r->time);
+                }
+            }
+            constexpr Stats_allocator operator=(const Stats_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+                internal_ = other.internal_;
+                for (Record* r = other.root_; r != nullptr; r = r->next) {
+                    add_record(r->request_address, r->amount - MEMOC_SSIZEOF(Record), r->time);
+                }
+                return *this;
+            }
+            constexpr Stats_allocator(Stats_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), number_of_records_(other.number_of_records_), total_allocated_(other.total_allocated_), root_(other.root_), tail_(other.tail_)
+            {
+                other.number_of_records_ = other.total_allocated_ = 0;
+                other.root_ = other.tail_ = nullptr;
+            }
+            constexpr Stats_allocator& operator=(Stats_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+                internal_ = std::move(other.internal_);
+                number_of_records_ = other.number_of_records_;
+                total_allocated_ = other.total_allocated_;
+                root_ = other.root_;
+                tail_ = other.tail_;
+                other.number_of_records_ = other.total_allocated_ = 0;
+                other.root_ = other.tail_ = nullptr;
+                return *this;
+            }
+            constexpr ~Stats_allocator() noexcept
+            {
+                Record* c = root_;
+                while (c) {
+                    Record* n = c->next;
+                    Block<void> b{ MEMOC_SSIZEOF(Record), c->record_address };
+                    internal_.deallocate(b);
+                    c = n;
+                }
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, s, location);
+                if (!r) {
+                    return observe_allocation(*this, s, r);
+                }
+                Block<void> b(r.value());
+                if (!b.empty()) {
+                    add_record(b.data(), b.size());
+                }
+                return observe_allocation(*this, s, b);
+            }
+
+            void constexpr deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                Block<void> bc{ b };
+                internal_.deallocate(b);
+                if (b.empty()) {
+                    add_record(bc.data(), -bc.size());
+                }
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            constexpr std::int64_t warm_up(std::int64_t amount) noexcept
+            {
+                return memoc::details::warm_up(internal_, amount);
+            }
+
+            constexpr const Record* stats_list() const noexcept {
+                return root_;
+            }
+
+            constexpr std::int64_t stats_list_size() const noexcept {
+                return number_of_records_;
+            }
+
+            constexpr Block<void>::Size_type total_allocated() const noexcept {
+                return total_allocated_;
+            }
+
+            // The records are allocated by the internal allocator, and reported as overhead.
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Stats_allocator");
+                v.parameter("number_of_records", Number_of_records);
+                v.parameter("total_allocated", total_allocated_);
+                v.usage({ .bytes_overhead = number_of_records_ * MEMOC_SSIZEOF(Record) });
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            constexpr void add_record(void* p, Block<void>::Size_type a, std::chrono::time_point<std::chrono::system_clock> time = std::chrono::system_clock::now()) {
+                if (number_of_records_ >= Number_of_records) {
+                    tail_->next = root_;
+                    root_ = root_->next;
+                    tail_ = tail_->next;
+                    tail_->next = nullptr;
+                    tail_->request_address = p;
+                    tail_->amount = MEMOC_SSIZEOF(Record) + a;
+                    tail_->time = time;
+
+                    total_allocated_ += tail_->amount;
+
+                    return;
+                }
+
+                oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(MEMOC_SSIZEOF(Record));
+                if (!r) {
+                    return;
+                }
+                Block<void> b1(r.value());
+                if (b1.empty()) {
+                    return;
+                }
+
+                if (!root_) {
+                    root_ = reinterpret_cast<Record*>(b1.data());
+                    tail_ = root_;
+                }
+                else {
+                    tail_->next = reinterpret_cast<Record*>(b1.data());
+                    tail_ = tail_->next;
+                }
+                tail_->record_address = b1.data();
+                tail_->request_address = p;
+                tail_->amount = b1.size() + a;
+                tail_->time = time;
+                tail_->next = nullptr;
+
+                total_allocated_ += tail_->amount;
+
+                ++number_of_records_;
+            }
+
+            Internal_allocator internal_;
+
+            std::int64_t number_of_records_{ 0 };
+            Block<void>::Size_type total_allocated_{ 0 };
+            Record* root_{ nullptr };
+            Record* tail_{ nullptr };
+        };
+
+        // Counts the allocations and their bytes per call site, for up to Sites_count sites.
+        // The call site is the default argument of allocate, or the location passed by the caller, e.g. by allocate_at.
+        // Wrapping allocators forward the call site, except the lifetime allocators, which should be wrapped by it instead.
+        // Allocations served by a wrapping allocator without its internal allocator, e.g. from a free list, are not recorded.
+        // Sites are recorded in a lock free open addressing table shared by all the instances of the same type,
+        // and identified by the address of their file name, line and column. Allocations of sites beyond the table capacity are dropped.
+        // Each thread accumulates the counts of its recent sites and adds them to the table every Flush_interval allocations of a site,
+        // on eviction by another site and at thread exit, so other threads may not see the latest counts.
+        template <Allocator Internal_allocator, std::int64_t Sites_count = 1024, std::int64_t Flush_interval = 64>
+        class Site_stats_allocator final {
+            static_assert(Sites_count > 0 && (Sites_count & (Sites_count - 1)) == 0);
+            static_assert(Flush_interval > 0);
+        public:
+            static constexpr bool is_thread_safe = Allocator_traits<Internal_allocator>::is_thread_safe;
+            static constexpr bool is_stateless = Allocator_traits<Internal_allocator>::is_stateless;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
+
+            struct Site {
+                std::source_location location{};
+                std::int64_t count{ 0 };
+                Block<void>::Size_type bytes{ 0 };
+            };
+
+            constexpr Site_stats_allocator() = default;
+            constexpr explicit Site_stats_allocator(Internal_allocator internal) noexcept
+                : internal_(std::move(internal)) {}
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(
+                Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, s, location);
+                if (r && !r.value().empty()) {
+                    record(location, r.value().size());
+                }
+                return observe_allocation(*this, s, r);
+            }
+
+            void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                internal_.deallocate(b);
+            }
+
+            [[nodiscard]] bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            [[nodiscard]] Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                requires Sizing_allocator<Internal_allocator>
+            {
+                return internal_.good_size(s);
+            }
+
+            std::int64_t warm_up(std::int64_t amount) noexcept
+            {
+                return memoc::details::warm_up(internal_, amount);
+            }
+
+            // Adds the counts accumulated by the calling thread to the table.
+            static void flush() noexcept
+            {
+                if (destroyed_) {
+                    return;
+                }
+                for (Pending& p : pending_.entries) {
+                    flush(p);
+                }
+            }
+
+            // Writes up to n sites with the most allocated bytes, in descending order, and returns the number of sites written.
+            // Includes the counts of the calling thread.
+            static std::int64_t top(Site* sites, std::int64_t n) noexcept
+            {
+                flush();
+                std::int64_t written = 0;
+                for (const Slot& slot : table_) {
+                    if (!slot.ready.load(std::memory_order_acquire)) {
+                        continue;
+                    }
+                    const Site site{ slot.location, slot.count.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed) };
+                    std::int64_t i = written < n ? written++ : n;
+                    for (; i > 0 && sites[i - 1].bytes < site.bytes; --i) {
+                        if (i < n) {
+                            sites[i] = sites[i - 1];
+                        }
+                    }
+                    if (i < n) {
+                        sites[i] = site;
+                    }
+                }
+                return written;
+            }
+
+            // Writes a line per site of the top n sites, returns false if the report could not be written.
+            static bool dump(std::FILE* file, std::int64_t n) noexcept
+            {
+                if (n <= 0) {
+                    return true;
+                }
+                oc::Expected<Block<void>, Allocator_error> r = Malloc_allocator{}.allocate(n * MEMOC_SSIZEOF(Site));
+                if (!r) {
+                    return false;
+                }
+                Site* sites = static_cast<Site*>(r.value().data());
+                const std::int64_t written = top(sites, n);
+                bool ok = true;
+                for (std::int64_t i = 0; i < written && ok; ++i) {
+                    ok = std::fprintf(file, "%s:%u:%u %s count=%lld bytes=%lld\n",
+                        sites[i].location.file_name(), static_cast<unsigned>(sites[i].location.line()), static_cast<unsigned>(sites[i].location.column()),
+                        sites[i].location.function_name(), static_cast<long long>(sites[i].count), static_cast<long long>(sites[i].bytes)) >= 0;
+                }
+                Malloc_allocator{}.deallocate(r.value());
+                return ok;
+            }
+
+            [[nodiscard]] static std::int64_t sites() noexcept
+            {
+                return sites_.load(std::memory_order_relaxed);
+            }
+
+            // Allocations that were not recorded since the table was full.
+            [[nodiscard]] static std::int64_t dropped() noexcept
+            {
+                return dropped_.load(std::memory_order_relaxed);
+            }
+
+            // Clears the recorded sites, should not be called concurrently with allocations.
+            // Counts accumulated by other threads are added only to sites recorded again.
+            static void reset() noexcept
+            {
+                if (!destroyed_) {
+                    for (Pending& p : pending_.entries) {
+                        p = Pending{};
+                    }
+                }
+                for (Slot& slot : table_) {
+                    slot.ready.store(false, std::memory_order_relaxed);
+                    slot.key.store(0, std::memory_order_relaxed);
+                    slot.count.store(0, std::memory_order_relaxed);
+                    slot.bytes.store(0, std::memory_order_relaxed);
+                }
+                sites_.store(0, std::memory_order_relaxed);
+                dropped_.store(0, std::memory_order_relaxed);
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Site_stats_allocator");
+                v.parameter("sites_count", Sites_count);
+                v.parameter("flush_interval", Flush_interval);
+                v.parameter("sites", sites());
+                v.parameter("dropped", dropped());
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            struct Slot {
+                std::atomic<std::uint64_t> key{ 0 };
+                std::atomic<bool> ready{ false };
+                std::source_location location{};
+                std::atomic<std::int64_t> count{ 0 };
+                std::atomic<Block<void>::Size_type> bytes{ 0 };
+            };
+
+            static std::uint64_t key_of(const std::source_location& location) noexcept
+            {
+                std::uint64_t key = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(location.file_name()));
+                key ^= (static_cast<std::uint64_t>(location.line()) << 20) ^ location.column();
+                key *= 0x9e3779b97f4a7c15ull;
+                key ^= key >> 32;
+                // 0 marks a free slot
+                return key != 0 ? key : 1;
+            }
+
+            // Counts of a site not yet added to the table by the thread.
+            struct Pending {
+                std::uint64_t key{ 0 };
+                Slot* slot{ nullptr };
+                std::int64_t count{ 0 };
+                Block<void>::Size_type bytes{ 0 };
+            };
+
+            static constexpr std::int64_t pending_count_ = 16;
+
+            struct Pending_sites {
+                Pending entries[pending_count_]{};
+
+                // Allocations after the destruction, e.g. by other thread local destructors, are added directly to the table
+                ~Pending_sites() noexcept
+                {
+                    for (Pending& p : entries) {
+                        flush(p);
+                    }
+                    destroyed_ = true;
+                }
+            };
+
+            static Slot* find(const std::source_location& location, std::uint64_t key) noexcept
+            {
+                for (std::int64_t i = 0, index = static_cast<std::int64_t>(key & (Sites_count - 1)); i < Sites_count; ++i, index = (index + 1) & (Sites_count - 1)) {
+                    Slot& slot = table_[index];
+                    std::uint64_t k = slot.key.load(std::memory_order_acquire);
+                    if (k == 0 && slot.key.compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+                        // The location is published by the ready flag, after which it is not changed
+                        slot.location = location;
+                        slot.ready.store(true, std::memory_order_release);
+                        sites_.fetch_add(1, std::memory_order_relaxed);
+                        return &slot;
+                    }
+                    if (k == key) {
+                        return &slot;
+                    }
+                }
+                return nullptr;
+            }
+
+            static void flush(Pending& p) noexcept
+            {
+                // The slot might have been reset and claimed by another site since
+                if (p.count > 0 && p.slot->key.load(std::memory_order_relaxed) == p.key) {
+                    p.slot->count.fetch_add(p.count, std::memory_order_relaxed);
+                    p.slot->bytes.fetch_add(p.bytes, std::memory_order_relaxed);
+                }
+                p.count = 0;
+                p.bytes = 0;
+            }
+
+            static void record(const std::source_location& location, Block<void>::Size_type s) noexcept
+            {
+                const std::uint64_t key = key_of(location);
+                if (destroyed_) {
+                    Pending p{ key, find(location, key), 1, s };
+                    if (p.slot) {
+                        flush(p);
+                    }
+                    else {
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    return;
+                }
+
+                Pending& p = pending_.entries[key & (pending_count_ - 1)];
+                if (p.key != key) {
+                    Slot* slot = find(location, key);
+                    if (!slot) {
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    flush(p);
+                    p.key = key;
+                    p.slot = slot;
+                }
+                ++p.count;
+                p.bytes += s;
+                if (p.count == Flush_interval) {
+                    flush(p);
+                }
+            }
+
+            inline static Slot table_[Sites_count]{};
+            inline static thread_local Pending_sites pending_{};
+            inline static thread_local bool destroyed_{ false };
+            inline static std::atomic<std::int64_t> sites_{ 0 };
+            inline static std::atomic<std::int64_t> dropped_{ 0 };
+
+            Internal_allocator internal_{};
+        };
+
+        // Latencies of a kind of operation, in nanoseconds.
+        struct Latency_summary {
+            std::int64_t count{ 0 };
+            std::int64_t p50{ 0 };
+            std::int64_t p99{ 0 };
+            std::int64_t p999{ 0 };
+            std::int64_t max{ 0 };
+        };
+
+        // Log-linear histogram of durations in nanoseconds, with Sub_buckets linear buckets per power of two.
+        // The relative error of a recorded value is below 1 / Sub_buckets.
+        template <std::int64_t Sub_buckets = 16>
+        class Latency_histogram final {
+            static_assert(Sub_buckets > 1 && (Sub_buckets & (Sub_buckets - 1)) == 0);
+        public:
+            static constexpr std::int64_t sub_bits = std::bit_width(static_cast<std::uint64_t>(Sub_buckets)) - 1;
+            static constexpr std::int64_t buckets_count = (64 - sub_bits + 1) * Sub_buckets;
+
+            [[nodiscard]] static constexpr std::int64_t bucket_of(std::int64_t ns) noexcept
+            {
+                const std::uint64_t v = static_cast<std::uint64_t>(ns > 0 ? ns : 0);
+                if (v < static_cast<std::uint64_t>(Sub_buckets)) {
+                    return static_cast<std::int64_t>(v);
+                }
+                const std::int64_t shift = std::bit_width(v) - sub_bits - 1;
+                return (shift + 1) * Sub_buckets + static_cast<std::int64_t>((v >> shift) & (Sub_buckets - 1));
+            }
+
+            // The highest value of the bucket.
+            [[nodiscard]] static constexpr std::int64_t upper_bound_of(std::int64_t bucket) noexcept
+            {
+                if (bucket < Sub_buckets) {
+                    return bucket;
                 }
-                constexpr Free_list_allocator(Free_list_allocator&& other) noexcept
-                    : internal_(std::move(other.internal_)), root_(other.root_), list_size_(other.list_size_)
-                {
-                    other.root_ = nullptr;
-                    other.list_size_ = 0;
+                const std::int64_t shift = bucket / Sub_buckets - 1;
+                const std::uint64_t first = static_cast<std::uint64_t>(Sub_buckets + bucket % Sub_buckets) << shift;
+                return static_cast<std::int64_t>(std::min<std::uint64_t>(first + ((std::uint64_t{ 1 } << shift) - 1), std::numeric_limits<std::int64_t>::max()));
+            }
+
+            // Written by a single thread and read by any thread.
+            void record(std::int64_t ns) noexcept
+            {
+                std::atomic<std::int64_t>& c = counts_[bucket_of(ns)];
+                c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                if (ns > max_.load(std::memory_order_relaxed)) {
+                    max_.store(ns, std::memory_order_relaxed);
                 }
-                constexpr Free_list_allocator& operator=(Free_list_allocator&& other) noexcept
-                {
-                    if (this == &other) {
-                        return *this;
-                    }
+            }
 
-                    internal_ = std::move(other.internal_);
-                    root_ = other.root_;
-                    list_size_ = other.list_size_;
-                    other.root_ = nullptr;
-                    other.list_size_ = 0;
-                    return *this;
+            void merge_into(std::int64_t* counts, std::int64_t& count, std::int64_t& max) const noexcept
+            {
+                for (std::int64_t i = 0; i < buckets_count; ++i) {
+                    counts[i] += counts_[i].load(std::memory_order_relaxed);
                 }
-                // Responsible to release the saved memory blocks
-                constexpr ~Free_list_allocator() noexcept
-                {
-                    for (std::int64_t i = 0; i < list_size_; ++i) {
-                        Node* n = root_;
-                        root_ = root_->next;
-                        Block<void> b{ Max_size, n, n->hint };
-                        internal_.deallocate(b);
+                count += count_.load(std::memory_order_relaxed);
+                max = std::max(max, max_.load(std::memory_order_relaxed));
+            }
+
+            void clear() noexcept
+            {
+                for (std::atomic<std::int64_t>& c : counts_) {
+                    c.store(0, std::memory_order_relaxed);
+                }
+                count_.store(0, std::memory_order_relaxed);
+                max_.store(0, std::memory_order_relaxed);
+            }
+
+            // The percentiles of merged counts, each the upper bound of its bucket clamped to the maximum.
+            [[nodiscard]] static Latency_summary summarize(const std::int64_t* counts, std::int64_t count, std::int64_t max) noexcept
+            {
+                Latency_summary summary{ .count = count, .max = max };
+                if (count == 0) {
+                    return summary;
+                }
+                const std::int64_t ranks[] = { (count * 500 + 999) / 1000, (count * 990 + 999) / 1000, (count * 999 + 999) / 1000 };
+                std::int64_t* values[] = { &summary.p50, &summary.p99, &summary.p999 };
+                std::int64_t seen = 0;
+                std::int64_t next = 0;
+                for (std::int64_t i = 0; i < buckets_count && next < 3; ++i) {
+                    seen += counts[i];
+                    while (next < 3 && seen >= std::max<std::int64_t>(ranks[next], 1)) {
+                        *values[next++] = std::min(upper_bound_of(i), max);
                     }
                 }
+                // Counts recorded concurrently with the merge might be missing below the total
+                for (; next < 3; ++next) {
+                    *values[next] = max;
+                }
+                return summary;
+            }
 
-                [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+        private:
+            std::atomic<std::int64_t> counts_[buckets_count]{};
+            std::atomic<std::int64_t> count_{ 0 };
+            std::atomic<std::int64_t> max_{ 0 };
+        };
+
+        // Measures the duration of allocate and deallocate of the internal allocator, with the Clock,
+        // for one of every Sample_rate operations of each thread.
+        // Each thread records into its own histograms, which are merged on demand. The histograms are shared by all the instances
+        // of the same type, and kept for reuse by later threads when their thread exits.
+        // Operations of threads whose histograms could not be allocated, or that run after the thread local destruction, are not measured.
+        template <Allocator Internal_allocator, std::int64_t Sample_rate = 1, typename Clock = std::chrono::steady_clock>
+        class Latency_allocator final {
+            static_assert(Sample_rate > 0 && (Sample_rate & (Sample_rate - 1)) == 0);
+        public:
+            static constexpr bool is_thread_safe = Allocator_traits<Internal_allocator>::is_thread_safe;
+            static constexpr bool is_stateless = Allocator_traits<Internal_allocator>::is_stateless;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
+
+            using Histogram = Latency_histogram<>;
+
+            constexpr Latency_allocator() = default;
+            constexpr explicit Latency_allocator(Internal_allocator internal) noexcept
+                : internal_(std::move(internal)) {}
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                Node* node = sampled_node();
+                if (!node) {
+                    return observe_allocation(*this, s, allocate_at(internal_, s, location));
+                }
+                const typename Clock::time_point start = Clock::now();
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, s, location);
+                node->allocations.record(elapsed(start));
+                return observe_allocation(*this, s, r);
+            }
+
+            void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                Node* node = sampled_node();
+                if (!node) {
+                    return internal_.deallocate(b);
+                }
+                const typename Clock::time_point start = Clock::now();
+                internal_.deallocate(b);
+                node->deallocations.record(elapsed(start));
+            }
+
+            [[nodiscard]] bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            [[nodiscard]] Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                requires Sizing_allocator<Internal_allocator>
+            {
+                return internal_.good_size(s);
+            }
+
+            std::int64_t warm_up(std::int64_t amount) noexcept
+            {
+                return memoc::details::warm_up(internal_, amount);
+            }
+
+            // The measured operations of all the threads, merged on each call.
+            [[nodiscard]] static Latency_summary allocation_latency() noexcept
+            {
+                return merge(&Node::allocations);
+            }
+
+            [[nodiscard]] static Latency_summary deallocation_latency() noexcept
+            {
+                return merge(&Node::deallocations);
+            }
+
+            // Clears the histograms of all the threads, should not be called concurrently with allocations.
+            static void reset() noexcept
+            {
+                for (Node* n = head_.load(std::memory_order_acquire); n; n = n->next) {
+                    n->allocations.clear();
+                    n->deallocations.clear();
+                }
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Latency_allocator");
+                v.parameter("sample_rate", Sample_rate);
+                const Latency_summary a = allocation_latency();
+                v.parameter("allocations", a.count);
+                v.parameter("allocation_p99_ns", a.p99);
+                const Latency_summary d = deallocation_latency();
+                v.parameter("deallocations", d.count);
+                v.parameter("deallocation_p99_ns", d.p99);
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            struct Node {
+                Histogram allocations{};
+                Histogram deallocations{};
+                std::atomic<bool> owned{ true };
+                Node* next{ nullptr };
+            };
+
+            struct Thread_node {
+                Node* node{ nullptr };
+                std::int64_t operations{ 0 };
+
+                ~Thread_node() noexcept
                 {
-                    if (s >= Min_size && s <= Max_size && list_size_ > 0 && root_) {
-                        Block<void> b(s, root_, root_->hint);
-                        root_ = root_->next;
-                        --list_size_;
-                        return b;
+                    if (node) {
+                        node->owned.store(false, std::memory_order_release);
                     }
-                    oc::Expected<Block<void>, Allocator_error> r = internal_.allocate((s < Min_size || s > Max_size) ? s : Max_size);
-                    if (!r) {
-                        return r;
+                    destroyed_ = true;
+                }
+            };
+
+            static std::int64_t elapsed(typename Clock::time_point start) noexcept
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+            }
+
+            // The node of the calling thread if the operation is sampled, claiming a node of an exited thread or adding one on first use.
+            static Node* sampled_node() noexcept
+            {
+                if (destroyed_) {
+                    return nullptr;
+                }
+                Thread_node& t = thread_node_;
+                if ((t.operations++ & (Sample_rate - 1)) != 0) {
+                    return nullptr;
+                }
+                if (t.node) {
+                    return t.node;
+                }
+
+                for (Node* n = head_.load(std::memory_order_acquire); n; n = n->next) {
+                    bool owned = n->owned.load(std::memory_order_relaxed);
+                    if (!owned && n->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+                        return t.node = n;
                     }
-                    return Block<void>(s, r.value().data(), r.value().hint());
                 }
 
-                constexpr void deallocate(Block<void>& b) noexcept
-                {
-                    if (b.size() < Min_size || b.size() > Max_size || list_size_ > Max_list_size) {
-                        Block<void> nb{ Max_size, b.data(), b.hint() };
-                        b = Block<void>();
-                        return internal_.deallocate(nb);
+                oc::Expected<Block<void>, Allocator_error> r = Malloc_allocator{}.allocate(MEMOC_SSIZEOF(Node));
+                if (!r) {
+                    return nullptr;
+                }
+                Node* n = std::construct_at(static_cast<Node*>(r.value().data()));
+                n->next = head_.load(std::memory_order_relaxed);
+                while (!head_.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {
+                }
+                return t.node = n;
+            }
+
+            static Latency_summary merge(Histogram Node::* histogram) noexcept
+            {
+                std::int64_t counts[Histogram::buckets_count]{};
+                std::int64_t count = 0;
+                std::int64_t max = 0;
+                for (Node* n = head_.load(std::memory_order_acquire); n; n = n->next) {
+                    (n->*histogram).merge_into(counts, count, max);
+                }
+                return Histogram::summarize(counts, count, max);
+            }
+
+            // Nodes are never deallocated, so the list can be traversed without synchronization with the threads
+            inline static std::atomic<Node*> head_{ nullptr };
+            inline static thread_local Thread_node thread_node_{};
+            inline static thread_local bool destroyed_{ false };
+
+            Internal_allocator internal_{};
+        };
+
+        // Thread safe accounting of bytes in use against a soft and a hard limit.
+        // A child budget also charges its parent, so per subsystem budgets roll up into a global one.
+        class Memory_budget final {
+        public:
+            using Size_type = Block<void>::Size_type;
+            using Soft_limit_handler = void (*)(Memory_budget&, void*) noexcept;
+
+            static constexpr Size_type unlimited = std::numeric_limits<Size_type>::max();
+
+            explicit Memory_budget(Size_type hard_limit = unlimited, Size_type soft_limit = unlimited, Memory_budget* parent = nullptr) noexcept
+                : hard_limit_(hard_limit), soft_limit_(soft_limit < hard_limit ? soft_limit : hard_limit), parent_(parent) {}
+            Memory_budget(const Memory_budget&) = delete;
+            Memory_budget& operator=(const Memory_budget&) = delete;
+            Memory_budget(Memory_budget&&) = delete;
+            Memory_budget& operator=(Memory_budget&&) = delete;
+            ~Memory_budget() = default;
+
+            // The handler is called by the thread whose acquisition crossed the soft limit.
+            // Should be set before the budget is shared between threads.
+            void on_soft_limit(Soft_limit_handler handler, void* context = nullptr) noexcept
+            {
+                handler_ = handler;
+                context_ = context;
+            }
+
+            [[nodiscard]] bool try_acquire(Size_type s) noexcept
+            {
+                Size_type used = in_use_.load(std::memory_order_relaxed);
+                do {
+                    if (s > hard_limit_ - used) {
+                        return false;
                     }
-                    Node* node = reinterpret_cast<Node*>(b.data());
-                    node->hint = b.hint();
-                    node->next = root_;
-                    root_ = node;
-                    ++list_size_;
-                    b = Block<void>();
+                } while (!in_use_.compare_exchange_weak(used, used + s, std::memory_order_relaxed));
+
+                if (parent_ && !parent_->try_acquire(s)) {
+                    in_use_.fetch_sub(s, std::memory_order_relaxed);
+                    return false;
                 }
 
-                [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
-                {
-                    return (b.size() >= Min_size && b.size() <= Max_size) || internal_.owns(b);
+                const Size_type new_used = used + s;
+                Size_type peak = peak_.load(std::memory_order_relaxed);
+                while (peak < new_used && !peak_.compare_exchange_weak(peak, new_used, std::memory_order_relaxed)) {}
+
+                if (handler_ && used <= soft_limit_ && new_used > soft_limit_) {
+                    handler_(*this, context_);
                 }
-            private:
-                Internal_allocator internal_;
+                return true;
+            }
 
-                struct Node {
-                    std::int64_t hint{ std::numeric_limits<std::int64_t>::min() };
-                    Node* next{ nullptr };
-                };
+            void release(Size_type s) noexcept
+            {
+                in_use_.fetch_sub(s, std::memory_order_relaxed);
+                if (parent_) {
+                    parent_->release(s);
+                }
+            }
+
+            [[nodiscard]] Size_type in_use() const noexcept
+            {
+                return in_use_.load(std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] Size_type peak() const noexcept
+            {
+                return peak_.load(std::memory_order_relaxed);
+            }
+
+            [[nodiscard]] Size_type hard_limit() const noexcept
+            {
+                return hard_limit_;
+            }
+
+            [[nodiscard]] Size_type soft_limit() const noexcept
+            {
+                return soft_limit_;
+            }
+
+            [[nodiscard]] Memory_budget* parent() const noexcept
+            {
+                return parent_;
+            }
+
+        private:
+            const Size_type hard_limit_;
+            const Size_type soft_limit_;
+            Memory_budget* const parent_;
+
+            Soft_limit_handler handler_{ nullptr };
+            void* context_{ nullptr };
+
+            std::atomic<Size_type> in_use_{ 0 };
+            std::atomic<Size_type> peak_{ 0 };
+        };
+
+        // Charges every allocation to a Memory_budget, the budget should outlive the allocator.
+        // A default constructed allocator has no budget and forwards to its internal allocator.
+        template <Allocator Internal_allocator>
+        class Budget_allocator final {
+        public:
+            constexpr Budget_allocator() = default;
+            constexpr explicit Budget_allocator(Memory_budget& budget) noexcept
+                : budget_(&budget) {}
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0 || !budget_) {
+                    return observe_allocation(*this, s, allocate_at(internal_, s, location));
+                }
+                if (!budget_->try_acquire(s)) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, s, location);
+                if (!r || r.value().empty()) {
+                    budget_->release(s);
+                }
+                return observe_allocation(*this, s, r);
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                const Block<void>::Size_type s = b.empty() ? 0 : b.size();
+                internal_.deallocate(b);
+                if (budget_ && s > 0) {
+                    budget_->release(s);
+                }
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            // Warmed up memory is cached by the internal allocator and is not charged to the budget.
+            constexpr std::int64_t warm_up(std::int64_t amount) noexcept
+            {
+                return memoc::details::warm_up(internal_, amount);
+            }
+
+            [[nodiscard]] constexpr Memory_budget* budget() const noexcept
+            {
+                return budget_;
+            }
+
+            // The budget accounting may be shared with other allocators, hence reported as parameters.
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Budget_allocator");
+                if (budget_) {
+                    v.parameter("hard_limit", budget_->hard_limit());
+                    v.parameter("soft_limit", budget_->soft_limit());
+                    v.parameter("budget_in_use", budget_->in_use());
+                    v.parameter("budget_peak", budget_->peak());
+                }
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            Internal_allocator internal_{};
+            Memory_budget* budget_{ nullptr };
+        };
+
+        template <Allocator Internal_allocator, std::int64_t id = -1>
+        class Shared_allocator final {
+        public:
+            static constexpr bool is_thread_safe = Allocator_traits<Internal_allocator>::is_thread_safe;
+            static constexpr bool is_stateless = true;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                return observe_allocation(*this, s, allocate_at(allocator_, s, location));
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_aligned(Block<void>::Size_type s, Block<void>::Size_type alignment) noexcept
+                requires Aligned_allocator<Internal_allocator>
+            {
+                return allocator_.allocate_aligned(s, alignment);
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate_zeroed(Block<void>::Size_type s) noexcept
+                requires Zeroing_allocator<Internal_allocator>
+            {
+                return allocator_.allocate_zeroed(s);
+            }
+
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> reallocate(Block<void>& b, Block<void>::Size_type s) noexcept
+                requires Reallocating_allocator<Internal_allocator>
+            {
+                return allocator_.reallocate(b, s);
+            }
+
+            [[nodiscard]] constexpr bool expand(Block<void>& b, Block<void>::Size_type delta) noexcept
+                requires Expanding_allocator<Internal_allocator>
+            {
+                return allocator_.expand(b, delta);
+            }
+
+            [[nodiscard]] constexpr std::int64_t allocate_bulk(Block<void>::Size_type s, Block<void>* blocks, std::int64_t count) noexcept
+                requires Bulk_allocator<Internal_allocator>
+            {
+                return allocator_.allocate_bulk(s, blocks, count);
+            }
+
+            constexpr void deallocate_bulk(Block<void>* blocks, std::int64_t count) noexcept
+                requires Bulk_allocator<Internal_allocator>
+            {
+                allocator_.deallocate_bulk(blocks, count);
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                requires Sizing_allocator<Internal_allocator>
+            {
+                return allocator_.good_size(s);
+            }
+
+            constexpr void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                allocator_.deallocate(b);
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                return allocator_.owns(b);
+            }
+
+            constexpr std::int64_t warm_up(std::int64_t amount) noexcept
+            {
+                return memoc::details::warm_up(allocator_, amount);
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Shared_allocator");
+                v.parameter("id", id);
+                details::visit(allocator_, v, "internal");
+            }
+
+        private:
+            inline static Internal_allocator allocator_{};
+        };
+
+        // Waits between the attempts to take a spin lock, pausing the processor at first and then yielding it to other threads.
+        class Spin_backoff final {
+        public:
+            void wait() noexcept
+            {
+                if (pauses_ <= max_pauses_) {
+                    for (std::int64_t i = 0; i < pauses_; ++i) {
+#if defined(__x86_64__) || defined(__i386__)
+                        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+                        asm volatile("yield");
+#endif
+                    }
+                    pauses_ *= 2;
+                    return;
+                }
+                std::this_thread::yield();
+            }
 
-                Node* root_{ nullptr };
-                std::int64_t list_size_{ 0 };
+        private:
+            static constexpr std::int64_t max_pauses_ = 64;
+            std::int64_t pauses_{ 1 };
         };
 
-        template <typename T, Allocator Internal_allocator>
-            requires (!std::is_reference_v<T>)
-        class Stl_adapter_allocator {
+        // Serializes the operations of the internal allocator with a spin lock.
+        template <Allocator Internal_allocator>
+        class Synchronized_allocator final {
         public:
-            using value_type = T;
+            static constexpr bool is_thread_safe = true;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
 
-            constexpr Stl_adapter_allocator() = default;
-            constexpr Stl_adapter_allocator(const Stl_adapter_allocator& other) noexcept
+            constexpr Synchronized_allocator() = default;
+            constexpr explicit Synchronized_allocator(Internal_allocator internal) noexcept
+                : internal_(std::move(internal)) {}
+            constexpr Synchronized_allocator(const Synchronized_allocator& other) noexcept
                 : internal_(other.internal_) {}
-            constexpr Stl_adapter_allocator operator=(const Stl_adapter_allocator& other) noexcept
+            constexpr Synchronized_allocator& operator=(const Synchronized_allocator& other) noexcept
             {
                 if (this == &other) {
                     return *this;
                 }
+
+                lock();
                 internal_ = other.internal_;
+                unlock();
                 return *this;
             }
-            constexpr Stl_adapter_allocator(Stl_adapter_allocator&& other) noexcept
+            constexpr Synchronized_allocator(Synchronized_allocator&& other) noexcept
                 : internal_(std::move(other.internal_)) {}
-            constexpr Stl_adapter_allocator& operator=(Stl_adapter_allocator&& other) noexcept
+            constexpr Synchronized_allocator& operator=(Synchronized_allocator&& other) noexcept
             {
                 if (this == &other) {
                     return *this;
                 }
+
+                lock();
                 internal_ = std::move(other.internal_);
+                unlock();
                 return *this;
             }
-            constexpr ~Stl_adapter_allocator() = default;
+            constexpr ~Synchronized_allocator() = default;
 
-            template <typename U>
-                requires (!std::is_reference_v<U>)
-            constexpr Stl_adapter_allocator(const Stl_adapter_allocator<U, Internal_allocator>&) noexcept {}
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                lock();
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, s, location);
+                unlock();
+                return observe_allocation(*this, s, r);
+            }
 
-            [[nodiscard]] constexpr T* allocate(std::size_t n)
+            constexpr void deallocate(Block<void>& b) noexcept
             {
-                oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(n * MEMOC_SSIZEOF(T));
-                if (!r) {
-                    throw std::bad_alloc{};
+                observe_deallocation(*this, b);
+                lock();
+                internal_.deallocate(b);
+                unlock();
+            }
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            {
+                lock();
+                const bool owned = internal_.owns(b);
+                unlock();
+                return owned;
+            }
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                requires Sizing_allocator<Internal_allocator>
+            {
+                lock();
+                const Block<void>::Size_type gs = internal_.good_size(s);
+                unlock();
+                return gs;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Synchronized_allocator");
+                lock();
+                try {
+                    details::visit(internal_, v, "internal");
                 }
-                return reinterpret_cast<T*>(r.value().data());
+                catch (...) {
+                    unlock();
+                    throw;
+                }
+                unlock();
             }
 
-            constexpr void deallocate(T* p, std::size_t n) noexcept
+            // The lock is not recursive, the allocator should not be used by the thread that holds it.
+            // Held e.g. across fork(), so the child process does not inherit it held by another thread.
+            constexpr void lock() const noexcept
             {
-                Block<void> b = { safe_64_unsigned_to_signed_cast(n) * MEMOC_SSIZEOF(T), reinterpret_cast<void*>(p) };
-                internal_.deallocate(b);
+                Spin_backoff backoff{};
+                while (lock_.test_and_set(std::memory_order_acquire)) {
+                    backoff.wait();
+                }
+            }
+
+            constexpr void unlock() const noexcept
+            {
+                lock_.clear(std::memory_order_release);
             }
 
         private:
-            Internal_allocator internal_;
+
+            Internal_allocator internal_{};
+            mutable std::atomic_flag lock_{};
         };
 
-        template <Allocator Internal_allocator, std::int64_t Number_of_records>
-        class Stats_allocator final {
+        // Caches blocks of up to Max_size bytes per thread, in power of two size classes of up to Cache_size blocks each.
+        // Blocks beyond the cache capacity, and the cached ones on thread exit, are returned to the internal allocator,
+        // which should be thread safe and stateless. A block can be deallocated by a thread other than the allocating one.
+        // The caches are shared by all the instances of the same type.
+        template <Allocator Internal_allocator, Block<void>::Size_type Min_size, Block<void>::Size_type Max_size, std::int64_t Cache_size>
+        class Thread_cache_allocator final {
+            static_assert(Allocator_traits<Internal_allocator>::is_thread_safe && Allocator_traits<Internal_allocator>::is_stateless);
         public:
-            struct Record {
-                void* record_address{ nullptr };
-                void* request_address{ nullptr };
-                Block<void>::Size_type amount{ 0 };
-                std::chrono::time_point<std::chrono::system_clock> time;
-                Record* next{ nullptr };
-            };
+            static constexpr bool is_thread_safe = true;
+            static constexpr bool is_stateless = true;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
 
-            constexpr Stats_allocator() = default;
-            constexpr Stats_allocator(const Stats_allocator& other) noexcept
-                : internal_(other.internal_)
+            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
             {
-                for (Record* r = other.root_; r != nullptr; r = r->next) {
-                    add_record(r->request_address, r->amount - MEMOC_SSIZEOF(Record), r->time);
+                if (destroyed_) {
+                    Internal_allocator internal{};
+                    return observe_allocation(*this, s, allocate_at(internal, s, location));
                 }
+                return observe_allocation(*this, s, allocate_at(cache_.bucketizer, s, location));
             }
-            constexpr Stats_allocator operator=(const Stats_allocator& other) noexcept
+
+            constexpr void deallocate(Block<void>& b) noexcept
             {
-                if (this == &other) {
-                    return *this;
-                }
-                internal_ = other.internal_;
-                for (Record* r = other.root_; r != nullptr; r = r->next) {
-                    add_record(r->request_address, r->amount - MEMOC_SSIZEOF(Record), r->time);
+                observe_deallocation(*this, b);
+                if (destroyed_) {
+                    return Internal_allocator{}.deallocate(b);
                 }
-                return *this;
+                cache_.bucketizer.deallocate(b);
             }
-            constexpr Stats_allocator(Stats_allocator&& other) noexcept
-                : internal_(std::move(other.internal_)), number_of_records_(other.number_of_records_), total_allocated_(other.total_allocated_), root_(other.root_), tail_(other.tail_)
+
+            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
             {
-                other.number_of_records_ = other.total_allocated_ = 0;
-                other.root_ = other.tail_ = nullptr;
+                return Internal_allocator{}.owns(b);
             }
-            constexpr Stats_allocator& operator=(Stats_allocator&& other) noexcept
+
+            [[nodiscard]] constexpr Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
             {
-                if (this == &other) {
-                    return *this;
-                }
-                internal_ = std::move(other.internal_);
-                number_of_records_ = other.number_of_records_;
-                total_allocated_ = other.total_allocated_;
-                root_ = other.root_;
-                tail_ = other.tail_;
-                other.number_of_records_ = other.total_allocated_ = 0;
-                other.root_ = other.tail_ = nullptr;
-                return *this;
+                return Bucketizer<Internal_allocator, Min_size, Max_size, Cache_size>{}.good_size(s);
             }
-            constexpr ~Stats_allocator() noexcept
+
+            // Reports the cache of the calling thread.
+            void visit(Allocator_visitor& v) const
             {
-                Record* c = root_;
-                while (c) {
-                    Record* n = c->next;
-                    Block<void> b{ MEMOC_SSIZEOF(Record), c->record_address };
-                    internal_.deallocate(b);
-                    c = n;
+                v.type("Thread_cache_allocator");
+                v.parameter("min_size", Min_size);
+                v.parameter("max_size", Max_size);
+                v.parameter("cache_size", Cache_size);
+                if (destroyed_) {
+                    details::visit(Internal_allocator{}, v, "internal");
+                }
+                else {
+                    details::visit(cache_.bucketizer, v, "thread_cache");
                 }
             }
 
+        private:
+            struct Cache {
+                Bucketizer<Internal_allocator, Min_size, Max_size, Cache_size> bucketizer{};
+
+                // Blocks deallocated after the cache destruction, e.g. by other thread local destructors, bypass it
+                ~Cache() noexcept
+                {
+                    destroyed_ = true;
+                }
+            };
+
+            inline static thread_local Cache cache_{};
+            inline static thread_local bool destroyed_{ false };
+        };
+
+        class Null_allocator final {
+        public:
             [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
             {
-                oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(s);
-                if (!r) {
-                    return r;
-                }
-                Block<void> b(r.value());
-                if (!b.empty()) {
-                    add_record(b.data(), b.size());
-                }
-                return b;
+                return Block<void>();
             }
 
-            void constexpr deallocate(Block<void>& b) noexcept
+            constexpr void deallocate(Block<void>& b) noexcept
             {
-                Block<void> bc{ b };
-                internal_.deallocate(b);
-                if (b.empty()) {
-                    add_record(bc.data(), -bc.size());
-                }
             }
 
             [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
             {
-                return internal_.owns(b);
+                return false;
             }
 
-            constexpr const Record* stats_list() const noexcept {
-                return root_;
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Null_allocator");
             }
+        };
 
-            constexpr std::int64_t stats_list_size() const noexcept {
-                return number_of_records_;
-            }
+        // Holds an allocator of any type, for code that should not depend on the allocator type or that selects the allocator at runtime.
+        // Allocators up to inline_size bytes are stored in place, larger ones are allocated.
+        // A default constructed instance holds a Null_allocator.
+        class Any_allocator final {
+        public:
+            static constexpr std::int64_t inline_size = 6 * MEMOC_SSIZEOF(void*);
 
-            constexpr Block<void>::Size_type total_allocated() const noexcept {
-                return total_allocated_;
+            Any_allocator() noexcept
+            {
+                reset();
             }
 
-        private:
-            constexpr void add_record(void* p, Block<void>::Size_type a, std::chrono::time_point<std::chrono::system_clock> time = std::chrono::system_clock::now()) {
-                if (number_of_records_ >= Number_of_records) {
-                    tail_->next = root_;
-                    root_ = root_->next;
-                    tail_ = tail_->next;
-                    tail_->next = nullptr;
-                    tail_->request_address = p;
-                    tail_->amount = MEMOC_SSIZEOF(Record) + a;
-                    tail_->time = time;
-
-                    total_allocated_ += tail_->amount;
+            // Throws if memory allocation for the allocator failed.
+            // The constructor is explicit, and types without an allocate member are rejected before the Allocator concept is checked,
+            // since checking the concept for allocators over Any_allocator, or for wrappers such as oc::Expected, depends on this constructor.
+            template <typename A>
+                requires (!std::is_same_v<std::remove_cvref_t<A>, Any_allocator>
+                    && requires (std::remove_cvref_t<A>& a) { a.allocate(Block<void>::Size_type{}); }
+                    && Allocator<std::remove_cvref_t<A>>)
+            explicit Any_allocator(A&& allocator)
+                : ops_(&operations_<std::remove_cvref_t<A>>)
+            {
+                emplace<std::remove_cvref_t<A>>(std::forward<A>(allocator));
+            }
 
-                    return;
+            Any_allocator(const Any_allocator& other)
+                : ops_(other.ops_)
+            {
+                ops_->copy(other, *this);
+            }
+            Any_allocator& operator=(const Any_allocator& other)
+            {
+                if (this == &other) {
+                    return *this;
                 }
 
-                oc::Expected<Block<void>, Allocator_error> r = internal_.allocate(MEMOC_SSIZEOF(Record));
-                if (!r) {
-                    return;
-                }
-                Block<void> b1(r.value());
-                if (b1.empty()) {
-                    return;
+                Any_allocator tmp{ other };
+                *this = std::move(tmp);
+                return *this;
+            }
+            Any_allocator(Any_allocator&& other) noexcept
+                : ops_(other.ops_)
+            {
+                ops_->relocate(other, *this);
+                other.reset();
+            }
+            Any_allocator& operator=(Any_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
                 }
 
-                if (!root_) {
-                    root_ = reinterpret_cast<Record*>(b1.data());
-                    tail_ = root_;
-                }
-                else {
-                    tail_->next = reinterpret_cast<Record*>(b1.data());
-                    tail_ = tail_->next;
-                }
-                tail_->record_address = b1.data();
-                tail_->request_address = p;
-                tail_->amount = b1.size() + a;
-                tail_->time = time;
-                tail_->next = nullptr;
+                ops_->destroy(*this);
+                ops_ = other.ops_;
+                ops_->relocate(other, *this);
+                other.reset();
+                return *this;
+            }
+            ~Any_allocator() noexcept
+            {
+                ops_->destroy(*this);
+            }
 
-                total_allocated_ += tail_->amount;
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                return observe_allocation(*this, s, ops_->allocate(allocator_, s, location));
+            }
 
-                ++number_of_records_;
+            void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                ops_->deallocate(allocator_, b);
             }
 
-            Internal_allocator internal_;
+            [[nodiscard]] bool owns(const Block<void>& b) const noexcept
+            {
+                return ops_->owns(allocator_, b);
+            }
 
-            std::int64_t number_of_records_{ 0 };
-            Block<void>::Size_type total_allocated_{ 0 };
-            Record* root_{ nullptr };
-            Record* tail_{ nullptr };
-        };
+            // The held allocator if its type is A, otherwise null.
+            // Calls through the returned pointer are not dispatched through the operations table.
+            template <Allocator A>
+            [[nodiscard]] A* target() noexcept
+            {
+                return ops_ == &operations_<A> ? static_cast<A*>(allocator_) : nullptr;
+            }
 
-        template <Allocator Internal_allocator, std::int64_t id = -1>
-        class Shared_allocator final {
-        public:
-            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            template <Allocator A>
+            [[nodiscard]] const A* target() const noexcept
             {
-                return allocator_.allocate(s);
+                return ops_ == &operations_<A> ? static_cast<const A*>(allocator_) : nullptr;
             }
 
-            constexpr void deallocate(Block<void>& b) noexcept
+            template <Allocator A>
+            [[nodiscard]] bool holds() const noexcept
             {
-                allocator_.deallocate(b);
+                return ops_ == &operations_<A>;
             }
 
-            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            void visit(Allocator_visitor& v) const
             {
-                return allocator_.owns(b);
+                v.type("Any_allocator");
+                ops_->visit(allocator_, v);
             }
+
         private:
-            inline static Internal_allocator allocator_{};
-        };
+            struct Operations {
+                oc::Expected<Block<void>, Allocator_error>(*allocate)(void*, Block<void>::Size_type, const std::source_location&) noexcept;
+                void(*deallocate)(void*, Block<void>&) noexcept;
+                bool(*owns)(const void*, const Block<void>&) noexcept;
+                void(*copy)(const Any_allocator&, Any_allocator&);
+                void(*relocate)(Any_allocator&, Any_allocator&) noexcept;
+                void(*destroy)(Any_allocator&) noexcept;
+                void(*visit)(const void*, Allocator_visitor&);
+            };
 
-        class Null_allocator final {
-        public:
-            [[nodiscard]] constexpr oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            template <Allocator A>
+            static constexpr bool is_inline_ =
+                MEMOC_SSIZEOF(A) <= inline_size && alignof(A) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<A>;
+
+            template <Allocator A>
+            static oc::Expected<Block<void>, Allocator_error> allocate_as(void* a, Block<void>::Size_type s, const std::source_location& location) noexcept
             {
-                return Block<void>();
+                return allocate_at(*static_cast<A*>(a), s, location);
             }
 
-            constexpr void deallocate(Block<void>& b) noexcept
+            template <Allocator A>
+            static void deallocate_as(void* a, Block<void>& b) noexcept
             {
+                static_cast<A*>(a)->deallocate(b);
             }
 
-            [[nodiscard]] constexpr bool owns(const Block<void>& b) const noexcept
+            template <Allocator A>
+            static bool owns_as(const void* a, const Block<void>& b) noexcept
             {
-                return false;
+                return static_cast<const A*>(a)->owns(b);
+            }
+
+            template <Allocator A>
+            static void visit_as(const void* a, Allocator_visitor& v)
+            {
+                details::visit(*static_cast<const A*>(a), v, "target");
+            }
+
+            template <Allocator A>
+            static void copy_as(const Any_allocator& from, Any_allocator& to)
+            {
+                to.emplace<A>(*static_cast<const A*>(from.allocator_));
+            }
+
+            template <Allocator A>
+            static void relocate_as(Any_allocator& from, Any_allocator& to) noexcept
+            {
+                if constexpr (is_inline_<A>) {
+                    to.allocator_ = std::construct_at(reinterpret_cast<A*>(to.storage_), std::move(*static_cast<A*>(from.allocator_)));
+                    std::destroy_at(static_cast<A*>(from.allocator_));
+                }
+                else {
+                    to.allocator_ = from.allocator_;
+                }
+            }
+
+            template <Allocator A>
+            static void destroy_as(Any_allocator& any) noexcept
+            {
+                std::destroy_at(static_cast<A*>(any.allocator_));
+                if constexpr (!is_inline_<A>) {
+                    Block<void> b{ MEMOC_SSIZEOF(A), any.allocator_, Malloc_allocator::id };
+                    Malloc_allocator{}.deallocate(b);
+                }
+            }
+
+            template <Allocator A>
+            static constexpr Operations operations_{
+                &allocate_as<A>, &deallocate_as<A>, &owns_as<A>, &copy_as<A>, &relocate_as<A>, &destroy_as<A>, &visit_as<A> };
+
+            template <Allocator A, typename U>
+            void emplace(U&& allocator)
+            {
+                if constexpr (is_inline_<A>) {
+                    allocator_ = std::construct_at(reinterpret_cast<A*>(storage_), std::forward<U>(allocator));
+                }
+                else {
+                    Block<void> b = Malloc_allocator{}.allocate(MEMOC_SSIZEOF(A)).value();
+                    try {
+                        allocator_ = std::construct_at(static_cast<A*>(b.data()), std::forward<U>(allocator));
+                    }
+                    catch (...) {
+                        Malloc_allocator{}.deallocate(b);
+                        throw;
+                    }
+                }
+            }
+
+            // Also leaves a moved from instance holding a Null_allocator
+            void reset() noexcept
+            {
+                ops_ = &operations_<Null_allocator>;
+                allocator_ = std::construct_at(reinterpret_cast<Null_allocator*>(storage_));
             }
+
+            const Operations* ops_{ nullptr };
+            void* allocator_{ nullptr };
+            alignas(std::max_align_t) std::uint8_t storage_[inline_size];
         };
     }
 
+    using details::Adaptive_free_list_allocator;
+    using details::Aligned_allocator;
     using details::Allocator;
+    using details::Allocator_observer;
+    using details::Allocator_traits;
+    using details::Allocator_usage;
+    using details::Allocator_visitor;
+    using details::Any_allocator;
+    using details::Bulk_allocator;
+    using details::Bucketizer;
+    using details::Budget_allocator;
+    using details::Double_ended_stack_allocator;
+    using details::Expanding_allocator;
     using details::Fallback_allocator;
+    using details::Fallback_chain;
+    using details::Frame_allocator;
     using details::Free_list_allocator;
+    using details::Latency_allocator;
+    using details::Latency_histogram;
+    using details::Latency_summary;
+    using details::Lifetime;
+    using details::Lifetime_allocator;
+    using details::Lifetime_predicting_allocator;
     using details::Malloc_allocator;
     using details::Malloc_allocator;
+    using details::Memory_budget;
+    using details::Mmap_allocator;
+    using details::No_alloc_scope;
+    using details::Monotonic_allocator;
+    using details::Ring_allocator;
+    using details::Runtime_free_list_allocator;
+    using details::Runtime_stack_memory;
+    using details::Segregator;
     using details::Shared_allocator;
+    using details::Site_allocator;
+    using details::Site_stats_allocator;
+    using details::Sizing_allocator;
     using details::Null_allocator;
+    using details::Reallocating_allocator;
     using details::Stack_allocator;
+    using details::Stack_end;
+    using details::Stack_scope;
+    using details::Stamping_allocator;
+    using details::Static_arena;
+    using details::Static_arena_for;
     using details::Stats_allocator;
     using details::Stl_adapter_allocator;
+    using details::Synchronized_allocator;
+    using details::Thread_cache_allocator;
+    using details::Zeroing_allocator;
+
+    using details::allocate_at;
+    using details::type_id;
+    using details::visit;
+    using details::warm_up;
 }
 
 #endif // MEMOC_ALLOCATORS_H
@@ -128,7 +128,7 @@ namespace memoc {
         template <typename T1, typename T2>
         inline constexpr std::int64_t copy(const Block<T1>& src, Block<T2> dst) noexcept
         {
-            return copy(src, dst, src.size());
+            return memoc::details::copy(src, dst, src.size());
         }
 
         template <typename T1, typename T2>
@@ -264,7 +264,7 @@ namespace memoc {
         inline constexpr std::int64_t copy(const Block<T1>& src, Block<T2> dst) noexcept
         {
             constexpr const std::int64_t T1_size = MEMOC_SSIZEOF(std::conditional_t<std::is_same_v<void, T1>, std::uint8_t, T1>);
-            return copy(src, dst, src.size() *  T1_size);
+            return memoc::details::copy(src, dst, src.size() *  T1_size);
         }
 
         template <typename T>
@@ -7,6 +7,7 @@
 #include <type_traits>
 #include <concepts>
 #include <stdexcept>
+#include <source_location>
 
 #include <oc/err.h>
 #include <genum/genum.h>
@@ -25,7 +26,8 @@ namespace memoc {
             requires (!std::is_reference_v<T>)
         class Buffer final {
         public:
-            constexpr Buffer(std::int64_t size = 0, const T* data = nullptr)
+            // The location is the call site of the allocation, for allocators that attribute their allocations to call sites.
+            constexpr Buffer(std::int64_t size = 0, const T* data = nullptr, std::source_location location = std::source_location::current())
             {
                 OCERR_REQUIRE(size >= 0, std::invalid_argument, "invalid buffer size");
 
@@ -33,7 +35,7 @@ namespace memoc {
                     block_ = Block<T>(size, reinterpret_cast<T*>(stack_memory_));
                 }
                 else {
-                    Block<void> tmp = allocator_.allocate(size * MEMOC_SSIZEOF(T)).value();
+                    Block<void> tmp = allocate_at(allocator_, size * MEMOC_SSIZEOF(T), location).value();
                     block_ = Block<T>(size, reinterpret_cast<T*>(tmp.data()), tmp.hint());
                 }
 
@@ -69,12 +71,29 @@ namespace memoc {
                 }
                 copy(other.block_, block_);
             }
-            constexpr Buffer operator=(const Buffer& other)
+            constexpr Buffer& operator=(const Buffer& other)
             {
                 if (this == &other) {
                     return *this;
                 }
 
+                // Instances of a stateless allocator are interchangeable, so the allocated memory can be kept or resized.
+                if constexpr (Allocator_traits<Internal_allocator>::is_stateless) {
+                    if (block_.size() > Prioritized_stack_size && other.size() > Prioritized_stack_size) {
+                        if (block_.size() == other.size()) {
+                            copy(other.block_, block_);
+                            return *this;
+                        }
+                        if constexpr (Allocator_traits<Internal_allocator>::can_reallocate && std::is_fundamental_v<T>) {
+                            Block<void> tmp(block_.size() * MEMOC_SSIZEOF(T), reinterpret_cast<void*>(block_.data()), block_.hint());
+                            Block<void> resized = allocator_.reallocate(tmp, other.size() * MEMOC_SSIZEOF(T)).value();
+                            block_ = Block<T>(other.size(), reinterpret_cast<T*>(resized.data()), resized.hint());
+                            copy(other.block_, block_);
+                            return *this;
+                        }
+                    }
+                }
+
                 allocator_ = other.allocator_;
                 if (block_.size() > Prioritized_stack_size) {
                     Block<void> tmp(block_.size() * MEMOC_SSIZEOF(T), reinterpret_cast<void*>(block_.data()), block_.hint());
@@ -177,7 +196,7 @@ namespace memoc {
             }
 
         private:
-            Internal_allocator allocator_{};
+            [[no_unique_address]] Internal_allocator allocator_{};
 
             inline static constexpr const std::int64_t stack_memory_size_ = Prioritized_stack_size * MEMOC_SSIZEOF(T);
             std::uint8_t stack_memory_[Prioritized_stack_size == 0 ? 1 : stack_memory_size_];
@@ -188,7 +207,7 @@ namespace memoc {
         template <Allocator Internal_allocator, std::int64_t Prioritized_stack_size>
         class Buffer<void, Internal_allocator, Prioritized_stack_size> final {
         public:
-            constexpr Buffer(std::int64_t size = 0, const void* data = nullptr)
+            constexpr Buffer(std::int64_t size = 0, const void* data = nullptr, std::source_location location = std::source_location::current())
             {
                 OCERR_REQUIRE(size >= 0, std::invalid_argument, "invalid buffer size");
 
@@ -196,7 +215,7 @@ namespace memoc {
                     block_ = Block<void>(size, stack_memory_);
                 }
                 else {
-                    block_ = allocator_.allocate(size).value();
+                    block_ = allocate_at(allocator_, size, location).value();
                 }
                 copy(Block<void>(size, data), block_);
             }
@@ -216,12 +235,27 @@ namespace memoc {
                 }
                 copy(other.block_, block_);
             }
-            constexpr Buffer operator=(const Buffer& other)
+            constexpr Buffer& operator=(const Buffer& other)
             {
                 if (this == &other) {
                     return *this;
                 }
 
+                // Instances of a stateless allocator are interchangeable, so the allocated memory can be kept or resized.
+                if constexpr (Allocator_traits<Internal_allocator>::is_stateless) {
+                    if (block_.size() > Prioritized_stack_size && other.size() > Prioritized_stack_size) {
+                        if (block_.size() == other.size()) {
+                            copy(other.block_, block_);
+                            return *this;
+                        }
+                        if constexpr (Allocator_traits<Internal_allocator>::can_reallocate) {
+                            block_ = allocator_.reallocate(block_, other.size()).value();
+                            copy(other.block_, block_);
+                            return *this;
+                        }
+                    }
+                }
+
                 allocator_ = other.allocator_;
                 if (block_.size() > Prioritized_stack_size) {
                     allocator_.deallocate(block_);
@@ -310,7 +344,7 @@ namespace memoc {
             }
 
         private:
-            Internal_allocator allocator_{};
+            [[no_unique_address]] Internal_allocator allocator_{};
 
             std::uint8_t stack_memory_[Prioritized_stack_size == 0 ? 1 : Prioritized_stack_size];
 
@@ -318,10 +352,10 @@ namespace memoc {
         };
 
         template <typename T, Allocator Internal_allocator = Malloc_allocator, std::int64_t Prioritized_stack_size = 0>
-        [[nodiscard]] inline constexpr oc::Expected<Buffer<T, Internal_allocator, Prioritized_stack_size>, Buffer_error> create_buffer(std::int64_t size = 0, const T* data = nullptr)
+        [[nodiscard]] inline constexpr oc::Expected<Buffer<T, Internal_allocator, Prioritized_stack_size>, Buffer_error> create_buffer(std::int64_t size = 0, const T* data = nullptr, std::source_location location = std::source_location::current())
         {
             try {
-                return Buffer<T, Internal_allocator, Prioritized_stack_size>(size, data);
+                return Buffer<T, Internal_allocator, Prioritized_stack_size>(size, data, location);
             }
             catch (const std::invalid_argument&) {
                 return oc::Unexpected(Buffer_error::invalid_size);
@@ -0,0 +1,403 @@
+#ifndef MEMOC_CONFIG_H
+#define MEMOC_CONFIG_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+
+#include <oc/err.h>
+#include <genum/genum.h>
+
+#include <memoc/blocks.h>
+#include <memoc/allocators.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+extern char** environ;
+#endif
+
+GENUM_GENERATE(memoc, Config_error,
+    invalid_syntax,
+    invalid_value,
+    missing_key,
+    unknown_allocator,
+    unreadable_file);
+
+namespace memoc {
+    namespace details {
+        // Allocator parameters as key value pairs, loaded on startup from text, files or environment variables.
+        // Text lines are of the form 'key = value', empty lines and lines starting with '#' are ignored.
+        // Integer values can have a binary unit suffix of k, m or g, e.g. '64k'.
+        class Allocator_config final {
+        public:
+            [[nodiscard]] static oc::Expected<Allocator_config, Config_error> parse(std::string_view text)
+            {
+                Allocator_config config{};
+                while (!text.empty()) {
+                    const std::size_t end = text.find('\n');
+                    std::string_view line = trim(text.substr(0, end));
+                    text = end == std::string_view::npos ? std::string_view{} : text.substr(end + 1);
+
+                    if (line.empty() || line.front() == '#') {
+                        continue;
+                    }
+                    const std::size_t eq = line.find('=');
+                    if (eq == std::string_view::npos || trim(line.substr(0, eq)).empty()) {
+                        return oc::Unexpected(Config_error::invalid_syntax);
+                    }
+                    config.set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+                }
+                return config;
+            }
+
+            [[nodiscard]] static oc::Expected<Allocator_config, Config_error> from_file(const char* path)
+            {
+                std::ifstream file(path);
+                if (!file) {
+                    return oc::Unexpected(Config_error::unreadable_file);
+                }
+                std::stringstream text{};
+                text << file.rdbuf();
+                return parse(text.str());
+            }
+
+            // Variables of the form <prefix><KEY>, e.g. MEMOC_FREE_LIST_MAX_SIZE for the key free_list_max_size.
+            [[nodiscard]] static Allocator_config from_environment(std::string_view prefix = "MEMOC_")
+            {
+                Allocator_config config{};
+#if defined(__unix__) || defined(__APPLE__)
+                for (char** e = environ; e && *e; ++e) {
+                    const std::string_view variable{ *e };
+                    const std::size_t eq = variable.find('=');
+                    if (eq == std::string_view::npos || eq <= prefix.size() || variable.substr(0, prefix.size()) != prefix) {
+                        continue;
+                    }
+                    std::string key{ variable.substr(prefix.size(), eq - prefix.size()) };
+                    for (char& c : key) {
+                        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                    }
+                    config.set(key, variable.substr(eq + 1));
+                }
+#endif
+                return config;
+            }
+
+            void set(std::string_view key, std::string_view value)
+            {
+                for (auto& [k, v] : values_) {
+                    if (k == key) {
+                        v = value;
+                        return;
+                    }
+                }
+                values_.emplace_back(key, value);
+            }
+
+            // Values of the other configuration override the values of this one.
+            void merge(const Allocator_config& other)
+            {
+                for (const auto& [k, v] : other.values_) {
+                    set(k, v);
+                }
+            }
+
+            [[nodiscard]] std::optional<std::string_view> get(std::string_view key) const noexcept
+            {
+                for (const auto& [k, v] : values_) {
+                    if (k == key) {
+                        return v;
+                    }
+                }
+                return std::nullopt;
+            }
+
+            [[nodiscard]] oc::Expected<std::int64_t, Config_error> get_int(std::string_view key) const noexcept
+            {
+                const std::optional<std::string_view> value = get(key);
+                if (!value) {
+                    return oc::Unexpected(Config_error::missing_key);
+                }
+                return parse_int(*value);
+            }
+
+            // The default value is returned if the key is missing or its value is not an integer.
+            [[nodiscard]] std::int64_t get_int(std::string_view key, std::int64_t default_value) const noexcept
+            {
+                oc::Expected<std::int64_t, Config_error> r = get_int(key);
+                return r ? r.value() : default_value;
+            }
+
+            [[nodiscard]] static oc::Expected<std::int64_t, Config_error> parse_int(std::string_view text) noexcept
+            {
+                std::int64_t value{ 0 };
+                const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+                if (ec != std::errc{} || end == text.data()) {
+                    return oc::Unexpected(Config_error::invalid_value);
+                }
+
+                const std::string_view unit = text.substr(static_cast<std::size_t>(end - text.data()));
+                std::int64_t multiplier{ 1 };
+                if (unit == "k" || unit == "K") {
+                    multiplier = std::int64_t{ 1 } << 10;
+                }
+                else if (unit == "m" || unit == "M") {
+                    multiplier = std::int64_t{ 1 } << 20;
+                }
+                else if (unit == "g" || unit == "G") {
+                    multiplier = std::int64_t{ 1 } << 30;
+                }
+                else if (!unit.empty()) {
+                    return oc::Unexpected(Config_error::invalid_value);
+                }
+                if (value > std::numeric_limits<std::int64_t>::max() / multiplier || value < std::numeric_limits<std::int64_t>::min() / multiplier) {
+                    return oc::Unexpected(Config_error::invalid_value);
+                }
+                return value * multiplier;
+            }
+
+        private:
+            [[nodiscard]] static std::string_view trim(std::string_view text) noexcept
+            {
+                while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+                    text.remove_prefix(1);
+                }
+                while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+                    text.remove_suffix(1);
+                }
+                return text;
+            }
+
+            std::vector<std::pair<std::string, std::string>> values_{};
+        };
+
+        // Recursive descent parser of allocator specifications, see make_allocator.
+        class Allocator_spec_parser final {
+        public:
+            Allocator_spec_parser(std::string_view spec, const Allocator_config& config) noexcept
+                : spec_(spec), config_(config) {}
+
+            [[nodiscard]] oc::Expected<Any_allocator, Config_error> parse()
+            {
+                oc::Expected<Any_allocator, Config_error> r = parse_allocator();
+                skip_spaces();
+                if (r && position_ != spec_.size()) {
+                    return oc::Unexpected(Config_error::invalid_syntax);
+                }
+                return r;
+            }
+
+        private:
+            oc::Expected<Any_allocator, Config_error> parse_allocator()
+            {
+                const std::string_view name = parse_name();
+                if (name.empty()) {
+                    return oc::Unexpected(Config_error::invalid_syntax);
+                }
+
+                if (name == "malloc") {
+                    return Any_allocator{ Malloc_allocator{} };
+                }
+                if (name == "mmap") {
+                    return Any_allocator{ Mmap_allocator{} };
+                }
+                if (name == "null") {
+                    return Any_allocator{ Null_allocator{} };
+                }
+                if (name == "stack") {
+                    oc::Expected<Runtime_stack_memory, Config_error> memory = parse_stack_memory();
+                    if (!memory) {
+                        return oc::Unexpected(memory.error());
+                    }
+                    return Any_allocator{ Stack_allocator<Runtime_stack_memory>{ std::move(memory).value() } };
+                }
+                if (name == "free_list") {
+                    Runtime_free_list_parameters parameters{};
+                    if (!expect('(') || !parse_int(parameters.min_size) || !expect(',') || !parse_int(parameters.max_size) || !expect(',')
+                        || !parse_int(parameters.max_list_size) || !expect(',')) {
+                        return oc::Unexpected(error_);
+                    }
+                    return with_internal([&](auto internal) -> oc::Expected<Any_allocator, Config_error> {
+                        if (!expect(')')) {
+                            return oc::Unexpected(error_);
+                        }
+                        Runtime_free_list_allocator<decltype(internal)> allocator{ parameters, std::move(internal) };
+                        if (allocator.parameters().max_size != parameters.max_size) {
+                            return oc::Unexpected(Config_error::invalid_value);
+                        }
+                        return Any_allocator{ std::move(allocator) };
+                    });
+                }
+                if (name == "fallback") {
+                    if (!expect('(')) {
+                        return oc::Unexpected(error_);
+                    }
+                    return with_internal([&](auto primary) -> oc::Expected<Any_allocator, Config_error> {
+                        if (!expect(',')) {
+                            return oc::Unexpected(error_);
+                        }
+                        return with_internal([&](auto fallback) -> oc::Expected<Any_allocator, Config_error> {
+                            if (!expect(')')) {
+                                return oc::Unexpected(error_);
+                            }
+                            return Any_allocator{ Fallback_allocator<decltype(primary), decltype(fallback)>{ std::move(primary), std::move(fallback) } };
+                        });
+                    });
+                }
+                if (name == "synchronized") {
+                    if (!expect('(')) {
+                        return oc::Unexpected(error_);
+                    }
+                    return with_internal([&](auto internal) -> oc::Expected<Any_allocator, Config_error> {
+                        if (!expect(')')) {
+                            return oc::Unexpected(error_);
+                        }
+                        return Any_allocator{ Synchronized_allocator<decltype(internal)>{ std::move(internal) } };
+                    });
+                }
+                return oc::Unexpected(Config_error::unknown_allocator);
+            }
+
+            // Calls make with the internal allocator of a composite: the malloc, mmap and stack allocators are passed as is,
+            // so the composite calls them directly, and other allocators are passed held by an Any_allocator.
+            template <typename F>
+            oc::Expected<Any_allocator, Config_error> with_internal(F&& make)
+            {
+                const std::size_t first = position_;
+                const std::string_view name = parse_name();
+                if (name == "malloc") {
+                    return make(Malloc_allocator{});
+                }
+                if (name == "mmap") {
+                    return make(Mmap_allocator{});
+                }
+                if (name == "stack") {
+                    oc::Expected<Runtime_stack_memory, Config_error> memory = parse_stack_memory();
+                    if (!memory) {
+                        return oc::Unexpected(memory.error());
+                    }
+                    return make(Stack_allocator<Runtime_stack_memory>{ std::move(memory).value() });
+                }
+
+                position_ = first;
+                oc::Expected<Any_allocator, Config_error> internal = parse_allocator();
+                if (!internal) {
+                    return internal;
+                }
+                return make(std::move(internal).value());
+            }
+
+            oc::Expected<Runtime_stack_memory, Config_error> parse_stack_memory()
+            {
+                Runtime_stack_memory::Parameters parameters{};
+                if (!expect('(') || !parse_int(parameters.stacks_count) || !expect(',') || !parse_int(parameters.buffer_size) || !expect(')')) {
+                    return oc::Unexpected(error_);
+                }
+                Runtime_stack_memory memory{ parameters };
+                if (memory.parameters().buffer_size != parameters.buffer_size) {
+                    return oc::Unexpected(Config_error::invalid_value);
+                }
+                return memory;
+            }
+
+            std::string_view parse_name() noexcept
+            {
+                skip_spaces();
+                const std::size_t first = position_;
+                while (position_ < spec_.size() && (std::isalnum(static_cast<unsigned char>(spec_[position_])) || spec_[position_] == '_')) {
+                    ++position_;
+                }
+                return spec_.substr(first, position_ - first);
+            }
+
+            // An integer literal, or a reference to an integer configuration value of the form '$key'.
+            bool parse_int(std::int64_t& value) noexcept
+            {
+                skip_spaces();
+                oc::Expected<std::int64_t, Config_error> r = oc::Unexpected(Config_error::invalid_syntax);
+                if (position_ < spec_.size() && spec_[position_] == '$') {
+                    ++position_;
+                    const std::string_view key = parse_name();
+                    r = key.empty() ? oc::Expected<std::int64_t, Config_error>(oc::Unexpected(Config_error::invalid_syntax)) : config_.get_int(key);
+                }
+                else {
+                    const std::size_t first = position_;
+                    while (position_ < spec_.size() && (std::isalnum(static_cast<unsigned char>(spec_[position_])) || spec_[position_] == '-')) {
+                        ++position_;
+                    }
+                    r = Allocator_config::parse_int(spec_.substr(first, position_ - first));
+                }
+                if (!r) {
+                    error_ = r.error();
+                    return false;
+                }
+                value = r.value();
+                return true;
+            }
+
+            bool expect(char c) noexcept
+            {
+                skip_spaces();
+                if (position_ >= spec_.size() || spec_[position_] != c) {
+                    error_ = Config_error::invalid_syntax;
+                    return false;
+                }
+                ++position_;
+                return true;
+            }
+
+            void skip_spaces() noexcept
+            {
+                while (position_ < spec_.size() && std::isspace(static_cast<unsigned char>(spec_[position_]))) {
+                    ++position_;
+                }
+            }
+
+            std::string_view spec_;
+            const Allocator_config& config_;
+            std::size_t position_{ 0 };
+            Config_error error_{ Config_error::invalid_syntax };
+        };
+
+        // Builds an allocator from a textual specification of its composition, e.g.
+        // 'fallback(stack(1, 4k), free_list(16, 64, $free_list_max_list_size, malloc))'.
+        // Integer arguments are literals or references to configuration values of the form '$key'.
+        // The allocators are:
+        // - malloc, mmap and null
+        // - stack(stacks_count, buffer_size)
+        // - free_list(min_size, max_size, max_list_size, allocator)
+        // - fallback(primary, fallback)
+        // - synchronized(allocator)
+        // The allocator is returned held by an Any_allocator, whose dispatch costs about 7 times a direct call.
+        // Composites call their malloc, mmap and stack allocators directly, and other nested allocators through one more Any_allocator each,
+        // e.g. the free list of the example above. For the lowest cost the runtime configured allocators,
+        // e.g. Runtime_free_list_allocator, can be used directly with parameters from the configuration.
+        // Throws if memory allocation failed.
+        [[nodiscard]] inline oc::Expected<Any_allocator, Config_error> make_allocator(std::string_view spec, const Allocator_config& config = {})
+        {
+            return Allocator_spec_parser(spec, config).parse();
+        }
+
+        // Builds the allocator specified by the value of the 'allocator' key of the configuration.
+        [[nodiscard]] inline oc::Expected<Any_allocator, Config_error> make_allocator(const Allocator_config& config)
+        {
+            const std::optional<std::string_view> spec = config.get("allocator");
+            if (!spec) {
+                return oc::Unexpected(Config_error::missing_key);
+            }
+            return make_allocator(*spec, config);
+        }
+    }
+
+    using details::Allocator_config;
+    using details::make_allocator;
+}
+
+#endif // MEMOC_CONFIG_H
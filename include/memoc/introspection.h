@@ -0,0 +1,199 @@
+#ifndef MEMOC_INTROSPECTION_H
+#define MEMOC_INTROSPECTION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <memoc/allocators.h>
+
+namespace memoc {
+    namespace details {
+        // The description of an allocator and its internal allocators, as reported by their visit member functions.
+        struct Allocator_info {
+            std::string role{};
+            std::string type{};
+            std::vector<std::pair<std::string, std::int64_t>> parameters{};
+            Allocator_usage usage{};
+            std::vector<Allocator_info> children{};
+        };
+
+        class Allocator_info_builder final : public Allocator_visitor {
+        public:
+            void enter(std::string_view role) override
+            {
+                Allocator_info* info = &root_;
+                if (!path_.empty()) {
+                    path_.back()->children.emplace_back();
+                    info = &path_.back()->children.back();
+                }
+                info->role = role;
+                path_.push_back(info);
+            }
+
+            void type(std::string_view name) override
+            {
+                path_.back()->type = name;
+            }
+
+            void parameter(std::string_view name, std::int64_t value) override
+            {
+                path_.back()->parameters.emplace_back(name, value);
+            }
+
+            void usage(const Allocator_usage& u) override
+            {
+                path_.back()->usage = u;
+            }
+
+            void leave() override
+            {
+                path_.pop_back();
+            }
+
+            [[nodiscard]] Allocator_info release() noexcept
+            {
+                return std::move(root_);
+            }
+
+        private:
+            Allocator_info root_{};
+            // The entered allocators, each is the last child of the previous one
+            std::vector<Allocator_info*> path_{};
+        };
+
+        // Throws if memory allocation failed.
+        template <Allocator A>
+        [[nodiscard]] Allocator_info describe(const A& allocator)
+        {
+            Allocator_info_builder builder{};
+            details::visit(allocator, builder);
+            return builder.release();
+        }
+
+        // The usage values tracked by the allocator, in the order of the Allocator_usage members.
+        template <typename F>
+        void for_each_usage(const Allocator_usage& u, F&& f)
+        {
+            const std::pair<const char*, std::int64_t> values[] = {
+                { "bytes_in_use", u.bytes_in_use },
+                { "bytes_cached", u.bytes_cached },
+                { "bytes_overhead", u.bytes_overhead },
+                { "blocks_in_use", u.blocks_in_use },
+                { "blocks_cached", u.blocks_cached } };
+            for (const auto& [name, value] : values) {
+                if (value >= 0) {
+                    f(name, value);
+                }
+            }
+        }
+
+        inline void append_json_string(std::string& out, std::string_view s)
+        {
+            out += '"';
+            for (char c : s) {
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                    out += c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20) {
+                    constexpr char digits[] = "0123456789abcdef";
+                    out += "\\u00";
+                    out += digits[(c >> 4) & 0xf];
+                    out += digits[c & 0xf];
+                }
+                else {
+                    out += c;
+                }
+            }
+            out += '"';
+        }
+
+        inline void append_json(std::string& out, const Allocator_info& info)
+        {
+            out += "{\"role\":";
+            append_json_string(out, info.role);
+            out += ",\"type\":";
+            append_json_string(out, info.type);
+
+            out += ",\"parameters\":{";
+            for (std::size_t i = 0; i < info.parameters.size(); ++i) {
+                out += i > 0 ? "," : "";
+                append_json_string(out, info.parameters[i].first);
+                out += ':';
+                out += std::to_string(info.parameters[i].second);
+            }
+
+            out += "},\"usage\":{";
+            bool first = true;
+            for_each_usage(info.usage, [&](const char* name, std::int64_t value) {
+                out += first ? "" : ",";
+                first = false;
+                append_json_string(out, name);
+                out += ':';
+                out += std::to_string(value);
+            });
+
+            out += "},\"children\":[";
+            for (std::size_t i = 0; i < info.children.size(); ++i) {
+                out += i > 0 ? "," : "";
+                append_json(out, info.children[i]);
+            }
+            out += "]}";
+        }
+
+        inline void append_text(std::string& out, const Allocator_info& info, std::int64_t depth)
+        {
+            out.append(static_cast<std::size_t>(depth * 2), ' ');
+            if (!info.role.empty()) {
+                out += info.role;
+                out += ": ";
+            }
+            out += info.type;
+            for (const auto& [name, value] : info.parameters) {
+                out += ' ';
+                out += name;
+                out += '=';
+                out += std::to_string(value);
+            }
+            for_each_usage(info.usage, [&](const char* name, std::int64_t value) {
+                out += ' ';
+                out += name;
+                out += '=';
+                out += std::to_string(value);
+            });
+            out += '\n';
+
+            for (const Allocator_info& child : info.children) {
+                append_text(out, child, depth + 1);
+            }
+        }
+
+        // A single line JSON object, with the usage values tracked by each allocator.
+        // Throws if memory allocation failed.
+        [[nodiscard]] inline std::string to_json(const Allocator_info& info)
+        {
+            std::string out{};
+            append_json(out, info);
+            return out;
+        }
+
+        // A line per allocator, indented by its depth.
+        // Throws if memory allocation failed.
+        [[nodiscard]] inline std::string to_text(const Allocator_info& info)
+        {
+            std::string out{};
+            append_text(out, info, 0);
+            return out;
+        }
+    }
+
+    using details::Allocator_info;
+    using details::describe;
+    using details::to_json;
+    using details::to_text;
+}
+
+#endif // MEMOC_INTROSPECTION_H
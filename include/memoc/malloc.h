@@ -0,0 +1,152 @@
+#ifndef MEMOC_MALLOC_H
+#define MEMOC_MALLOC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <oc/err.h>
+#include <memoc/blocks.h>
+#include <memoc/allocators.h>
+
+namespace memoc {
+    namespace details {
+        // The C allocation functions over an allocator, for replacing malloc.
+        // Each allocation is preceded by a header that holds the size of the allocator block and the offset of the returned pointer in it.
+        // Blocks are deallocated without their hint, so the allocator should resolve the ownership of blocks by their address or size.
+        // Functions return nullptr if memory allocation failed, as the C functions do.
+        template <Allocator Internal_allocator>
+        class Malloc_interface final {
+        public:
+            static constexpr std::size_t default_alignment = alignof(std::max_align_t);
+
+            constexpr Malloc_interface() = default;
+            constexpr explicit Malloc_interface(Internal_allocator allocator) noexcept
+                : allocator_(std::move(allocator)) {}
+
+            [[nodiscard]] void* malloc(std::size_t n) noexcept
+            {
+                return allocate(n, default_alignment);
+            }
+
+            // The alignment should be a power of two.
+            [[nodiscard]] void* aligned_alloc(std::size_t alignment, std::size_t n) noexcept
+            {
+                if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+                    return nullptr;
+                }
+                return allocate(n, alignment > default_alignment ? alignment : default_alignment);
+            }
+
+            [[nodiscard]] void* calloc(std::size_t count, std::size_t n) noexcept
+            {
+                if (n != 0 && count > std::numeric_limits<std::size_t>::max() / n) {
+                    return nullptr;
+                }
+                void* p = allocate(count * n, default_alignment);
+                if (p) {
+                    std::memset(p, 0, count * n);
+                }
+                return p;
+            }
+
+            // Blocks are grown in place if their usable size suffices, otherwise moved to a new block with the default alignment.
+            [[nodiscard]] void* realloc(void* p, std::size_t n) noexcept
+            {
+                if (!p) {
+                    return malloc(n);
+                }
+                if (n == 0) {
+                    free(p);
+                    return nullptr;
+                }
+
+                const std::size_t us = usable_size(p);
+                if (n <= us) {
+                    return p;
+                }
+                void* np = malloc(n);
+                if (!np) {
+                    return nullptr;
+                }
+                std::memcpy(np, p, us);
+                free(p);
+                return np;
+            }
+
+            void free(void* p) noexcept
+            {
+                if (!p) {
+                    return;
+                }
+                const Header* h = header_of(p);
+                Block<void> b{ h->size, static_cast<std::uint8_t*>(p) - h->offset };
+                allocator_.deallocate(b);
+            }
+
+            [[nodiscard]] std::size_t usable_size(const void* p) const noexcept
+            {
+                if (!p) {
+                    return 0;
+                }
+                const Header* h = header_of(p);
+                if constexpr (Sizing_allocator<Internal_allocator>) {
+                    return static_cast<std::size_t>(allocator_.good_size(h->size) - h->offset);
+                }
+                else {
+                    return static_cast<std::size_t>(h->size - h->offset);
+                }
+            }
+
+            [[nodiscard]] constexpr Internal_allocator& allocator() noexcept
+            {
+                return allocator_;
+            }
+
+        private:
+            struct Header {
+                Block<void>::Size_type size{ 0 };
+                Block<void>::Size_type offset{ 0 };
+            };
+
+            static constexpr Block<void>::Size_type header_size_ = static_cast<Block<void>::Size_type>(default_alignment);
+            static_assert(MEMOC_SSIZEOF(Header) <= header_size_);
+
+            static const Header* header_of(const void* p) noexcept
+            {
+                return reinterpret_cast<const Header*>(static_cast<const std::uint8_t*>(p) - MEMOC_SSIZEOF(Header));
+            }
+
+            void* allocate(std::size_t n, std::size_t alignment) noexcept
+            {
+                // Padding is required if the blocks alignment does not suffice for the header and the requested alignment
+                const Block<void>::Size_type a = static_cast<Block<void>::Size_type>(alignment);
+                const Block<void>::Size_type padding =
+                    (a == header_size_ && Allocator_traits<Internal_allocator>::min_alignment >= header_size_) ? 0 : a - 1;
+                if (n > static_cast<std::size_t>(std::numeric_limits<Block<void>::Size_type>::max() - header_size_ - padding)) {
+                    return nullptr;
+                }
+
+                oc::Expected<Block<void>, Allocator_error> r = allocator_.allocate(static_cast<Block<void>::Size_type>(n) + header_size_ + padding);
+                if (!r || r.value().empty()) {
+                    return nullptr;
+                }
+
+                const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(r.value().data()) + static_cast<std::uintptr_t>(header_size_);
+                std::uint8_t* p = reinterpret_cast<std::uint8_t*>((first + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+                Header* h = reinterpret_cast<Header*>(p - MEMOC_SSIZEOF(Header));
+                h->size = r.value().size();
+                h->offset = p - static_cast<std::uint8_t*>(r.value().data());
+                return p;
+            }
+
+            Internal_allocator allocator_{};
+        };
+    }
+
+    using details::Malloc_interface;
+}
+
+#endif // MEMOC_MALLOC_H
@@ -4,6 +4,13 @@
 #include <memoc/blocks.h>
 #include <memoc/allocators.h>
 #include <memoc/buffers.h>
+#include <memoc/config.h>
+#include <memoc/introspection.h>
+#include <memoc/malloc.h>
+#include <memoc/metrics.h>
 #include <memoc/pointers.h>
+#include <memoc/pools.h>
+#include <memoc/resources.h>
+#include <memoc/slot_maps.h>
 
 #endif // MEMOC_MEMOC_H
@@ -0,0 +1,485 @@
+#ifndef MEMOC_METRICS_H
+#define MEMOC_METRICS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <source_location>
+
+#include <oc/err.h>
+#include <memoc/blocks.h>
+#include <memoc/allocators.h>
+
+namespace memoc {
+    namespace details {
+        // The metrics of an allocator, updated by relaxed atomic operations and read without synchronization with them.
+        struct Allocator_metrics {
+            static constexpr std::int64_t max_name_size = 63;
+
+            char name[max_name_size + 1]{};
+            std::atomic<std::int64_t> bytes_in_use{ 0 };
+            std::atomic<std::int64_t> peak_bytes{ 0 };
+            std::atomic<std::int64_t> allocations{ 0 };
+            std::atomic<std::int64_t> deallocations{ 0 };
+            std::atomic<std::int64_t> failures{ 0 };
+            std::atomic<std::int64_t> bytes_cached{ 0 };
+            std::atomic<std::int64_t> blocks_cached{ 0 };
+
+            void on_allocate(std::int64_t s) noexcept
+            {
+                allocations.fetch_add(1, std::memory_order_relaxed);
+                const std::int64_t in_use = bytes_in_use.fetch_add(s, std::memory_order_relaxed) + s;
+                std::int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+                while (in_use > peak && !peak_bytes.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+                }
+            }
+
+            void on_deallocate(std::int64_t s) noexcept
+            {
+                deallocations.fetch_add(1, std::memory_order_relaxed);
+                bytes_in_use.fetch_sub(s, std::memory_order_relaxed);
+            }
+
+            void on_failure() noexcept
+            {
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+        // Metrics of the registered allocators, collected without locks.
+        // Entries are allocated on registration and reused after unregistration, but deallocated only with the registry,
+        // so collection can traverse them concurrently with registration and allocation.
+        // An entry is not reused while it is collected, so its name is written only when it is not read.
+        // The registry should outlive its registered allocators.
+        class Metrics_registry final {
+        public:
+            Metrics_registry() = default;
+            Metrics_registry(const Metrics_registry&) = delete;
+            Metrics_registry& operator=(const Metrics_registry&) = delete;
+            Metrics_registry(Metrics_registry&&) = delete;
+            Metrics_registry& operator=(Metrics_registry&&) = delete;
+
+            ~Metrics_registry() noexcept
+            {
+                Entry* e = head_.load(std::memory_order_acquire);
+                while (e) {
+                    Entry* n = e->next;
+                    Block<void> b{ MEMOC_SSIZEOF(Entry), e };
+                    std::destroy_at(e);
+                    Malloc_allocator{}.deallocate(b);
+                    e = n;
+                }
+            }
+
+            // Cleared metrics with the name, truncated to Allocator_metrics::max_name_size, or nullptr if memory allocation failed.
+            // Names should be unique while registered.
+            [[nodiscard]] Allocator_metrics* add(std::string_view name) noexcept
+            {
+                Entry* e = claim();
+                if (!e) {
+                    return nullptr;
+                }
+                const std::size_t size = std::min(name.size(), static_cast<std::size_t>(Allocator_metrics::max_name_size));
+                std::memcpy(e->metrics.name, name.data(), size);
+                e->metrics.name[size] = '\0';
+                e->registered.store(true, std::memory_order_seq_cst);
+                return &e->metrics;
+            }
+
+            // Stops the collection of the metrics, which are reused by a later registration.
+            void remove(Allocator_metrics* metrics) noexcept
+            {
+                if (!metrics) {
+                    return;
+                }
+                for (Entry* e = head_.load(std::memory_order_acquire); e; e = e->next) {
+                    if (&e->metrics == metrics) {
+                        e->registered.store(false, std::memory_order_seq_cst);
+                        e->used.store(false, std::memory_order_release);
+                        return;
+                    }
+                }
+            }
+
+            // Calls f with each registered metrics.
+            template <typename F>
+            void for_each(F&& f) const
+            {
+                for (const Entry* e = head_.load(std::memory_order_acquire); e; e = e->next) {
+                    // Entries are read only if registered after their reader is counted, so a reused entry is either
+                    // skipped by its claim or read after its registration
+                    const Reader reader{ e };
+                    if (e->registered.load(std::memory_order_seq_cst)) {
+                        f(e->metrics);
+                    }
+                }
+            }
+
+        private:
+            struct Entry {
+                Allocator_metrics metrics{};
+                std::atomic<bool> used{ true };
+                std::atomic<bool> registered{ false };
+                mutable std::atomic<std::int64_t> readers{ 0 };
+                Entry* next{ nullptr };
+            };
+
+            // Counts a collection of an entry while it is alive.
+            struct Reader {
+                explicit Reader(const Entry* e) noexcept
+                    : entry(e)
+                {
+                    entry->readers.fetch_add(1, std::memory_order_seq_cst);
+                }
+                Reader(const Reader&) = delete;
+                Reader& operator=(const Reader&) = delete;
+                ~Reader() noexcept
+                {
+                    entry->readers.fetch_sub(1, std::memory_order_release);
+                }
+
+                const Entry* entry;
+            };
+
+            Entry* claim() noexcept
+            {
+                for (Entry* e = head_.load(std::memory_order_acquire); e; e = e->next) {
+                    bool used = e->used.load(std::memory_order_relaxed);
+                    if (!used && e->used.compare_exchange_strong(used, true, std::memory_order_acquire)) {
+                        if (e->readers.load(std::memory_order_seq_cst) != 0) {
+                            e->used.store(false, std::memory_order_release);
+                            continue;
+                        }
+                        Allocator_metrics& m = e->metrics;
+                        for (std::atomic<std::int64_t>* c : { &m.bytes_in_use, &m.peak_bytes, &m.allocations, &m.deallocations, &m.failures, &m.bytes_cached, &m.blocks_cached }) {
+                            c->store(0, std::memory_order_relaxed);
+                        }
+                        return e;
+                    }
+                }
+
+                oc::Expected<Block<void>, Allocator_error> r = Malloc_allocator{}.allocate(MEMOC_SSIZEOF(Entry));
+                if (!r) {
+                    return nullptr;
+                }
+                Entry* e = std::construct_at(static_cast<Entry*>(r.value().data()));
+                e->next = head_.load(std::memory_order_relaxed);
+                while (!head_.compare_exchange_weak(e->next, e, std::memory_order_release, std::memory_order_relaxed)) {
+                }
+                return e;
+            }
+
+            std::atomic<Entry*> head_{ nullptr };
+        };
+
+        // The registry of allocators registered without one, destructed after the allocators with static storage that use it.
+        [[nodiscard]] inline Metrics_registry& default_metrics_registry() noexcept
+        {
+            static Metrics_registry registry{};
+            return registry;
+        }
+
+        // Sums the cached bytes and blocks reported by an allocator and its internal allocators.
+        class Cache_usage_collector final : public Allocator_visitor {
+        public:
+            void enter(std::string_view) override {}
+            void type(std::string_view) override {}
+            void parameter(std::string_view, std::int64_t) override {}
+            void leave() override {}
+
+            void usage(const Allocator_usage& u) override
+            {
+                bytes_cached += std::max<std::int64_t>(u.bytes_cached, 0);
+                blocks_cached += std::max<std::int64_t>(u.blocks_cached, 0);
+            }
+
+            std::int64_t bytes_cached{ 0 };
+            std::int64_t blocks_cached{ 0 };
+        };
+
+        // Publishes the metrics of the internal allocator under the name to a registry, the default one if not specified.
+        // Copies share their metrics, which are unregistered with the last of them.
+        // The allocator works without metrics if it is default constructed or they could not be registered.
+        template <Allocator Internal_allocator>
+        class Metrics_allocator final {
+        public:
+            static constexpr bool is_thread_safe = Allocator_traits<Internal_allocator>::is_thread_safe;
+            static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Internal_allocator>::min_alignment;
+
+            Metrics_allocator() = default;
+            explicit Metrics_allocator(std::string_view name, Metrics_registry* registry = nullptr) noexcept
+                : registry_(registry ? registry : &default_metrics_registry())
+            {
+                oc::Expected<Block<void>, Allocator_error> r = Malloc_allocator{}.allocate(MEMOC_SSIZEOF(Registration));
+                if (!r) {
+                    return;
+                }
+                Allocator_metrics* metrics = registry_->add(name);
+                if (!metrics) {
+                    Malloc_allocator{}.deallocate(r.value());
+                    return;
+                }
+                registration_ = std::construct_at(static_cast<Registration*>(r.value().data()), metrics);
+            }
+            Metrics_allocator(std::string_view name, Internal_allocator internal, Metrics_registry* registry = nullptr) noexcept
+                : Metrics_allocator(name, registry)
+            {
+                internal_ = std::move(internal);
+            }
+
+            Metrics_allocator(const Metrics_allocator& other) noexcept
+                : internal_(other.internal_), registry_(other.registry_), registration_(other.registration_)
+            {
+                if (registration_) {
+                    registration_->references.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            Metrics_allocator& operator=(const Metrics_allocator& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+                release();
+                internal_ = other.internal_;
+                registry_ = other.registry_;
+                registration_ = other.registration_;
+                if (registration_) {
+                    registration_->references.fetch_add(1, std::memory_order_relaxed);
+                }
+                return *this;
+            }
+            Metrics_allocator(Metrics_allocator&& other) noexcept
+                : internal_(std::move(other.internal_)), registry_(other.registry_), registration_(std::exchange(other.registration_, nullptr)) {}
+            Metrics_allocator& operator=(Metrics_allocator&& other) noexcept
+            {
+                if (this == &other) {
+                    return *this;
+                }
+                release();
+                internal_ = std::move(other.internal_);
+                registry_ = other.registry_;
+                registration_ = std::exchange(other.registration_, nullptr);
+                return *this;
+            }
+            ~Metrics_allocator() noexcept
+            {
+                release();
+            }
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s, std::source_location location = std::source_location::current()) noexcept
+            {
+                oc::Expected<Block<void>, Allocator_error> r = allocate_at(internal_, s, location);
+                if (registration_) {
+                    if (!r) {
+                        registration_->metrics->on_failure();
+                    }
+                    else if (!r.value().empty()) {
+                        registration_->metrics->on_allocate(r.value().size());
+                    }
+                }
+                return observe_allocation(*this, s, r);
+            }
+
+            void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (registration_ && !b.empty()) {
+                    registration_->metrics->on_deallocate(b.size());
+                }
+                internal_.deallocate(b);
+            }
+
+            [[nodiscard]] bool owns(const Block<void>& b) const noexcept
+            {
+                return internal_.owns(b);
+            }
+
+            [[nodiscard]] Block<void>::Size_type good_size(Block<void>::Size_type s) const noexcept
+                requires Sizing_allocator<Internal_allocator>
+            {
+                return internal_.good_size(s);
+            }
+
+            std::int64_t warm_up(std::int64_t amount) noexcept
+            {
+                return memoc::details::warm_up(internal_, amount);
+            }
+
+            // Publishes the cached bytes and blocks of the internal allocators, as reported by their visit member functions.
+            // Should be called by a thread that may use the allocator, e.g. periodically from its event loop.
+            void refresh_cache_metrics() noexcept
+            {
+                if (!registration_) {
+                    return;
+                }
+                Cache_usage_collector collector{};
+                try {
+                    details::visit(internal_, collector);
+                }
+                catch (...) {
+                    return;
+                }
+                registration_->metrics->bytes_cached.store(collector.bytes_cached, std::memory_order_relaxed);
+                registration_->metrics->blocks_cached.store(collector.blocks_cached, std::memory_order_relaxed);
+            }
+
+            // The published metrics, nullptr if they could not be registered.
+            [[nodiscard]] const Allocator_metrics* metrics() const noexcept
+            {
+                return registration_ ? registration_->metrics : nullptr;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Metrics_allocator");
+                if (registration_) {
+                    const Allocator_metrics& m = *registration_->metrics;
+                    v.parameter("allocations", m.allocations.load(std::memory_order_relaxed));
+                    v.parameter("failures", m.failures.load(std::memory_order_relaxed));
+                    v.parameter("peak_bytes", m.peak_bytes.load(std::memory_order_relaxed));
+                    v.usage({ .bytes_in_use = m.bytes_in_use.load(std::memory_order_relaxed) });
+                }
+                details::visit(internal_, v, "internal");
+            }
+
+        private:
+            struct Registration {
+                explicit Registration(Allocator_metrics* m) noexcept
+                    : metrics(m) {}
+
+                Allocator_metrics* metrics;
+                std::atomic<std::int64_t> references{ 1 };
+            };
+
+            void release() noexcept
+            {
+                if (registration_ && registration_->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    registry_->remove(registration_->metrics);
+                    Block<void> b{ MEMOC_SSIZEOF(Registration), registration_ };
+                    std::destroy_at(registration_);
+                    Malloc_allocator{}.deallocate(b);
+                }
+                registration_ = nullptr;
+            }
+
+            Internal_allocator internal_{};
+            Metrics_registry* registry_{ nullptr };
+            Registration* registration_{ nullptr };
+        };
+
+        inline void append_prometheus_label(std::string& out, std::string_view value)
+        {
+            for (char c : value) {
+                if (c == '\\' || c == '"') {
+                    out += '\\';
+                    out += c;
+                }
+                else if (c == '\n') {
+                    out += "\\n";
+                }
+                else {
+                    out += c;
+                }
+            }
+        }
+
+        // Appends a family per metric with a sample per allocator labeled by its name. Counter samples have the _total suffix,
+        // which is also part of their family name in the Prometheus text format but not in the OpenMetrics one.
+        inline void append_metrics(std::string& out, const Metrics_registry& registry, bool open_metrics)
+        {
+            struct Family {
+                const char* name;
+                bool counter;
+                const char* help;
+                std::atomic<std::int64_t> Allocator_metrics::* value;
+            };
+            static constexpr Family families[] = {
+                { "memoc_bytes_in_use", false, "Bytes allocated and not deallocated.", &Allocator_metrics::bytes_in_use },
+                { "memoc_peak_bytes", false, "Highest bytes in use.", &Allocator_metrics::peak_bytes },
+                { "memoc_allocations", true, "Successful allocations of non empty blocks.", &Allocator_metrics::allocations },
+                { "memoc_deallocations", true, "Deallocations of non empty blocks.", &Allocator_metrics::deallocations },
+                { "memoc_allocation_failures", true, "Failed allocations.", &Allocator_metrics::failures },
+                { "memoc_bytes_cached", false, "Bytes cached by the internal allocators on the last refresh.", &Allocator_metrics::bytes_cached },
+                { "memoc_blocks_cached", false, "Blocks cached by the internal allocators on the last refresh.", &Allocator_metrics::blocks_cached } };
+
+            for (const Family& f : families) {
+                const std::string sample = std::string(f.name) + (f.counter ? "_total" : "");
+                const std::string family = open_metrics ? std::string(f.name) : sample;
+                out += "# HELP ";
+                out += family;
+                out += ' ';
+                out += f.help;
+                out += "\n# TYPE ";
+                out += family;
+                out += f.counter ? " counter\n" : " gauge\n";
+                registry.for_each([&](const Allocator_metrics& m) {
+                    out += sample;
+                    out += "{allocator=\"";
+                    append_prometheus_label(out, m.name);
+                    out += "\"} ";
+                    out += std::to_string((m.*f.value).load(std::memory_order_relaxed));
+                    out += '\n';
+                });
+            }
+        }
+
+        // The metrics of the registered allocators in the Prometheus text exposition format.
+        // Throws if memory allocation failed.
+        [[nodiscard]] inline std::string to_prometheus(const Metrics_registry& registry = default_metrics_registry())
+        {
+            std::string out{};
+            append_metrics(out, registry, false);
+            return out;
+        }
+
+        // The metrics of the registered allocators in the OpenMetrics text format, terminated by the EOF line.
+        // Throws if memory allocation failed.
+        [[nodiscard]] inline std::string to_openmetrics(const Metrics_registry& registry = default_metrics_registry())
+        {
+            std::string out{};
+            append_metrics(out, registry, true);
+            out += "# EOF\n";
+            return out;
+        }
+
+        // Writes the metrics to a temporary file and renames it to the path, so readers never see a partially written file.
+        // Returns false if the file could not be written.
+        // Throws if memory allocation failed.
+        inline bool write_prometheus(const char* path, const Metrics_registry& registry = default_metrics_registry())
+        {
+            const std::string text = to_prometheus(registry);
+            const std::string temporary = std::string(path) + ".tmp";
+
+            std::FILE* file = std::fopen(temporary.c_str(), "wb");
+            if (!file) {
+                return false;
+            }
+            const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+            if (std::fclose(file) != 0 || !written) {
+                std::remove(temporary.c_str());
+                return false;
+            }
+            if (std::rename(temporary.c_str(), path) != 0) {
+                std::remove(temporary.c_str());
+                return false;
+            }
+            return true;
+        }
+    }
+
+    using details::Allocator_metrics;
+    using details::Metrics_allocator;
+    using details::Metrics_registry;
+    using details::default_metrics_registry;
+    using details::to_prometheus;
+    using details::to_openmetrics;
+    using details::write_prometheus;
+}
+
+#endif // MEMOC_METRICS_H
@@ -5,6 +5,9 @@
 #include <cstdint>
 #include <compare>
 #include <utility>
+#include <source_location>
+#include <atomic>
+#include <type_traits>
 
 #include <memoc/allocators.h>
 //#include <erroc/errors.h>
@@ -24,7 +27,7 @@ namespace memoc {
 			dst_address->~T();
 		}
 
-		// These class are not thread safe
+		// These class are not thread safe, except for the reference counts of shared pointers of thread safe allocators
 		// The behaviour for array, pointer or reference is undefined
 		template <typename T, Allocator Internal_allocator = Malloc_allocator>
 		class Unique_ptr final {
@@ -158,7 +161,7 @@ namespace memoc {
 				}
 			}
 
-			Internal_allocator allocator_{};
+			[[no_unique_address]] Internal_allocator allocator_{};
 			T* ptr_{ nullptr };
 		};
 
@@ -196,11 +199,77 @@ namespace memoc {
 			return Unique_ptr<T, Internal_allocator>(ptr);
 		}
 
+		// make_unique with the call site of the allocation, for allocators that attribute their allocations to call sites.
+		template <typename T, Allocator Internal_allocator = Malloc_allocator, typename ...Args>
+		[[nodiscard]] inline constexpr Unique_ptr<T, Internal_allocator> make_unique_at(std::source_location location, Args&&... args)
+		{
+			Internal_allocator allocator_{};
+			Block<void> b = allocate_at(allocator_, MEMOC_SSIZEOF(T), location).value();
+			T* ptr = memoc::details::construct_at<T>(reinterpret_cast<T*>(b.data()), std::forward<Args>(args)...);
+			return Unique_ptr<T, Internal_allocator>(ptr);
+		}
+
+		// weak_count counts the weak pointers, and one more while there are shared owners.
 		struct Control_block {
 			std::int64_t use_count{ 0 };
 			std::int64_t weak_count{ 0 };
 		};
 
+		// Reference counts are atomic for thread safe allocators, whose shared pointers may be copied and released concurrently.
+		// Otherwise the pointers are not thread safe anyway, and the counts are plain integers.
+		template <bool Atomic>
+		struct Reference_counts {
+			static constexpr void increment(std::int64_t& count) noexcept
+			{
+				if constexpr (Atomic) {
+					if (!std::is_constant_evaluated()) {
+						std::atomic_ref<std::int64_t>(count).fetch_add(1, std::memory_order_relaxed);
+						return;
+					}
+				}
+				++count;
+			}
+
+			// Returns the decremented count.
+			static constexpr std::int64_t decrement(std::int64_t& count) noexcept
+			{
+				if constexpr (Atomic) {
+					if (!std::is_constant_evaluated()) {
+						return std::atomic_ref<std::int64_t>(count).fetch_sub(1, std::memory_order_acq_rel) - 1;
+					}
+				}
+				return --count;
+			}
+
+			// Increments a positive count, returns whether it was positive.
+			static constexpr bool increment_if_positive(std::int64_t& count) noexcept
+			{
+				if constexpr (Atomic) {
+					if (!std::is_constant_evaluated()) {
+						std::atomic_ref<std::int64_t> c(count);
+						std::int64_t current = c.load(std::memory_order_relaxed);
+						while (current > 0 && !c.compare_exchange_weak(current, current + 1, std::memory_order_relaxed)) {}
+						return current > 0;
+					}
+				}
+				if (count <= 0) {
+					return false;
+				}
+				++count;
+				return true;
+			}
+
+			[[nodiscard]] static constexpr std::int64_t load(const std::int64_t& count) noexcept
+			{
+				if constexpr (Atomic) {
+					if (!std::is_constant_evaluated()) {
+						return std::atomic_ref<std::int64_t>(const_cast<std::int64_t&>(count)).load(std::memory_order_relaxed);
+					}
+				}
+				return count;
+			}
+		};
+
 		template <typename T, Allocator Internal_allocator>
 		class Weak_ptr;
 
@@ -218,8 +287,8 @@ namespace memoc {
 				//ERROC_EXPECT((ptr && cb_) || (!ptr && !cb_), std::runtime_error, "internal memory allocation failed");
 				if (cb_) {
 					memoc::details::construct_at<Control_block>(cb_);
-					cb_->use_count = ptr_ ? 1 : 0;
-					cb_->weak_count = 0;
+					cb_->use_count = 1;
+					cb_->weak_count = 1;
 				}
 			}
 
@@ -227,15 +296,15 @@ namespace memoc {
 			constexpr Shared_ptr(const Shared_ptr<T_o, Internal_allocator>& other) noexcept
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(other.ptr_)
 			{
-				if (other.ptr_ && other.cb_) {
-					++cb_->use_count;
+				if (cb_) {
+					Counts::increment(cb_->use_count);
 				}
 			}
 			constexpr Shared_ptr(const Shared_ptr& other) noexcept
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(other.ptr_)
 			{
-				if (other.ptr_ && other.cb_) {
-					++cb_->use_count;
+				if (cb_) {
+					Counts::increment(cb_->use_count);
 				}
 			}
 
@@ -245,8 +314,8 @@ namespace memoc {
 			constexpr Shared_ptr(const Shared_ptr<T_o, Internal_allocator>& other, T* ptr) noexcept
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(ptr)
 			{
-				if (other.ptr_ && other.cb_) {
-					++cb_->use_count;
+				if (cb_) {
+					Counts::increment(cb_->use_count);
 				}
 			}
 
@@ -263,8 +332,8 @@ namespace memoc {
 				cb_ = other.cb_;
 				ptr_ = other.ptr_;
 
-				if (other.ptr_ && other.cb_) {
-					++cb_->use_count;
+				if (cb_) {
+					Counts::increment(cb_->use_count);
 				}
 				return *this;
 			}
@@ -280,8 +349,8 @@ namespace memoc {
 				cb_ = other.cb_;
 				ptr_ = other.ptr_;
 
-				if (other.ptr_ && other.cb_) {
-					++cb_->use_count;
+				if (cb_) {
+					Counts::increment(cb_->use_count);
 				}
 				return *this;
 			}
@@ -349,7 +418,7 @@ namespace memoc {
 
 			[[nodiscard]] constexpr std::int64_t use_count() const noexcept
 			{
-				return cb_ ? cb_->use_count : 0;
+				return cb_ ? Counts::load(cb_->use_count) : 0;
 			}
 
 			[[nodiscard]] constexpr T* get() const noexcept
@@ -389,7 +458,7 @@ namespace memoc {
 					//ERROC_EXPECT(cb_, std::runtime_error, "internal memory allocation failed");
 					memoc::details::construct_at<Control_block>(cb_);
 					cb_->use_count = 1;
-					cb_->weak_count = 0;
+					cb_->weak_count = 1;
 				}
 				else {
 					cb_ = nullptr;
@@ -424,21 +493,23 @@ namespace memoc {
 			friend constexpr std::strong_ordering operator<=>(const Shared_ptr<T_o, Internal_allocator_o>& lhs, std::nullptr_t) noexcept;
 
 		private:
+			using Counts = Reference_counts<Allocator_traits<Internal_allocator>::is_thread_safe>;
+
 			constexpr void remove_reference() noexcept
 			{
-				if (!ptr_ && !cb_) {
+				if (!cb_) {
 					return;
 				}
-				if (cb_->use_count > 0) {
-					--cb_->use_count;
+				if (Counts::decrement(cb_->use_count) > 0) {
+					return;
 				}
-				if (cb_->use_count == 0 && ptr_) {
+				if (ptr_) {
 					memoc::details::destruct_at<T>(ptr_);
 					Block<void> ptr_b = { MEMOC_SSIZEOF(T), const_cast<std::remove_const_t<T>*>(ptr_) };
 					allocator_.deallocate(ptr_b);
 					ptr_ = nullptr;
 				}
-				if (cb_->use_count == 0 && cb_->weak_count == 0) {
+				if (Counts::decrement(cb_->weak_count) == 0) {
 					memoc::details::destruct_at<Control_block>(cb_);
 					Block<void> cb_b = { MEMOC_SSIZEOF(Control_block), cb_ };
 					allocator_.deallocate(cb_b);
@@ -446,7 +517,7 @@ namespace memoc {
 				}
 			}
 
-			Internal_allocator allocator_{};
+			[[no_unique_address]] Internal_allocator allocator_{};
 			Control_block* cb_{ nullptr };
 			T* ptr_{ nullptr };
 		};
@@ -485,6 +556,16 @@ namespace memoc {
 			return Shared_ptr<T, Internal_allocator>(ptr);
 		}
 
+		// make_shared with the call site of the object allocation, the control block is allocated without it.
+		template <typename T, Allocator Internal_allocator = Malloc_allocator, typename ...Args>
+		[[nodiscard]] inline constexpr Shared_ptr<T, Internal_allocator> make_shared_at(std::source_location location, Args&&... args)
+		{
+			Internal_allocator allocator_{};
+			Block<void> b = allocate_at(allocator_, MEMOC_SSIZEOF(T), location).value();
+			T* ptr = memoc::details::construct_at<T>(reinterpret_cast<T*>(b.data()), std::forward<Args>(args)...);
+			return Shared_ptr<T, Internal_allocator>(ptr);
+		}
+
 		template <typename T, typename U, Allocator Internal_allocator = Malloc_allocator>
 		[[nodiscard]] inline constexpr Shared_ptr<T, Internal_allocator> static_pointer_cast(const Shared_ptr<U, Internal_allocator>& other) noexcept
 		{
@@ -556,36 +637,40 @@ namespace memoc {
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(other.ptr_)
 			{
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 			}
 			constexpr Weak_ptr(const Shared_ptr<T, Internal_allocator>& other) noexcept
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(other.ptr_)
 			{
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 			}
 			template <typename T_o>
 			constexpr Weak_ptr& operator=(const Shared_ptr<T_o, Internal_allocator>& other) noexcept
 			{
+				remove_reference();
+
 				allocator_ = other.allocator_;
 				cb_ = other.cb_;
 				ptr_ = other.ptr_;
 
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 				return *this;
 			}
 			constexpr Weak_ptr& operator=(const Shared_ptr<T, Internal_allocator>& other) noexcept
 			{
+				remove_reference();
+
 				allocator_ = other.allocator_;
 				cb_ = other.cb_;
 				ptr_ = other.ptr_;
 
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 				return *this;
 			}
@@ -595,14 +680,14 @@ namespace memoc {
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(other.ptr_)
 			{
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 			}
 			constexpr Weak_ptr(const Weak_ptr& other) noexcept
 				: allocator_(other.allocator_), cb_(other.cb_), ptr_(other.ptr_)
 			{
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 			}
 
@@ -620,7 +705,7 @@ namespace memoc {
 				ptr_ = other.ptr_;
 
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 				return *this;
 			}
@@ -637,7 +722,7 @@ namespace memoc {
 				ptr_ = other.ptr_;
 
 				if (cb_) {
-					++cb_->weak_count;
+					Counts::increment(cb_->weak_count);
 				}
 				return *this;
 			}
@@ -705,7 +790,7 @@ namespace memoc {
 
 			[[nodiscard]] constexpr std::int64_t use_count() const noexcept
 			{
-				return cb_ ? cb_->use_count : 0;
+				return cb_ ? Counts::load(cb_->use_count) : 0;
 			}
 
 			[[nodiscard]] constexpr bool expired() const noexcept
@@ -726,30 +811,24 @@ namespace memoc {
 			[[nodiscard]] constexpr Shared_ptr<T, Internal_allocator> lock() noexcept
 			{
 				Shared_ptr<T, Internal_allocator> sp{ nullptr };
-				if (!cb_) {
+				if (!cb_ || !ptr_ || !Counts::increment_if_positive(cb_->use_count)) {
 					return sp;
 				}
+				sp.allocator_ = allocator_;
 				sp.ptr_ = ptr_;
 				sp.cb_ = cb_;
-				if (ptr_) {
-					++sp.cb_->use_count;
-				}
 				return sp;
 			}
 
 		private:
+			using Counts = Reference_counts<Allocator_traits<Internal_allocator>::is_thread_safe>;
+
 			constexpr void remove_reference() noexcept
 			{
-				if (cb_ && !cb_->use_count) {
-					ptr_ = nullptr;
-				}
-				if (!ptr_ && !cb_) {
+				if (!cb_) {
 					return;
 				}
-				if (cb_->weak_count > 0) {
-					--cb_->weak_count;
-				}
-				if (cb_->use_count == 0 && cb_->weak_count == 0) {
+				if (Counts::decrement(cb_->weak_count) == 0) {
 					memoc::details::destruct_at<Control_block>(cb_);
 					Block<void> cb_b = { MEMOC_SSIZEOF(Control_block), cb_ };
 					allocator_.deallocate(cb_b);
@@ -757,7 +836,7 @@ namespace memoc {
 				}
 			}
 
-			Internal_allocator allocator_{};
+			[[no_unique_address]] Internal_allocator allocator_{};
 			Control_block* cb_{ nullptr };
 			T* ptr_{ nullptr };
 		};
@@ -769,7 +848,9 @@ namespace memoc {
 	using details::const_pointer_cast;
 	using details::dynamic_pointer_cast;
 	using details::make_shared;
+	using details::make_shared_at;
 	using details::make_unique;
+	using details::make_unique_at;
 	using details::reinterpret_pointer_cast;
 	using details::static_pointer_cast;
 }
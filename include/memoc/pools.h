@@ -0,0 +1,375 @@
+#ifndef MEMOC_POOLS_H
+#define MEMOC_POOLS_H
+
+#include <cstdint>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+#include <memory>
+
+#include <memoc/blocks.h>
+#include <memoc/allocators.h>
+#include <memoc/pointers.h>
+
+namespace memoc {
+    namespace details {
+        // Recycles constructed objects instead of destroying them, for objects that are expensive to construct.
+        // A released object is reset by its 'reset()' member function, if exists, and returned to the pool.
+        // Released objects are first cached per thread and then in the pool, up to Max_idle objects; beyond that they are destroyed.
+        // Each pool has its own cache per thread, for up to Thread_cached_pools pools of the same type per thread.
+        // Objects cached by a thread return to the pool when the thread exits, and are destroyed with the pool if it is destructed before.
+        // Objects are always destroyed and deallocated by the allocator of their pool.
+        // The pool should outlive the objects acquired from it, and should not be used concurrently with its destruction.
+        template <typename T, Allocator Internal_allocator = Malloc_allocator, std::int64_t Max_idle = 64, std::int64_t Thread_cache_size = 8, std::int64_t Thread_cached_pools = 8>
+            requires (!std::is_reference_v<T> && !std::is_array_v<T>)
+        class Object_pool final {
+            static_assert(Max_idle >= 0);
+            static_assert(Thread_cache_size >= 0);
+            static_assert(Thread_cached_pools > 0);
+        public:
+            class Handle final {
+            public:
+                constexpr Handle() = default;
+                Handle(const Handle&) = delete;
+                Handle& operator=(const Handle&) = delete;
+                constexpr Handle(Handle&& other) noexcept
+                    : pool_(other.pool_), ptr_(other.ptr_)
+                {
+                    other.pool_ = nullptr;
+                    other.ptr_ = nullptr;
+                }
+                constexpr Handle& operator=(Handle&& other) noexcept
+                {
+                    if (this == &other) {
+                        return *this;
+                    }
+
+                    reset();
+                    pool_ = other.pool_;
+                    ptr_ = other.ptr_;
+                    other.pool_ = nullptr;
+                    other.ptr_ = nullptr;
+                    return *this;
+                }
+                constexpr ~Handle() noexcept
+                {
+                    reset();
+                }
+
+                [[nodiscard]] constexpr T* get() const noexcept
+                {
+                    return ptr_;
+                }
+
+                [[nodiscard]] constexpr T* operator->() const noexcept
+                {
+                    return ptr_;
+                }
+
+                [[nodiscard]] constexpr T& operator*() const noexcept
+                {
+                    return *ptr_;
+                }
+
+                [[nodiscard]] constexpr explicit operator bool() const noexcept
+                {
+                    return ptr_;
+                }
+
+                // Returns the object to its pool
+                constexpr void reset() noexcept
+                {
+                    if (ptr_) {
+                        pool_->recycle(ptr_);
+                        ptr_ = nullptr;
+                    }
+                }
+
+            private:
+                friend class Object_pool;
+
+                constexpr Handle(Object_pool* pool, T* ptr) noexcept
+                    : pool_(pool), ptr_(ptr) {}
+
+                Object_pool* pool_{ nullptr };
+                T* ptr_{ nullptr };
+            };
+
+            constexpr Object_pool() = default;
+            constexpr explicit Object_pool(Internal_allocator allocator) noexcept
+                : allocator_(std::move(allocator)) {}
+            Object_pool(const Object_pool&) = delete;
+            Object_pool& operator=(const Object_pool&) = delete;
+            Object_pool(Object_pool&&) = delete;
+            Object_pool& operator=(Object_pool&&) = delete;
+            ~Object_pool() noexcept
+            {
+                // Caches handed over by exiting threads move their objects to the idle objects, which are destroyed last
+                if constexpr (Thread_cache_size > 0) {
+                    Thread_cache* c = caches_;
+                    while (c) {
+                        Thread_cache* next = c->next;
+                        c->lock_node();
+                        for (std::int64_t i = 0; i < c->count; ++i) {
+                            destroy(allocator_, c->objects[i]);
+                        }
+                        c->count = 0;
+                        c->pool_alive.store(false, std::memory_order_relaxed);
+                        const bool release = !c->thread_alive.load(std::memory_order_relaxed);
+                        c->unlock_node();
+                        if (release) {
+                            free_thread_cache(c);
+                        }
+                        c = next;
+                    }
+                }
+                for (std::int64_t i = 0; i < idle_count_; ++i) {
+                    destroy(allocator_, idle_[i]);
+                }
+            }
+
+            // Returns an idle object if available, otherwise constructs a new one from args.
+            // Throws if memory allocation failed.
+            template <typename ...Args>
+            [[nodiscard]] Handle acquire(Args&&... args)
+            {
+                if constexpr (Thread_cache_size > 0) {
+                    Thread_cache* c = thread_cache(false);
+                    if (c && c->count > 0) {
+                        return Handle(this, c->objects[--c->count]);
+                    }
+                }
+                if constexpr (Max_idle > 0) {
+                    lock();
+                    if (idle_count_ > 0) {
+                        T* ptr = idle_[--idle_count_];
+                        unlock();
+                        return Handle(this, ptr);
+                    }
+                    unlock();
+                }
+
+                Block<void> b = allocator_.allocate(MEMOC_SSIZEOF(T)).value();
+                try {
+                    T* ptr = memoc::details::construct_at<T>(reinterpret_cast<T*>(b.data()), std::forward<Args>(args)...);
+                    created_.fetch_add(1, std::memory_order_relaxed);
+                    return Handle(this, ptr);
+                }
+                catch (...) {
+                    allocator_.deallocate(b);
+                    throw;
+                }
+            }
+
+            // Number of idle objects held by the pool, not including the per thread caches.
+            [[nodiscard]] std::int64_t idle_count() const noexcept
+            {
+                lock();
+                const std::int64_t count = idle_count_;
+                unlock();
+                return count;
+            }
+
+            // Number of objects constructed by the pool.
+            [[nodiscard]] std::int64_t created() const noexcept
+            {
+                return created_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            static constexpr void reset_object(T* ptr) noexcept
+            {
+                if constexpr (requires (T& t) { t.reset(); }) {
+                    ptr->reset();
+                }
+            }
+
+            static constexpr void destroy(Internal_allocator& allocator, T* ptr) noexcept
+            {
+                memoc::details::destruct_at<T>(ptr);
+                Block<void> b{ MEMOC_SSIZEOF(T), ptr };
+                allocator.deallocate(b);
+            }
+
+            void recycle(T* ptr) noexcept
+            {
+                reset_object(ptr);
+
+                if constexpr (Thread_cache_size > 0) {
+                    Thread_cache* c = thread_cache(true);
+                    if (c && c->count < Thread_cache_size) {
+                        c->objects[c->count++] = ptr;
+                        return;
+                    }
+                }
+                keep_or_destroy(ptr);
+            }
+
+            void keep_or_destroy(T* ptr) noexcept
+            {
+                if constexpr (Max_idle > 0) {
+                    lock();
+                    if (idle_count_ < Max_idle) {
+                        idle_[idle_count_++] = ptr;
+                        unlock();
+                        return;
+                    }
+                    unlock();
+                }
+                destroy(allocator_, ptr);
+            }
+
+            void lock() const noexcept
+            {
+                while (lock_.test_and_set(std::memory_order_acquire)) {}
+            }
+
+            void unlock() const noexcept
+            {
+                lock_.clear(std::memory_order_release);
+            }
+
+            // The objects cached by a thread for a pool, used without synchronization by the thread.
+            // Linked by the pool and referenced by the thread, and released by the last of them to hand it over, under its lock.
+            // A cache handed over by its thread is reused for another thread of the pool.
+            struct Thread_cache {
+                Object_pool* pool{ nullptr };
+                T* objects[Thread_cache_size == 0 ? 1 : Thread_cache_size]{};
+                std::int64_t count{ 0 };
+                std::atomic<bool> pool_alive{ true };
+                std::atomic<bool> thread_alive{ true };
+                std::atomic_flag lock{};
+                Thread_cache* next{ nullptr };
+
+                void lock_node() noexcept
+                {
+                    while (lock.test_and_set(std::memory_order_acquire)) {}
+                }
+
+                void unlock_node() noexcept
+                {
+                    lock.clear(std::memory_order_release);
+                }
+            };
+
+            // The caches of the pools of this type used by a thread.
+            struct Thread_caches {
+                Thread_cache* caches[Thread_cached_pools]{};
+
+                ~Thread_caches() noexcept
+                {
+                    for (Thread_cache*& c : caches) {
+                        if (c) {
+                            hand_over(c);
+                            c = nullptr;
+                        }
+                    }
+                    destroyed_ = true;
+                }
+            };
+
+            // Hands over a cache by its thread, returning the cached objects to the pool if it is alive.
+            static void hand_over(Thread_cache* c) noexcept
+            {
+                c->lock_node();
+                if (c->pool_alive.load(std::memory_order_relaxed)) {
+                    for (std::int64_t i = 0; i < c->count; ++i) {
+                        c->pool->keep_or_destroy(c->objects[i]);
+                    }
+                    c->count = 0;
+                }
+                const bool release = !c->pool_alive.load(std::memory_order_relaxed);
+                c->thread_alive.store(false, std::memory_order_release);
+                c->unlock_node();
+                if (release) {
+                    free_thread_cache(c);
+                }
+            }
+
+            static void free_thread_cache(Thread_cache* c) noexcept
+            {
+                Block<void> b{ MEMOC_SSIZEOF(Thread_cache), c };
+                std::destroy_at(c);
+                Malloc_allocator{}.deallocate(b);
+            }
+
+            // The cache of the calling thread for the pool, added if requested and there is room for it, otherwise nullptr.
+            Thread_cache* thread_cache(bool add) noexcept
+            {
+                if (destroyed_) {
+                    return nullptr;
+                }
+                Thread_caches& t = thread_caches_;
+                Thread_cache** empty = nullptr;
+                for (Thread_cache*& c : t.caches) {
+                    if (c && c->pool == this && c->pool_alive.load(std::memory_order_relaxed)) {
+                        return c;
+                    }
+                    if (!empty && !c) {
+                        empty = &c;
+                    }
+                }
+                if (!add) {
+                    return nullptr;
+                }
+                if (!empty) {
+                    // Caches of destructed pools are released by the thread
+                    for (Thread_cache*& c : t.caches) {
+                        if (!c->pool_alive.load(std::memory_order_acquire)) {
+                            hand_over(c);
+                            c = nullptr;
+                            empty = &c;
+                            break;
+                        }
+                    }
+                    if (!empty) {
+                        return nullptr;
+                    }
+                }
+                *empty = add_thread_cache();
+                return *empty;
+            }
+
+            Thread_cache* add_thread_cache() noexcept
+            {
+                lock();
+                for (Thread_cache* c = caches_; c; c = c->next) {
+                    if (!c->thread_alive.load(std::memory_order_acquire)) {
+                        c->thread_alive.store(true, std::memory_order_relaxed);
+                        unlock();
+                        return c;
+                    }
+                }
+                unlock();
+
+                oc::Expected<Block<void>, Allocator_error> r = Malloc_allocator{}.allocate(MEMOC_SSIZEOF(Thread_cache));
+                if (!r) {
+                    return nullptr;
+                }
+                Thread_cache* c = std::construct_at(static_cast<Thread_cache*>(r.value().data()));
+                c->pool = this;
+                lock();
+                c->next = caches_;
+                caches_ = c;
+                unlock();
+                return c;
+            }
+
+            inline static thread_local Thread_caches thread_caches_{};
+            inline static thread_local bool destroyed_{ false };
+
+            Internal_allocator allocator_{};
+            Thread_cache* caches_{ nullptr };
+
+            mutable std::atomic_flag lock_{};
+            T* idle_[Max_idle == 0 ? 1 : Max_idle]{};
+            std::int64_t idle_count_{ 0 };
+
+            std::atomic<std::int64_t> created_{ 0 };
+        };
+    }
+
+    using details::Object_pool;
+}
+
+#endif // MEMOC_POOLS_H
@@ -0,0 +1,231 @@
+#ifndef MEMOC_RESOURCES_H
+#define MEMOC_RESOURCES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <memory_resource>
+
+#include <oc/err.h>
+#include <memoc/blocks.h>
+#include <memoc/allocators.h>
+
+namespace memoc {
+    namespace details {
+        // A polymorphic memory resource over an allocator, for std::pmr containers.
+        // Blocks are deallocated with their hint: the stamp of stamping allocators, otherwise the hint kept in a header before each block.
+        // Alignments above the allocator minimal alignment, for stamping allocators without aligned allocation, are satisfied by over-allocation,
+        // with the offset of the block kept in the padding before it.
+        // Throws std::bad_alloc if memory allocation failed.
+        template <Allocator Internal_allocator>
+        class Memory_resource_adapter final : public std::pmr::memory_resource {
+        public:
+            Memory_resource_adapter() = default;
+            explicit Memory_resource_adapter(Internal_allocator allocator) noexcept
+                : allocator_(std::move(allocator)) {}
+
+            [[nodiscard]] Internal_allocator& allocator() noexcept
+            {
+                return allocator_;
+            }
+
+            [[nodiscard]] const Internal_allocator& allocator() const noexcept
+            {
+                return allocator_;
+            }
+
+        private:
+            struct Header {
+                void* data{ nullptr };
+                std::int64_t hint{ std::numeric_limits<std::int64_t>::min() };
+            };
+
+            static constexpr bool keeps_hint_in_header = !Stamping_allocator<Internal_allocator>;
+
+            static constexpr bool aligns_by_padding(std::size_t alignment) noexcept
+            {
+                return !Aligned_allocator<Internal_allocator>
+                    && static_cast<Block<void>::Size_type>(alignment) > Allocator_traits<Internal_allocator>::min_alignment;
+            }
+
+            // The size of the offset kept before a padded block
+            static constexpr std::size_t offset_size(std::size_t alignment) noexcept
+            {
+                return alignment < 256 ? 1 : sizeof(std::size_t);
+            }
+
+            static constexpr std::size_t header_alignment(std::size_t alignment) noexcept
+            {
+                return std::max(alignment, alignof(Header));
+            }
+
+            // The allocated size and the space reserved before the returned pointer
+            static constexpr std::pair<Block<void>::Size_type, std::size_t> padding(std::size_t bytes, std::size_t alignment) noexcept
+            {
+                if constexpr (keeps_hint_in_header) {
+                    return { safe_64_unsigned_to_signed_cast(bytes + header_alignment(alignment) - 1 + sizeof(Header)), sizeof(Header) };
+                }
+                else {
+                    return { safe_64_unsigned_to_signed_cast(bytes + alignment - 1 + offset_size(alignment)), offset_size(alignment) };
+                }
+            }
+
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override
+            {
+                if (keeps_hint_in_header || aligns_by_padding(alignment)) {
+                    const auto [size, reserved] = padding(bytes, alignment);
+                    oc::Expected<Block<void>, Allocator_error> r = allocator_.allocate(size);
+                    if (!r || r.value().empty()) {
+                        throw std::bad_alloc{};
+                    }
+
+                    const std::size_t a = keeps_hint_in_header ? header_alignment(alignment) : alignment;
+                    const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(r.value().data()) + reserved;
+                    std::uint8_t* p = reinterpret_cast<std::uint8_t*>((first + a - 1) & ~(a - 1));
+                    if constexpr (keeps_hint_in_header) {
+                        Header* h = reinterpret_cast<Header*>(p - sizeof(Header));
+                        h->data = r.value().data();
+                        h->hint = r.value().hint();
+                    }
+                    else {
+                        const std::size_t offset = static_cast<std::size_t>(p - static_cast<std::uint8_t*>(r.value().data()));
+                        if (reserved == 1) {
+                            p[-1] = static_cast<std::uint8_t>(offset);
+                        }
+                        else {
+                            std::memcpy(p - reserved, &offset, sizeof(offset));
+                        }
+                    }
+                    return p;
+                }
+
+                oc::Expected<Block<void>, Allocator_error> r = [&]() {
+                    if constexpr (Aligned_allocator<Internal_allocator>) {
+                        return allocator_.allocate_aligned(safe_64_unsigned_to_signed_cast(bytes), safe_64_unsigned_to_signed_cast(alignment));
+                    }
+                    else {
+                        return allocator_.allocate(safe_64_unsigned_to_signed_cast(bytes));
+                    }
+                }();
+                if (!r) {
+                    throw std::bad_alloc{};
+                }
+                return r.value().data();
+            }
+
+            void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+            {
+                if constexpr (keeps_hint_in_header) {
+                    const Header* h = reinterpret_cast<const Header*>(static_cast<std::uint8_t*>(p) - sizeof(Header));
+                    Block<void> b{ padding(bytes, alignment).first, h->data, h->hint };
+                    allocator_.deallocate(b);
+                }
+                else {
+                    if (aligns_by_padding(alignment)) {
+                        const std::size_t reserved = padding(bytes, alignment).second;
+                        std::size_t offset = 0;
+                        if (reserved == 1) {
+                            offset = static_cast<std::uint8_t*>(p)[-1];
+                        }
+                        else {
+                            std::memcpy(&offset, static_cast<std::uint8_t*>(p) - reserved, sizeof(offset));
+                        }
+                        Block<void> b{ padding(bytes, alignment).first, static_cast<std::uint8_t*>(p) - offset, Internal_allocator::id };
+                        allocator_.deallocate(b);
+                        return;
+                    }
+
+                    Block<void> b{ safe_64_unsigned_to_signed_cast(bytes), p, Internal_allocator::id };
+                    allocator_.deallocate(b);
+                }
+            }
+
+            // Resources of a stateless allocator type are interchangeable.
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+            {
+                if (this == &other) {
+                    return true;
+                }
+                if constexpr (Allocator_traits<Internal_allocator>::is_stateless) {
+                    return dynamic_cast<const Memory_resource_adapter*>(&other) != nullptr;
+                }
+                else {
+                    return false;
+                }
+            }
+
+            Internal_allocator allocator_{};
+        };
+
+        // An allocator over a polymorphic memory resource, the default resource if not specified.
+        // Blocks are stamped with the resource address, which should outlive them.
+        class Memory_resource_allocator final {
+        public:
+            static constexpr Block<void>::Size_type min_alignment = static_cast<Block<void>::Size_type>(alignof(std::max_align_t));
+
+            Memory_resource_allocator() noexcept
+                : resource_(std::pmr::get_default_resource()) {}
+            explicit Memory_resource_allocator(std::pmr::memory_resource* resource) noexcept
+                : resource_(resource ? resource : std::pmr::get_default_resource()) {}
+
+            [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+            {
+                if (s < 0) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::invalid_size));
+                }
+                if (s == 0) {
+                    return observe_allocation(*this, s, Block<void>());
+                }
+                No_alloc_scope::on_system_allocation(s);
+                try {
+                    return observe_allocation(*this, s, Block<void>(s, resource_->allocate(static_cast<std::size_t>(s), alignof(std::max_align_t)), stamp()));
+                }
+                catch (...) {
+                    return observe_allocation(*this, s, oc::Unexpected(Allocator_error::out_of_memory));
+                }
+            }
+
+            void deallocate(Block<void>& b) noexcept
+            {
+                observe_deallocation(*this, b);
+                if (b.empty()) {
+                    return;
+                }
+                resource_->deallocate(b.data(), static_cast<std::size_t>(b.size()), alignof(std::max_align_t));
+                b = Block<void>();
+            }
+
+            [[nodiscard]] bool owns(const Block<void>& b) const noexcept
+            {
+                return b.data() && b.hint() == stamp();
+            }
+
+            [[nodiscard]] std::pmr::memory_resource* resource() const noexcept
+            {
+                return resource_;
+            }
+
+            void visit(Allocator_visitor& v) const
+            {
+                v.type("Memory_resource_allocator");
+            }
+
+        private:
+            [[nodiscard]] std::int64_t stamp() const noexcept
+            {
+                return static_cast<std::int64_t>(reinterpret_cast<std::intptr_t>(resource_));
+            }
+
+            std::pmr::memory_resource* resource_;
+        };
+    }
+
+    using details::Memory_resource_adapter;
+    using details::Memory_resource_allocator;
+}
+
+#endif // MEMOC_RESOURCES_H
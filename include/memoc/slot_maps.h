@@ -0,0 +1,241 @@
+#ifndef MEMOC_SLOT_MAPS_H
+#define MEMOC_SLOT_MAPS_H
+
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+#include <memoc/blocks.h>
+#include <memoc/allocators.h>
+#include <memoc/buffers.h>
+
+namespace memoc {
+    namespace details {
+        // Values stored densely and referenced by stable handles.
+        // Insert, erase and lookup are O(1), erase moves the last value into the erased position.
+        // A handle consists of a slot index and the slot generation, which is advanced on erase so stale handles are detected.
+        // Free slots are linked through their index field.
+        template <typename T, Allocator Internal_allocator = Malloc_allocator>
+            requires (!std::is_reference_v<T> && std::is_default_constructible_v<T>)
+        class Slot_map final {
+        public:
+            struct Handle {
+                std::int64_t index{ -1 };
+                std::int64_t generation{ 0 };
+
+                [[nodiscard]] friend constexpr bool operator==(const Handle& lhs, const Handle& rhs) noexcept
+                {
+                    return lhs.index == rhs.index && lhs.generation == rhs.generation;
+                }
+            };
+
+            constexpr Slot_map() = default;
+            // Copies the values element by element, throws if memory allocation failed.
+            constexpr Slot_map(const Slot_map& other)
+                : values_(other.capacity(), other.values_.data()),
+                dense_to_slot_(other.capacity(), other.dense_to_slot_.data()),
+                slots_(other.capacity(), other.slots_.data()),
+                size_(other.size_), slots_count_(other.slots_count_), free_head_(other.free_head_) {}
+            constexpr Slot_map& operator=(const Slot_map& other)
+            {
+                if (this == &other) {
+                    return *this;
+                }
+
+                Slot_map copy(other);
+                return *this = std::move(copy);
+            }
+            constexpr Slot_map(Slot_map&&) noexcept = default;
+            constexpr Slot_map& operator=(Slot_map&&) noexcept = default;
+            constexpr ~Slot_map() = default;
+
+            // Throws if memory allocation failed.
+            // The value may be an element of the map.
+            constexpr Handle insert(const T& value)
+            {
+                if (size_ == capacity()) {
+                    // Copying before growing invalidates the value
+                    T copy(value);
+                    return insert(std::move(copy));
+                }
+                T* dst = emplace_slot();
+                *dst = value;
+                return handle_at(size_ - 1);
+            }
+
+            constexpr Handle insert(T&& value)
+            {
+                if (size_ == capacity()) {
+                    T moved(std::move(value));
+                    T* dst = emplace_slot();
+                    *dst = std::move(moved);
+                    return handle_at(size_ - 1);
+                }
+                T* dst = emplace_slot();
+                *dst = std::move(value);
+                return handle_at(size_ - 1);
+            }
+
+            constexpr bool erase(const Handle& h) noexcept(std::is_nothrow_move_assignable_v<T> && std::is_nothrow_default_constructible_v<T>)
+            {
+                if (!contains(h)) {
+                    return false;
+                }
+
+                Slot* slots = slots_.data();
+                T* values = values_.data();
+                std::int64_t* dense_to_slot = dense_to_slot_.data();
+
+                const std::int64_t dense_index = slots[h.index].index;
+                const std::int64_t last = size_ - 1;
+                if (dense_index != last) {
+                    values[dense_index] = std::move(values[last]);
+                    dense_to_slot[dense_index] = dense_to_slot[last];
+                    slots[dense_to_slot[dense_index]].index = dense_index;
+                }
+                // Releases resources held by the vacated value
+                values[last] = T{};
+                --size_;
+
+                ++slots[h.index].generation;
+                slots[h.index].index = free_head_;
+                free_head_ = h.index;
+                return true;
+            }
+
+            [[nodiscard]] constexpr bool contains(const Handle& h) const noexcept
+            {
+                return h.index >= 0 && h.index < slots_count_ && slots_.data()[h.index].generation == h.generation;
+            }
+
+            [[nodiscard]] constexpr T* get(const Handle& h) const noexcept
+            {
+                return contains(h) ? values_.data() + slots_.data()[h.index].index : nullptr;
+            }
+
+            // The handle of the value at the dense position, valid for 0 <= dense_index < size().
+            [[nodiscard]] constexpr Handle handle_at(std::int64_t dense_index) const noexcept
+            {
+                const std::int64_t slot = dense_to_slot_.data()[dense_index];
+                return { slot, slots_.data()[slot].generation };
+            }
+
+            constexpr void clear() noexcept(std::is_nothrow_default_constructible_v<T> && std::is_nothrow_move_assignable_v<T>)
+            {
+                while (size_ > 0) {
+                    erase(handle_at(size_ - 1));
+                }
+            }
+
+            // The values as a contiguous block, invalidated by insertion and erasure.
+            [[nodiscard]] constexpr Block<T> block() const noexcept
+            {
+                return Block<T>(size_, values_.data());
+            }
+
+            [[nodiscard]] constexpr T* data() const noexcept
+            {
+                return values_.data();
+            }
+
+            [[nodiscard]] constexpr T* begin() const noexcept
+            {
+                return values_.data();
+            }
+
+            [[nodiscard]] constexpr T* end() const noexcept
+            {
+                return values_.data() + size_;
+            }
+
+            [[nodiscard]] constexpr std::int64_t size() const noexcept
+            {
+                return size_;
+            }
+
+            [[nodiscard]] constexpr bool empty() const noexcept
+            {
+                return size_ == 0;
+            }
+
+            [[nodiscard]] constexpr std::int64_t capacity() const noexcept
+            {
+                return values_.size();
+            }
+
+        private:
+            struct Slot {
+                // Dense index of a used slot, next free slot of a free one.
+                std::int64_t index{ -1 };
+                std::int64_t generation{ 0 };
+            };
+
+            static constexpr std::int64_t initial_capacity_ = 8;
+
+            constexpr T* emplace_slot()
+            {
+                if (size_ == capacity()) {
+                    grow();
+                }
+
+                std::int64_t slot = free_head_;
+                if (slot >= 0) {
+                    free_head_ = slots_.data()[slot].index;
+                }
+                else {
+                    slot = slots_count_++;
+                }
+
+                slots_.data()[slot].index = size_;
+                dense_to_slot_.data()[size_] = slot;
+                return values_.data() + size_++;
+            }
+
+            // Values that may throw on move are copied, so the map is unchanged if growing throws.
+            template <typename U>
+            static constexpr void transfer(Buffer<U, Internal_allocator>& buffer, Buffer<U, Internal_allocator>& grown, std::int64_t count)
+            {
+                for (std::int64_t i = 0; i < count; ++i) {
+                    grown.data()[i] = std::move_if_noexcept(buffer.data()[i]);
+                }
+            }
+
+            template <typename U>
+            static constexpr void replace(Buffer<U, Internal_allocator>& buffer, Buffer<U, Internal_allocator>& grown) noexcept
+            {
+                // Moving out first so the old values are destructed with their buffer
+                Buffer<U, Internal_allocator> old(std::move(buffer));
+                buffer = std::move(grown);
+            }
+
+            // All the buffers are allocated before any of them is replaced, so their capacities stay equal if an allocation throws.
+            constexpr void grow()
+            {
+                const std::int64_t new_capacity = capacity() > 0 ? capacity() * 2 : initial_capacity_;
+                Buffer<T, Internal_allocator> values(new_capacity);
+                Buffer<std::int64_t, Internal_allocator> dense_to_slot(new_capacity);
+                Buffer<Slot, Internal_allocator> slots(new_capacity);
+
+                transfer(values_, values, size_);
+                transfer(dense_to_slot_, dense_to_slot, size_);
+                transfer(slots_, slots, slots_count_);
+
+                replace(values_, values);
+                replace(dense_to_slot_, dense_to_slot);
+                replace(slots_, slots);
+            }
+
+            Buffer<T, Internal_allocator> values_{};
+            Buffer<std::int64_t, Internal_allocator> dense_to_slot_{};
+            Buffer<Slot, Internal_allocator> slots_{};
+
+            std::int64_t size_{ 0 };
+            std::int64_t slots_count_{ 0 };
+            std::int64_t free_head_{ -1 };
+        };
+    }
+
+    using details::Slot_map;
+}
+
+#endif // MEMOC_SLOT_MAPS_H
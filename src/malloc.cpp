@@ -0,0 +1,299 @@
+// A malloc replacement over memoc allocators, for linking into programs or preloading into unmodified ones.
+// Blocks of up to MEMOC_MALLOC_SMALL_SIZE bytes are cached per thread, and are otherwise kept in size class free lists
+// over monotonic chunks of mapped memory. Larger blocks are mapped from the operating system.
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+
+#include <pthread.h>
+
+#include <memoc/allocators.h>
+#include <memoc/malloc.h>
+
+#ifndef MEMOC_MALLOC_SMALL_SIZE
+#define MEMOC_MALLOC_SMALL_SIZE 32768
+#endif
+
+#ifndef MEMOC_MALLOC_THREAD_CACHE_SIZE
+#define MEMOC_MALLOC_THREAD_CACHE_SIZE 64
+#endif
+
+#ifndef MEMOC_MALLOC_CHUNK_SIZE
+#define MEMOC_MALLOC_CHUNK_SIZE (1024 * 1024)
+#endif
+
+namespace {
+    using namespace memoc;
+
+    constexpr Block<void>::Size_type min_size = 16;
+    constexpr Block<void>::Size_type small_size = MEMOC_MALLOC_SMALL_SIZE;
+
+    using Heap_allocator = Synchronized_allocator<
+        Bucketizer<Monotonic_allocator<Mmap_allocator, MEMOC_MALLOC_CHUNK_SIZE>, min_size, small_size, std::numeric_limits<std::int64_t>::max()>>;
+
+    // The heap of the small blocks, which is never destructed since blocks are deallocated after static destructors run.
+    class Heap final {
+    public:
+        static constexpr bool is_thread_safe = true;
+        static constexpr bool is_stateless = true;
+        static constexpr Block<void>::Size_type min_alignment = Allocator_traits<Heap_allocator>::min_alignment;
+
+        [[nodiscard]] oc::Expected<Block<void>, Allocator_error> allocate(Block<void>::Size_type s) noexcept
+        {
+            return instance().allocate(s);
+        }
+
+        void deallocate(Block<void>& b) noexcept
+        {
+            instance().deallocate(b);
+        }
+
+        [[nodiscard]] bool owns(const Block<void>& b) const noexcept
+        {
+            return instance().owns(b);
+        }
+
+        static void lock() noexcept
+        {
+            instance().lock();
+        }
+
+        static void unlock() noexcept
+        {
+            instance().unlock();
+        }
+
+    private:
+        static Heap_allocator& instance() noexcept
+        {
+            alignas(Heap_allocator) static std::uint8_t storage[sizeof(Heap_allocator)];
+            static Heap_allocator* heap = std::construct_at(reinterpret_cast<Heap_allocator*>(storage));
+            return *heap;
+        }
+    };
+
+    using Default_allocator = Segregator<small_size,
+        Thread_cache_allocator<Heap, min_size, small_size, MEMOC_MALLOC_THREAD_CACHE_SIZE>,
+        Mmap_allocator>;
+
+    constinit Malloc_interface<Default_allocator> heap{};
+
+    // The heap lock is held across fork(), so the child process does not inherit it held by a thread of the parent.
+    [[maybe_unused]] const int fork_handlers = pthread_atfork(&Heap::lock, &Heap::unlock, &Heap::unlock);
+
+    void* allocate_or_throw(std::size_t n, std::size_t alignment)
+    {
+        for (;;) {
+            void* p = alignment > Malloc_interface<Default_allocator>::default_alignment ? heap.aligned_alloc(alignment, n) : heap.malloc(n);
+            if (p) {
+                return p;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) {
+                throw std::bad_alloc{};
+            }
+            handler();
+        }
+    }
+
+    void* allocate_or_null(std::size_t n, std::size_t alignment) noexcept
+    {
+        try {
+            return allocate_or_throw(n, alignment);
+        }
+        catch (...) {
+            return nullptr;
+        }
+    }
+
+    void* with_errno(void* p) noexcept
+    {
+        if (!p) {
+            errno = ENOMEM;
+        }
+        return p;
+    }
+}
+
+extern "C" {
+    void* malloc(std::size_t n) noexcept
+    {
+        return with_errno(heap.malloc(n));
+    }
+
+    void* calloc(std::size_t count, std::size_t n) noexcept
+    {
+        return with_errno(heap.calloc(count, n));
+    }
+
+    void* realloc(void* p, std::size_t n) noexcept
+    {
+        if (p && n == 0) {
+            heap.free(p);
+            return nullptr;
+        }
+        return with_errno(heap.realloc(p, n));
+    }
+
+    void* reallocarray(void* p, std::size_t count, std::size_t n) noexcept
+    {
+        if (n != 0 && count > std::numeric_limits<std::size_t>::max() / n) {
+            errno = ENOMEM;
+            return nullptr;
+        }
+        return realloc(p, count * n);
+    }
+
+    void free(void* p) noexcept
+    {
+        heap.free(p);
+    }
+
+    int posix_memalign(void** p, std::size_t alignment, std::size_t n) noexcept
+    {
+        if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+            return EINVAL;
+        }
+        void* r = heap.aligned_alloc(alignment, n);
+        if (!r) {
+            return ENOMEM;
+        }
+        *p = r;
+        return 0;
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t n) noexcept
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        return with_errno(heap.aligned_alloc(alignment, n));
+    }
+
+    void* memalign(std::size_t alignment, std::size_t n) noexcept
+    {
+        return aligned_alloc(alignment, n);
+    }
+
+    void* valloc(std::size_t n) noexcept
+    {
+        return aligned_alloc(static_cast<std::size_t>(details::page_size), n);
+    }
+
+    void* pvalloc(std::size_t n) noexcept
+    {
+        const std::size_t ps = static_cast<std::size_t>(details::page_size);
+        return aligned_alloc(ps, (n + ps - 1) & ~(ps - 1));
+    }
+
+    std::size_t malloc_usable_size(void* p) noexcept
+    {
+        return heap.usable_size(p);
+    }
+}
+
+void* operator new(std::size_t n)
+{
+    return allocate_or_throw(n, Malloc_interface<Default_allocator>::default_alignment);
+}
+
+void* operator new[](std::size_t n)
+{
+    return allocate_or_throw(n, Malloc_interface<Default_allocator>::default_alignment);
+}
+
+void* operator new(std::size_t n, std::align_val_t alignment)
+{
+    return allocate_or_throw(n, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t n, std::align_val_t alignment)
+{
+    return allocate_or_throw(n, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(n, Malloc_interface<Default_allocator>::default_alignment);
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(n, Malloc_interface<Default_allocator>::default_alignment);
+}
+
+void* operator new(std::size_t n, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(n, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t n, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(n, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    heap.free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    heap.free(p);
+}
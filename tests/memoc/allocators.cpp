@@ -4,12 +4,18 @@
 #include <memory>
 #include <array>
 #include <vector>
+#include <list>
+#include <map>
+#include <thread>
 #include <chrono>
 #include <utility>
 #include <limits>
+#include <atomic>
 
 #include <memoc/allocators.h>
 #include <memoc/blocks.h>
+#include <memoc/buffers.h>
+#include <memoc/pointers.h>
 
 // Malloc_allocator tests
 
@@ -54,6 +60,40 @@ TEST_F(Malloc_allocator_test, failed_to_allocate_if_invalid_size)
     //EXPECT_EQ(Allocator_error::unknown, allocator_.allocate(std::numeric_limits<Block<void>::Size_type>::max()).error());
 }
 
+TEST_F(Malloc_allocator_test, has_nothing_to_warm_up)
+{
+    using namespace memoc;
+
+    EXPECT_EQ(0, warm_up(allocator_, 1024));
+}
+
+// Mmap_allocator tests
+
+TEST(Mmap_allocator_test, allocates_zeroed_whole_pages)
+{
+    using namespace memoc;
+
+    Mmap_allocator allocator{};
+
+    Block<void> b = allocator.allocate(100).value();
+    EXPECT_EQ(100, b.size());
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(b.data()) % details::page_size);
+    EXPECT_TRUE(allocator.owns(b));
+    EXPECT_FALSE(allocator.owns(Block<void>{ 100, b.data() }));
+    EXPECT_EQ(details::page_size, allocator.good_size(100));
+
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(b.data());
+    for (Block<void>::Size_type i = 0; i < allocator.good_size(b.size()); ++i) {
+        EXPECT_EQ(0, p[i]);
+    }
+
+    allocator.deallocate(b);
+    EXPECT_TRUE(b.empty());
+
+    EXPECT_TRUE(allocator.allocate(0).value().empty());
+    EXPECT_EQ(Allocator_error::invalid_size, allocator.allocate(-1).error());
+}
+
 // Stack_allocator tests
 
 class Stack_allocator_test : public ::testing::Test {
@@ -193,6 +233,554 @@ TEST_F(Stack_allocator_test, DISABLED_is_movealbe)
     EXPECT_NE(nullptr, b4.data());
 }
 
+TEST_F(Stack_allocator_test, warms_up_free_stack_memory)
+{
+    using namespace memoc;
+
+    EXPECT_EQ(size_ / 2, allocator_.warm_up(size_ / 2));
+    EXPECT_EQ(size_, warm_up(allocator_, size_ * 2));
+
+    Block<void> b = allocator_.allocate(size_).value();
+    EXPECT_EQ(0, allocator_.warm_up(size_));
+    allocator_.deallocate(b);
+}
+
+TEST_F(Stack_allocator_test, rollback_releases_allocations_made_after_checkpoint_in_any_order)
+{
+    using namespace memoc;
+
+    const Block<void>::Size_type size_in_range{ size_ / 4 };
+
+    Block<void> b0 = allocator_.allocate(size_in_range).value();
+    auto marker = allocator_.checkpoint();
+
+    Block<void> b1 = allocator_.allocate(size_in_range).value();
+    Block<void> b2 = allocator_.allocate(size_in_range).value();
+    Block<void> b1_copy{ b1 };
+
+    // Out of order deallocation does not reclaim memory
+    allocator_.deallocate(b1);
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(size_in_range * 2).error());
+
+    allocator_.rollback(marker);
+
+    Block<void> b3 = allocator_.allocate(size_in_range).value();
+    EXPECT_EQ(b1_copy.data(), b3.data());
+
+    // Rolling back to a later checkpoint does not change the stack
+    allocator_.deallocate(b3);
+    allocator_.deallocate(b0);
+    allocator_.rollback(marker);
+    Block<void> b4 = allocator_.allocate(size_).value();
+    EXPECT_EQ(size_, b4.size());
+    allocator_.deallocate(b4);
+}
+
+TEST_F(Stack_allocator_test, stack_scope_releases_nested_allocations)
+{
+    using namespace memoc;
+
+    const Block<void>::Size_type size_in_range{ size_ / 4 };
+
+    Block<void> b0 = allocator_.allocate(size_in_range).value();
+    {
+        Stack_scope<Allocator> outer{ allocator_ };
+        Block<void> b1 = allocator_.allocate(size_in_range).value();
+        {
+            Stack_scope<Allocator> inner{ allocator_ };
+            Block<void> b2 = allocator_.allocate(size_in_range).value();
+            Block<void> b3 = allocator_.allocate(size_in_range).value();
+            EXPECT_FALSE(b2.empty());
+            EXPECT_FALSE(b3.empty());
+            EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(1).error());
+        }
+        Block<void> b4 = allocator_.allocate(size_in_range * 2).value();
+        EXPECT_EQ(static_cast<std::uint8_t*>(b1.data()) + size_in_range, b4.data());
+        allocator_.deallocate(b1);
+    }
+    Block<void> b5 = allocator_.allocate(size_in_range * 3).value();
+    EXPECT_EQ(static_cast<std::uint8_t*>(b0.data()) + size_in_range, b5.data());
+
+    allocator_.deallocate(b5);
+    allocator_.deallocate(b0);
+}
+
+namespace {
+    constexpr bool stack_allocates_in_constant_evaluation()
+    {
+        memoc::Stack_allocator<memoc::details::Local_stack_memory<16>> allocator{};
+
+        memoc::Block<void> b1 = allocator.allocate(8).value();
+        memoc::Block<void> b2 = allocator.allocate(8).value();
+        const bool full = !allocator.allocate(1);
+        const bool owned = allocator.owns(b1) && allocator.owns(b2) && !allocator.owns(memoc::Block<void>{});
+
+        allocator.deallocate(b2);
+        allocator.deallocate(b1);
+        memoc::Block<void> b3 = allocator.allocate(16).value();
+        const bool reused = !b3.empty();
+        allocator.deallocate(b3);
+
+        return full && owned && reused && b1.empty() && b2.empty();
+    }
+}
+
+TEST_F(Stack_allocator_test, is_usable_in_constant_evaluation)
+{
+    static_assert(stack_allocates_in_constant_evaluation());
+}
+
+TEST_F(Stack_allocator_test, allocates_from_a_static_arena_sized_by_types)
+{
+    using namespace memoc;
+
+    struct Header {
+        std::int64_t id;
+        std::int32_t flags;
+    };
+    using Arena = Static_arena_for<Header, std::int64_t[4], char>;
+    static_assert(Arena::capacity == 16 + 32 + 2);
+
+    Stack_allocator<Arena> allocator{};
+    Block<void> b1 = allocator.allocate(MEMOC_SSIZEOF(Header)).value();
+    Block<void> b2 = allocator.allocate(MEMOC_SSIZEOF(std::int64_t[4])).value();
+    Block<void> b3 = allocator.allocate(1).value();
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(b1.data()) % alignof(std::max_align_t));
+    EXPECT_TRUE(allocator.owns(b3));
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(1).error());
+
+    // Arenas of the same type share their memory
+    Stack_allocator<Arena> other{};
+    EXPECT_TRUE(other.owns(b2));
+
+    void* first = b1.data();
+    allocator.deallocate(b3);
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    Block<void> b4 = other.allocate(Arena::capacity).value();
+    EXPECT_EQ(first, b4.data());
+    other.deallocate(b4);
+}
+
+// Runtime_stack_memory tests
+
+TEST(Runtime_stack_memory_test, allocates_stacks_of_the_configured_sizes)
+{
+    using namespace memoc;
+
+    Stack_allocator<Runtime_stack_memory> allocator{ Runtime_stack_memory{ { 2, 32 } } };
+
+    Block<void> b1 = allocator.allocate(32).value();
+    Block<void> b2 = allocator.allocate(16).value();
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(b1.data()) % alignof(std::max_align_t));
+    EXPECT_EQ(static_cast<std::uint8_t*>(b1.data()) + 32, b2.data());
+    EXPECT_TRUE(allocator.owns(b1));
+    EXPECT_TRUE(allocator.owns(b2));
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(32).error());
+
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    EXPECT_EQ(64, warm_up(allocator, 128));
+
+    Stack_allocator<Runtime_stack_memory> copy{ allocator };
+    Block<void> b3 = copy.allocate(32).value();
+    EXPECT_FALSE(allocator.owns(b3));
+    copy.deallocate(b3);
+
+    EXPECT_EQ(Allocator_error::out_of_memory, Stack_allocator<Runtime_stack_memory>{}.allocate(2).error());
+    EXPECT_EQ(0, Runtime_stack_memory({ 1, 3 }).parameters().buffer_size);
+}
+
+// Double_ended_stack_allocator tests
+
+class Double_ended_stack_allocator_test : public ::testing::Test {
+protected:
+    static constexpr memoc::Block<void>::Size_type size_ = 64;
+    using Parent = memoc::Malloc_allocator;
+
+    using Allocator = memoc::Double_ended_stack_allocator<Parent>;
+    Allocator allocator_{ size_ };
+};
+
+TEST_F(Double_ended_stack_allocator_test, allocates_from_both_ends_until_they_collide)
+{
+    using namespace memoc;
+
+    EXPECT_EQ(size_, allocator_.size());
+    EXPECT_FALSE(allocator_.owns(Block<void>{}));
+    EXPECT_EQ(Allocator_error::invalid_size, allocator_.allocate(-1, Stack_end::top).error());
+
+    Block<void> retained = allocator_.allocate(16, Stack_end::bottom).value();
+    Block<void> scratch = allocator_.allocate(16, Stack_end::top).value();
+    EXPECT_TRUE(allocator_.owns(retained));
+    EXPECT_TRUE(allocator_.owns(scratch));
+    EXPECT_TRUE(allocator_.owns(retained, Stack_end::bottom));
+    EXPECT_FALSE(allocator_.owns(retained, Stack_end::top));
+    EXPECT_TRUE(allocator_.owns(scratch, Stack_end::top));
+    EXPECT_EQ(static_cast<std::uint8_t*>(retained.data()) + size_ - 16, scratch.data());
+
+    EXPECT_EQ(16, allocator_.used(Stack_end::bottom));
+    EXPECT_EQ(16, allocator_.used(Stack_end::top));
+    EXPECT_EQ(size_ - 32, allocator_.available());
+
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(size_ - 16, Stack_end::top).error());
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(size_ - 16).error());
+
+    allocator_.deallocate(scratch);
+    EXPECT_TRUE(scratch.empty());
+    EXPECT_EQ(0, allocator_.used(Stack_end::top));
+    allocator_.deallocate(retained);
+    EXPECT_EQ(0, allocator_.used(Stack_end::bottom));
+}
+
+TEST_F(Double_ended_stack_allocator_test, resets_each_end_independently)
+{
+    using namespace memoc;
+
+    Block<void> retained = allocator_.allocate(16).value();
+    Block<void> scratch1 = allocator_.allocate(16, Stack_end::top).value();
+    Block<void> scratch2 = allocator_.allocate(16, Stack_end::top).value();
+    EXPECT_FALSE(scratch1.empty());
+    EXPECT_FALSE(scratch2.empty());
+
+    allocator_.reset(Stack_end::top);
+    EXPECT_EQ(16, allocator_.used(Stack_end::bottom));
+    EXPECT_EQ(0, allocator_.used(Stack_end::top));
+    EXPECT_TRUE(allocator_.owns(retained, Stack_end::bottom));
+
+    allocator_.reset(Stack_end::bottom);
+    EXPECT_EQ(size_, allocator_.available());
+}
+
+TEST_F(Double_ended_stack_allocator_test, end_allocators_allocate_from_their_own_end)
+{
+    using namespace memoc;
+
+    Allocator::Bottom_allocator bottom = allocator_.bottom();
+    Allocator::Top_allocator top = allocator_.top();
+
+    Block<void> b1 = bottom.allocate(16).value();
+    Block<void> b2 = top.allocate(16).value();
+    EXPECT_TRUE(bottom.owns(b1));
+    EXPECT_FALSE(bottom.owns(b2));
+    EXPECT_TRUE(top.owns(b2));
+    EXPECT_FALSE(top.owns(b1));
+
+    top.deallocate(b2);
+    bottom.deallocate(b1);
+    EXPECT_EQ(size_, allocator_.available());
+
+    Allocator::Top_allocator detached{};
+    EXPECT_EQ(Allocator_error::out_of_memory, detached.allocate(16).error());
+}
+
+TEST_F(Double_ended_stack_allocator_test, rollback_releases_both_ends)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(16).value();
+    {
+        Stack_scope<Allocator> scope{ allocator_ };
+        Block<void> b2 = allocator_.allocate(16).value();
+        Block<void> b3 = allocator_.allocate(16, Stack_end::top).value();
+        EXPECT_FALSE(b2.empty());
+        EXPECT_FALSE(b3.empty());
+        EXPECT_EQ(size_ - 48, allocator_.available());
+    }
+    EXPECT_EQ(16, allocator_.used(Stack_end::bottom));
+    EXPECT_EQ(0, allocator_.used(Stack_end::top));
+    allocator_.deallocate(b1);
+}
+
+// Frame_allocator tests
+
+class Frame_allocator_test : public ::testing::Test {
+protected:
+    static constexpr memoc::Block<void>::Size_type frame_size_ = 64;
+    static constexpr memoc::Block<void>::Size_type alignment_ = static_cast<memoc::Block<void>::Size_type>(alignof(std::max_align_t));
+    using Parent = memoc::Malloc_allocator;
+
+    using Allocator = memoc::Frame_allocator<Parent, 2>;
+    Allocator allocator_{ frame_size_ };
+};
+
+TEST_F(Frame_allocator_test, not_owns_an_empty_block)
+{
+    using namespace memoc;
+
+    EXPECT_FALSE(allocator_.owns(Block<void>{}));
+}
+
+TEST_F(Frame_allocator_test, allocates_from_the_current_frame_until_it_is_full)
+{
+    using namespace memoc;
+
+    EXPECT_EQ(frame_size_, allocator_.frame_size());
+    EXPECT_EQ(Allocator_error::invalid_size, allocator_.allocate(-1).error());
+    EXPECT_TRUE(allocator_.allocate(0).value().empty());
+
+    Block<void> b1 = allocator_.allocate(1).value();
+    EXPECT_NE(nullptr, b1.data());
+    EXPECT_EQ(1, b1.size());
+    EXPECT_TRUE(allocator_.owns(b1));
+
+    Block<void> b2 = allocator_.allocate(frame_size_ - alignment_).value();
+    EXPECT_EQ(static_cast<std::uint8_t*>(b1.data()) + alignment_, b2.data());
+    EXPECT_EQ(frame_size_, allocator_.used());
+
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(1).error());
+
+    // Only the last allocation is reclaimed on deallocation
+    allocator_.deallocate(b1);
+    EXPECT_TRUE(b1.empty());
+    EXPECT_EQ(frame_size_, allocator_.used());
+    allocator_.deallocate(b2);
+    EXPECT_EQ(alignment_, allocator_.used());
+}
+
+TEST_F(Frame_allocator_test, keeps_previous_frame_memory_for_one_extra_frame)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(16).value();
+    set(b1, std::uint8_t{ 1 });
+
+    allocator_.advance_frame();
+    EXPECT_EQ(1, allocator_.frame_number());
+    EXPECT_EQ(0, allocator_.used());
+
+    Block<void> b2 = allocator_.allocate(16).value();
+    set(b2, std::uint8_t{ 2 });
+    EXPECT_NE(b1.data(), b2.data());
+    EXPECT_EQ(1, *static_cast<std::uint8_t*>(b1.data()));
+
+    // The oldest frame is reset and its memory is reused
+    allocator_.advance_frame();
+    Block<void> b3 = allocator_.allocate(16).value();
+    EXPECT_EQ(b1.data(), b3.data());
+    EXPECT_EQ(2, *static_cast<std::uint8_t*>(b2.data()));
+}
+
+TEST_F(Frame_allocator_test, reports_high_water_marks_per_frame)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(32).value();
+    Block<void> b2 = allocator_.allocate(16).value();
+    allocator_.deallocate(b2);
+    EXPECT_EQ(32, allocator_.used());
+    EXPECT_EQ(48, allocator_.frame_high_water_mark());
+
+    allocator_.advance_frame();
+    Block<void> b3 = allocator_.allocate(16).value();
+    EXPECT_EQ(16, allocator_.frame_high_water_mark());
+    EXPECT_EQ(48, allocator_.frame_high_water_mark(1));
+    EXPECT_EQ(0, allocator_.frame_high_water_mark(2));
+
+    allocator_.advance_frame();
+    EXPECT_EQ(0, allocator_.frame_high_water_mark());
+    EXPECT_EQ(16, allocator_.frame_high_water_mark(1));
+    EXPECT_EQ(48, allocator_.high_water_mark());
+}
+
+TEST_F(Frame_allocator_test, reset_restarts_the_frames_numbering_and_high_water_marks)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(48).value();
+    allocator_.advance_frame();
+    EXPECT_TRUE(allocator_.allocate(16));
+    EXPECT_EQ(1, allocator_.frame_number());
+
+    allocator_.reset();
+    EXPECT_EQ(0, allocator_.frame_number());
+    EXPECT_EQ(0, allocator_.used());
+    EXPECT_EQ(0, allocator_.high_water_mark());
+    EXPECT_EQ(0, allocator_.frame_high_water_mark());
+    EXPECT_EQ(0, allocator_.frame_high_water_mark(1));
+
+    b1 = allocator_.allocate(16).value();
+    EXPECT_EQ(16, allocator_.high_water_mark());
+}
+
+TEST_F(Frame_allocator_test, rejects_frame_sizes_whose_frames_size_overflows)
+{
+    using namespace memoc;
+
+    Allocator too_large{ std::numeric_limits<Block<void>::Size_type>::max() / 2 + 1 };
+    EXPECT_EQ(0, too_large.frame_size());
+    EXPECT_EQ(Allocator_error::out_of_memory, too_large.allocate(1).error());
+
+    Allocator unaligned{ Allocator::max_frame_size + 1 };
+    EXPECT_EQ(0, unaligned.frame_size());
+}
+
+TEST_F(Frame_allocator_test, is_copyable_and_moveable)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(16).value();
+
+    Allocator copy{ allocator_ };
+    EXPECT_EQ(frame_size_, copy.frame_size());
+    EXPECT_EQ(0, copy.used());
+    EXPECT_FALSE(copy.owns(b1));
+
+    Allocator moved{ std::move(allocator_) };
+    EXPECT_TRUE(moved.owns(b1));
+    EXPECT_EQ(16, moved.used());
+    EXPECT_FALSE(allocator_.owns(b1));
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(16).error());
+
+    copy = moved;
+    EXPECT_FALSE(copy.owns(b1));
+
+    copy = std::move(moved);
+    EXPECT_TRUE(copy.owns(b1));
+    EXPECT_EQ(frame_size_ * 2, copy.warm_up(frame_size_ * 4));
+}
+
+// Ring_allocator tests
+
+class Ring_allocator_test : public ::testing::Test {
+protected:
+    static constexpr memoc::Block<void>::Size_type granule_ = static_cast<memoc::Block<void>::Size_type>(alignof(std::max_align_t));
+    // Room for 4 blocks of a single granule, each with its header
+    static constexpr memoc::Block<void>::Size_type capacity_ = granule_ * 8;
+    using Parent = memoc::Malloc_allocator;
+
+    using Allocator = memoc::Ring_allocator<Parent>;
+    Allocator allocator_{ capacity_ };
+};
+
+TEST_F(Ring_allocator_test, allocates_until_full_and_reuses_memory_in_fifo_order)
+{
+    using namespace memoc;
+
+    EXPECT_EQ(capacity_, allocator_.capacity());
+    EXPECT_FALSE(allocator_.owns(Block<void>{}));
+    EXPECT_EQ(Allocator_error::invalid_size, allocator_.allocate(-1).error());
+    EXPECT_TRUE(allocator_.allocate(0).value().empty());
+
+    std::array<Block<void>, 4> blocks{};
+    for (auto& b : blocks) {
+        b = allocator_.allocate(granule_).value();
+        EXPECT_EQ(granule_, b.size());
+        EXPECT_TRUE(allocator_.owns(b));
+    }
+    EXPECT_EQ(capacity_, allocator_.used());
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(1).error());
+
+    void* first = blocks[0].data();
+    allocator_.deallocate(blocks[0]);
+    EXPECT_TRUE(blocks[0].empty());
+    EXPECT_EQ(capacity_ - granule_ * 2, allocator_.used());
+
+    blocks[0] = allocator_.allocate(granule_).value();
+    EXPECT_EQ(first, blocks[0].data());
+
+    for (std::size_t i = 1; i < blocks.size(); ++i) {
+        allocator_.deallocate(blocks[i]);
+    }
+    allocator_.deallocate(blocks[0]);
+    EXPECT_EQ(0, allocator_.used());
+}
+
+TEST_F(Ring_allocator_test, reclaims_out_of_order_deallocations_when_the_tail_reaches_them)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(granule_).value();
+    Block<void> b2 = allocator_.allocate(granule_).value();
+    Block<void> b3 = allocator_.allocate(granule_).value();
+
+    allocator_.deallocate(b2);
+    allocator_.deallocate(b3);
+    EXPECT_EQ(granule_ * 6, allocator_.used());
+
+    allocator_.deallocate(b1);
+    EXPECT_EQ(0, allocator_.used());
+}
+
+TEST_F(Ring_allocator_test, wraps_around_without_splitting_blocks)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(granule_).value();
+    Block<void> b2 = allocator_.allocate(granule_ * 3).value();
+    Block<void> b1_copy{ b1 };
+    allocator_.deallocate(b1);
+
+    // Only two granules left at the end of the region, the block is allocated from its beginning
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(granule_ * 2).error());
+    Block<void> b3 = allocator_.allocate(granule_).value();
+    EXPECT_EQ(static_cast<std::uint8_t*>(b2.data()) + granule_ * 4, b3.data());
+
+    Block<void> b4 = allocator_.allocate(granule_).value();
+    EXPECT_EQ(b1_copy.data(), b4.data());
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(granule_).error());
+
+    allocator_.deallocate(b2);
+    allocator_.deallocate(b3);
+    Block<void> b5 = allocator_.allocate(granule_ * 3).value();
+    EXPECT_EQ(static_cast<std::uint8_t*>(b4.data()) + granule_ * 2, b5.data());
+
+    allocator_.deallocate(b4);
+    allocator_.deallocate(b5);
+    EXPECT_EQ(0, allocator_.used());
+}
+
+TEST_F(Ring_allocator_test, is_copyable_and_moveable)
+{
+    using namespace memoc;
+
+    Block<void> b = allocator_.allocate(granule_).value();
+
+    Allocator copy{ allocator_ };
+    EXPECT_EQ(capacity_, copy.capacity());
+    EXPECT_EQ(0, copy.used());
+    EXPECT_FALSE(copy.owns(b));
+
+    Allocator moved{ std::move(allocator_) };
+    EXPECT_TRUE(moved.owns(b));
+    EXPECT_EQ(0, allocator_.capacity());
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator_.allocate(1).error());
+
+    moved.deallocate(b);
+    EXPECT_EQ(0, moved.used());
+}
+
+// Monotonic_allocator tests
+
+TEST(Monotonic_allocator_test, allocates_from_chunks_and_releases_them_together)
+{
+    using namespace memoc;
+
+    using Allocator = Monotonic_allocator<Stack_allocator<details::Local_stack_memory<512>>, 128>;
+    Allocator allocator{};
+
+    Block<void> b1 = allocator.allocate(10).value();
+    Block<void> b2 = allocator.allocate(20).value();
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(b1.data()) % alignof(std::max_align_t));
+    EXPECT_EQ(static_cast<std::uint8_t*>(b1.data()) + 16, b2.data());
+    EXPECT_TRUE(allocator.owns(b1));
+
+    // Deallocation does not release memory
+    allocator.deallocate(b2);
+    EXPECT_TRUE(b2.empty());
+    Block<void> b3 = allocator.allocate(20).value();
+    EXPECT_EQ(static_cast<std::uint8_t*>(b1.data()) + 48, b3.data());
+
+    // A block larger than a chunk gets a chunk of its own
+    Block<void> b4 = allocator.allocate(200).value();
+    EXPECT_EQ(200, b4.size());
+
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(512).error());
+
+    Allocator moved{ std::move(allocator) };
+    EXPECT_TRUE(moved.owns(b4));
+}
+
 // Free_list_allocator tests
 
 class Free_list_allocator_test : public ::testing::Test {
@@ -396,14 +984,168 @@ TEST_F(Free_list_allocator_test, is_movealbe)
     EXPECT_TRUE(b6.empty());
 }
 
-// Stl_adapter_allocator tests
+TEST_F(Free_list_allocator_test, warm_up_prefills_the_list_up_to_its_maximum_size)
+{
+    using namespace memoc;
 
-class Stl_adapter_allocator_test : public ::testing::Test {
-protected:
-    using Parent = memoc::Malloc_allocator;
+    const Block<void>::Size_type size_in_range{ min_size_ + (max_size_ - min_size_) / 2 };
 
-    template <typename T>
-    using Allocator = memoc::Stl_adapter_allocator<T, Parent>;
+    EXPECT_EQ(max_list_size_, warm_up(allocator_, max_list_size_ + 1));
+    EXPECT_EQ(0, allocator_.warm_up(1));
+
+    std::array<Block<void>, max_list_size_> blocks{};
+    for (auto& b : blocks) {
+        b = allocator_.allocate(size_in_range).value();
+        EXPECT_NE(nullptr, b.data());
+        EXPECT_EQ(size_in_range, b.size());
+    }
+
+    EXPECT_EQ(max_list_size_, allocator_.warm_up(max_list_size_));
+
+    for (auto& b : blocks) {
+        allocator_.deallocate(b);
+        EXPECT_TRUE(b.empty());
+    }
+}
+
+// Runtime_free_list_allocator tests
+
+TEST(Runtime_free_list_allocator_test, lists_blocks_in_the_configured_size_range)
+{
+    using namespace memoc;
+
+    Runtime_free_list_allocator<Malloc_allocator> allocator{ { 16, 32, 2 } };
+    EXPECT_EQ(32, allocator.parameters().max_size);
+    EXPECT_EQ(32, allocator.good_size(20));
+    EXPECT_EQ(8, allocator.good_size(8));
+
+    Block<void> b1 = allocator.allocate(20).value();
+    void* p1 = b1.data();
+    allocator.deallocate(b1);
+    EXPECT_TRUE(b1.empty());
+
+    Block<void> b2 = allocator.allocate(16).value();
+    EXPECT_EQ(p1, b2.data());
+    EXPECT_EQ(16, b2.size());
+    EXPECT_TRUE(allocator.owns(b2));
+    allocator.deallocate(b2);
+
+    Block<void> b3 = allocator.allocate(64).value();
+    EXPECT_NE(p1, b3.data());
+    allocator.deallocate(b3);
+
+    EXPECT_EQ(1, warm_up(allocator, 4));
+
+    Runtime_free_list_allocator<Malloc_allocator> copy{ allocator };
+    EXPECT_EQ(16, copy.parameters().min_size);
+
+    // Invalid parameters disable the list
+    Runtime_free_list_allocator<Malloc_allocator> invalid{ { 15, 32, 2 } };
+    EXPECT_EQ(10, invalid.good_size(10));
+    EXPECT_EQ(0, warm_up(invalid, 1));
+}
+
+// Bucketizer tests
+
+TEST(Bucketizer_test, serves_blocks_by_their_size_classes)
+{
+    using namespace memoc;
+
+    Bucketizer<Malloc_allocator, 16, 64, 4> allocator{};
+
+    EXPECT_EQ(16, allocator.good_size(1));
+    EXPECT_EQ(32, allocator.good_size(17));
+    EXPECT_EQ(64, allocator.good_size(64));
+    EXPECT_EQ(65, allocator.good_size(65));
+
+    Block<void> b1 = allocator.allocate(20).value();
+    EXPECT_EQ(20, b1.size());
+    EXPECT_TRUE(allocator.owns(b1));
+    void* p1 = b1.data();
+    allocator.deallocate(b1);
+    EXPECT_TRUE(b1.empty());
+
+    // Blocks of the same class are reused, other classes are not
+    Block<void> b2 = allocator.allocate(10).value();
+    EXPECT_NE(p1, b2.data());
+    Block<void> b3 = allocator.allocate(32).value();
+    EXPECT_EQ(p1, b3.data());
+
+    Block<void> b4 = allocator.allocate(100).value();
+    EXPECT_EQ(100, b4.size());
+
+    allocator.deallocate(b4);
+    allocator.deallocate(b3);
+    allocator.deallocate(b2);
+}
+
+// Adaptive_free_list_allocator tests
+
+TEST(Adaptive_free_list_allocator_test, adapts_its_cached_classes_to_the_allocated_sizes)
+{
+    using namespace memoc;
+
+    Adaptive_free_list_allocator<Malloc_allocator, 16, 256, 8, 8> allocator{};
+
+    EXPECT_EQ(5, allocator.classes_count);
+    EXPECT_EQ(32, allocator.good_size(20));
+    EXPECT_EQ(300, allocator.good_size(300));
+    EXPECT_EQ(16, allocator.configuration().min_size);
+    EXPECT_EQ(256, allocator.configuration().max_size);
+
+    Block<void> large = allocator.allocate(300).value();
+    EXPECT_EQ(300, large.size());
+    allocator.deallocate(large);
+
+    // Only the class of the allocated size is cached after the first adaptation
+    Block<void> blocks[8]{};
+    for (Block<void>& b : blocks) {
+        b = allocator.allocate(100).value();
+        EXPECT_EQ(100, b.size());
+        EXPECT_TRUE(allocator.owns(b));
+    }
+    void* p = blocks[1].data();
+    for (Block<void>& b : blocks) {
+        allocator.deallocate(b);
+        EXPECT_TRUE(b.empty());
+    }
+
+    auto conf = allocator.configuration();
+    EXPECT_EQ(1, conf.adaptations);
+    EXPECT_EQ(128, conf.min_size);
+    EXPECT_EQ(128, conf.max_size);
+    EXPECT_EQ(8, conf.classes[3].limit);
+    EXPECT_EQ(8, conf.classes[3].cached);
+    EXPECT_EQ(0, conf.classes[1].limit);
+
+    // Shifting to smaller sizes caches their class and releases the most recently cached blocks beyond the new limits
+    for (std::int64_t i = 0; i < 8; ++i) {
+        Block<void> b = allocator.allocate(20).value();
+        allocator.deallocate(b);
+    }
+
+    conf = allocator.configuration();
+    EXPECT_EQ(2, conf.adaptations);
+    EXPECT_EQ(32, conf.min_size);
+    EXPECT_EQ(128, conf.max_size);
+    EXPECT_EQ(5, conf.classes[1].limit);
+    EXPECT_EQ(1, conf.classes[1].cached);
+    EXPECT_EQ(2, conf.classes[3].limit);
+    EXPECT_EQ(2, conf.classes[3].cached);
+
+    Block<void> b = allocator.allocate(128).value();
+    EXPECT_EQ(p, b.data());
+    allocator.deallocate(b);
+}
+
+// Stl_adapter_allocator tests
+
+class Stl_adapter_allocator_test : public ::testing::Test {
+protected:
+    using Parent = memoc::Malloc_allocator;
+
+    template <typename T>
+    using Allocator = memoc::Stl_adapter_allocator<T, Parent>;
 };
 
 TEST_F(Stl_adapter_allocator_test, able_to_use_custom_allocator)
@@ -440,6 +1182,68 @@ TEST_F(Stl_adapter_allocator_test, able_to_use_custom_allocator)
     EXPECT_TRUE(v3.empty());
 }
 
+TEST_F(Stl_adapter_allocator_test, copies_and_rebinds_share_the_backend)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Local_stack_memory<1024>>;
+
+    Stl_adapter_allocator<int, Stack> a1{};
+    Stl_adapter_allocator<double, Stack> a2{ a1 };
+    Stl_adapter_allocator<int, Stack> a3{ a2 };
+    EXPECT_TRUE(a1 == a2);
+    EXPECT_TRUE(a1 == a3);
+    EXPECT_EQ(&a1.allocator(), &a2.allocator());
+    EXPECT_FALSE(a1 == (Stl_adapter_allocator<int, Stack>{}));
+
+    std::list<int, Stl_adapter_allocator<int, Stack>> l1{ a1 };
+    l1.push_back(1);
+    l1.push_back(2);
+    EXPECT_TRUE(a1.allocator().owns(Block<void>{ MEMOC_SSIZEOF(int), &l1.back() }));
+
+    std::list<int, Stl_adapter_allocator<int, Stack>> l2{ l1 };
+    EXPECT_TRUE(a1.allocator().owns(Block<void>{ MEMOC_SSIZEOF(int), &l2.back() }));
+
+    std::map<int, int, std::less<int>, Stl_adapter_allocator<std::pair<const int, int>, Stack>> m{ a2 };
+    m[1] = 2;
+    EXPECT_TRUE(a1.allocator().owns(Block<void>{ MEMOC_SSIZEOF(int), &m.at(1) }));
+
+    static_assert(Stl_adapter_allocator<int, Malloc_allocator>::is_always_equal::value);
+    static_assert(!Stl_adapter_allocator<int, Stack>::is_always_equal::value);
+    EXPECT_TRUE((Stl_adapter_allocator<int, Malloc_allocator>{} == Stl_adapter_allocator<double, Malloc_allocator>{}));
+}
+
+TEST_F(Stl_adapter_allocator_test, allocates_at_least_the_usable_size_of_blocks)
+{
+    using namespace memoc;
+
+    Stl_adapter_allocator<std::int32_t, Free_list_allocator<Malloc_allocator, 16, 64, 4>> a{};
+
+    auto r1 = a.allocate_at_least(3);
+    EXPECT_EQ(3, r1.count);
+    auto r2 = a.allocate_at_least(5);
+    EXPECT_EQ(16, r2.count);
+    for (std::size_t i = 0; i < r2.count; ++i) {
+        r2.ptr[i] = static_cast<std::int32_t>(i);
+    }
+
+    a.deallocate(r2.ptr, r2.count);
+    a.deallocate(r1.ptr, r1.count);
+
+    // The listed block is reused
+    std::int32_t* p = a.allocate(10);
+    EXPECT_EQ(r2.ptr, p);
+    a.deallocate(p, 10);
+
+    Stl_adapter_allocator<std::int32_t, Stack_allocator<details::Local_stack_memory<64>>> s{};
+    auto r3 = s.allocate_at_least(3);
+    EXPECT_EQ(3, r3.count);
+    s.deallocate(r3.ptr, r3.count);
+
+    static_assert(Allocator_traits<Free_list_allocator<Malloc_allocator, 16, 64, 4>>::can_report_good_size);
+    static_assert(!Allocator_traits<Malloc_allocator>::can_report_good_size);
+}
+
 // Stats_allocator tests
 
 class Stats_allocator_test : public ::testing::Test {
@@ -568,6 +1372,274 @@ TEST_F(Stats_allocator_test, is_moveable)
     EXPECT_NE(nullptr, moved2.stats_list());
 }
 
+// Site_stats_allocator tests
+
+TEST(Site_stats_allocator_test, counts_allocations_per_call_site)
+{
+    using namespace memoc;
+
+    using Allocator = Site_stats_allocator<Malloc_allocator, 4>;
+    Allocator::reset();
+    Allocator allocator{};
+
+    Block<void> blocks[5]{};
+    for (std::int64_t i = 0; i < 3; ++i) {
+        blocks[i] = allocator.allocate(16).value();
+    }
+    blocks[3] = allocator.allocate(100).value();
+    blocks[4] = allocate_at(allocator, 8).value();
+    for (Block<void>& b : blocks) {
+        allocator.deallocate(b);
+    }
+
+    EXPECT_EQ(3, Allocator::sites());
+    EXPECT_EQ(0, Allocator::dropped());
+
+    Allocator::Site sites[2]{};
+    ASSERT_EQ(2, Allocator::top(sites, 2));
+    EXPECT_EQ(1, sites[0].count);
+    EXPECT_EQ(100, sites[0].bytes);
+    EXPECT_EQ(3, sites[1].count);
+    EXPECT_EQ(48, sites[1].bytes);
+    EXPECT_EQ(sites[0].location.line(), sites[1].location.line() + 2);
+    EXPECT_STREQ(__FILE__, sites[0].location.file_name());
+
+    Allocator::reset();
+    EXPECT_EQ(0, Allocator::top(sites, 2));
+}
+
+TEST(Site_stats_allocator_test, drops_allocations_of_sites_beyond_capacity)
+{
+    using namespace memoc;
+
+    using Allocator = Site_stats_allocator<Malloc_allocator, 1>;
+    Allocator::reset();
+    Allocator allocator{};
+
+    Block<void> b1 = allocator.allocate(8).value();
+    Block<void> b2 = allocator.allocate(8).value();
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+
+    EXPECT_EQ(1, Allocator::sites());
+    EXPECT_EQ(1, Allocator::dropped());
+}
+
+TEST(Site_stats_allocator_test, adds_the_counts_of_threads_at_their_exit)
+{
+    using namespace memoc;
+
+    using Allocator = Site_stats_allocator<Malloc_allocator, 4>;
+    Allocator::reset();
+
+    std::thread t([]() {
+        Allocator allocator{};
+        for (std::int64_t i = 0; i < 3; ++i) {
+            Block<void> b = allocator.allocate(10).value();
+            allocator.deallocate(b);
+        }
+    });
+    t.join();
+
+    Allocator::Site site{};
+    ASSERT_EQ(1, Allocator::top(&site, 1));
+    EXPECT_EQ(3, site.count);
+    EXPECT_EQ(30, site.bytes);
+
+    Allocator::reset();
+}
+
+TEST(Site_stats_allocator_test, attributes_buffers_and_pointers_to_their_call_sites)
+{
+    using namespace memoc;
+
+    using Allocator = Site_stats_allocator<Malloc_allocator, 8>;
+    Allocator::reset();
+
+    {
+        Buffer<int, Allocator> buffer{ 4 };
+    }
+    Allocator::Site site{};
+    ASSERT_EQ(1, Allocator::top(&site, 1));
+    EXPECT_EQ(__LINE__ - 4, static_cast<int>(site.location.line()));
+    EXPECT_EQ(4 * MEMOC_SSIZEOF(int), site.bytes);
+
+    Allocator::reset();
+    {
+        Unique_ptr<std::int64_t, Allocator> p = make_unique_at<std::int64_t, Allocator>(std::source_location::current(), 7);
+        EXPECT_EQ(7, *p);
+    }
+    ASSERT_EQ(1, Allocator::top(&site, 1));
+    EXPECT_EQ(__LINE__ - 4, static_cast<int>(site.location.line()));
+    EXPECT_EQ(MEMOC_SSIZEOF(std::int64_t), site.bytes);
+
+    Allocator::reset();
+}
+
+TEST(Site_stats_allocator_test, attributes_allocations_through_wrapping_allocators_to_their_call_sites)
+{
+    using namespace memoc;
+
+    using Allocator = Site_stats_allocator<Malloc_allocator, 8, 1>;
+    Allocator::reset();
+
+    Any_allocator allocator{ Synchronized_allocator<Fallback_allocator<Stack_allocator<details::Local_stack_memory<16>>, Allocator>>{} };
+    Block<void> b1 = allocator.allocate(64).value();
+    Block<void> b2 = allocate_at(allocator, 32).value();
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+
+    Allocator::Site sites[2]{};
+    ASSERT_EQ(2, Allocator::top(sites, 2));
+    EXPECT_EQ(__LINE__ - 7, static_cast<int>(sites[0].location.line()));
+    EXPECT_EQ(__LINE__ - 7, static_cast<int>(sites[1].location.line()));
+    EXPECT_STREQ(__FILE__, sites[0].location.file_name());
+    EXPECT_STREQ(__FILE__, sites[1].location.file_name());
+
+    Allocator::reset();
+}
+
+// Latency_allocator tests
+
+TEST(Latency_histogram_test, buckets_values_with_bounded_relative_error)
+{
+    using Histogram = memoc::Latency_histogram<16>;
+
+    for (std::int64_t v = 0; v < 16; ++v) {
+        EXPECT_EQ(v, Histogram::upper_bound_of(Histogram::bucket_of(v)));
+    }
+    EXPECT_EQ(Histogram::bucket_of(16) + 1, Histogram::bucket_of(17));
+    EXPECT_EQ(Histogram::bucket_of(32), Histogram::bucket_of(33));
+    EXPECT_EQ(33, Histogram::upper_bound_of(Histogram::bucket_of(32)));
+
+    for (std::int64_t v : { 100, 1000, 123456, 1000000007 }) {
+        const std::int64_t upper = Histogram::upper_bound_of(Histogram::bucket_of(v));
+        EXPECT_LE(v, upper);
+        EXPECT_LT(upper - v, v / 16 + 1);
+    }
+}
+
+TEST(Latency_histogram_test, summarizes_percentiles_of_merged_counts)
+{
+    using Histogram = memoc::Latency_histogram<16>;
+
+    Histogram h1{};
+    Histogram h2{};
+    for (std::int64_t i = 0; i < 990; ++i) {
+        h1.record(10);
+    }
+    for (std::int64_t i = 0; i < 9; ++i) {
+        h2.record(1000);
+    }
+    h2.record(5000);
+
+    std::int64_t counts[Histogram::buckets_count]{};
+    std::int64_t count = 0;
+    std::int64_t max = 0;
+    h1.merge_into(counts, count, max);
+    h2.merge_into(counts, count, max);
+
+    memoc::Latency_summary summary = Histogram::summarize(counts, count, max);
+    EXPECT_EQ(1000, summary.count);
+    EXPECT_EQ(10, summary.p50);
+    EXPECT_EQ(10, summary.p99);
+    EXPECT_EQ(Histogram::upper_bound_of(Histogram::bucket_of(1000)), summary.p999);
+    EXPECT_EQ(5000, summary.max);
+
+    summary = Histogram::summarize(counts, 0, 0);
+    EXPECT_EQ(0, summary.count);
+    EXPECT_EQ(0, summary.p99);
+}
+
+namespace {
+    // Advances by the size of each allocation, so the measured latency of an allocation is its size in nanoseconds.
+    struct Fake_clock {
+        using rep = std::int64_t;
+        using period = std::nano;
+        using duration = std::chrono::nanoseconds;
+        using time_point = std::chrono::time_point<Fake_clock>;
+        static constexpr bool is_steady = true;
+
+        static time_point now() noexcept
+        {
+            return time_point(duration(ticks));
+        }
+
+        inline static std::int64_t ticks{ 0 };
+    };
+
+    struct Ticking_allocator {
+        [[nodiscard]] oc::Expected<memoc::Block<void>, memoc::Allocator_error> allocate(memoc::Block<void>::Size_type s) noexcept
+        {
+            Fake_clock::ticks += s;
+            return memoc::Malloc_allocator{}.allocate(s);
+        }
+
+        void deallocate(memoc::Block<void>& b) noexcept
+        {
+            Fake_clock::ticks += 1;
+            memoc::Malloc_allocator{}.deallocate(b);
+        }
+
+        [[nodiscard]] bool owns(const memoc::Block<void>& b) const noexcept
+        {
+            return memoc::Malloc_allocator{}.owns(b);
+        }
+    };
+}
+
+TEST(Latency_allocator_test, measures_operations_of_all_threads)
+{
+    using namespace memoc;
+
+    using Allocator = Latency_allocator<Ticking_allocator, 1, Fake_clock>;
+    Allocator::reset();
+
+    auto work = []() {
+        Allocator allocator{};
+        for (std::int64_t s : { 8, 8, 8, 200 }) {
+            Block<void> b = allocator.allocate(s).value();
+            allocator.deallocate(b);
+        }
+    };
+    std::thread t(work);
+    t.join();
+    work();
+
+    const Latency_summary allocations = Allocator::allocation_latency();
+    EXPECT_EQ(8, allocations.count);
+    EXPECT_EQ(8, allocations.p50);
+    EXPECT_EQ(200, allocations.p99);
+    EXPECT_EQ(200, allocations.max);
+
+    const Latency_summary deallocations = Allocator::deallocation_latency();
+    EXPECT_EQ(8, deallocations.count);
+    EXPECT_EQ(1, deallocations.max);
+
+    Allocator::reset();
+    EXPECT_EQ(0, Allocator::allocation_latency().count);
+}
+
+TEST(Latency_allocator_test, samples_one_of_every_sample_rate_operations)
+{
+    using namespace memoc;
+
+    using Allocator = Latency_allocator<Malloc_allocator, 4>;
+    Allocator::reset();
+    Allocator allocator{};
+
+    Block<void> blocks[8]{};
+    for (Block<void>& b : blocks) {
+        b = allocator.allocate(16).value();
+    }
+    for (Block<void>& b : blocks) {
+        allocator.deallocate(b);
+    }
+
+    EXPECT_EQ(2, Allocator::allocation_latency().count);
+    EXPECT_EQ(2, Allocator::deallocation_latency().count);
+}
+
 // Shared_allocator tests
 
 class Shared_allocator_test : public ::testing::Test {
@@ -612,6 +1684,85 @@ TEST_F(Shared_allocator_test, DISABLED_not_saves_state_between_instances_when_id
     EXPECT_NE(reinterpret_cast<std::uint8_t*>(b1.data()) + aligned_size, b2.data());
 }
 
+// Synchronized_allocator tests
+
+TEST(Synchronized_allocator_test, serializes_concurrent_allocations)
+{
+    using namespace memoc;
+
+    Synchronized_allocator<Free_list_allocator<Malloc_allocator, 16, 64, 8>> allocator{};
+    static_assert(Allocator_traits<decltype(allocator)>::is_thread_safe);
+
+    auto work = [&]() {
+        for (int i = 0; i < 1000; ++i) {
+            Block<void> b = allocator.allocate(32).value();
+            allocator.deallocate(b);
+        }
+    };
+    std::thread t1(work);
+    std::thread t2(work);
+    t1.join();
+    t2.join();
+
+    Block<void> b = allocator.allocate(32).value();
+    EXPECT_EQ(32, b.size());
+    allocator.deallocate(b);
+}
+
+TEST(Synchronized_allocator_test, blocks_other_threads_while_its_lock_is_held)
+{
+    using namespace memoc;
+
+    Synchronized_allocator<Malloc_allocator> allocator{};
+    std::atomic<bool> allocated{ false };
+
+    allocator.lock();
+    std::thread t([&]() {
+        Block<void> b = allocator.allocate(32).value();
+        allocated = true;
+        allocator.deallocate(b);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(allocated);
+    allocator.unlock();
+    t.join();
+    EXPECT_TRUE(allocated);
+}
+
+// Thread_cache_allocator tests
+
+TEST(Thread_cache_allocator_test, caches_blocks_per_thread)
+{
+    using namespace memoc;
+
+    using Allocator = Thread_cache_allocator<Shared_allocator<Synchronized_allocator<Malloc_allocator>>, 16, 64, 2>;
+    Allocator allocator{};
+
+    Block<void> b1 = allocator.allocate(32).value();
+    void* p1 = b1.data();
+    allocator.deallocate(b1);
+    EXPECT_TRUE(b1.empty());
+
+    Block<void> b2 = allocator.allocate(30).value();
+    EXPECT_EQ(p1, b2.data());
+
+    // Another thread has a cache of its own, and deallocates into it
+    void* p3 = nullptr;
+    std::thread t([&]() {
+        Allocator a{};
+        Block<void> b3 = a.allocate(32).value();
+        p3 = b3.data();
+        EXPECT_NE(p1, p3);
+        a.deallocate(b2);
+        a.deallocate(b3);
+    });
+    t.join();
+
+    Block<void> b4 = allocator.allocate(1000).value();
+    EXPECT_EQ(1000, b4.size());
+    allocator.deallocate(b4);
+}
+
 // Null_allocator tests
 
 class Null_allocator_test : public ::testing::Test {
@@ -687,12 +1838,735 @@ TEST_F(Fallback_allocator_test, DISABLED_is_moveable)
     EXPECT_NE(nullptr, b2.data());
 }
 
+TEST_F(Fallback_allocator_test, deallocates_blocks_of_nested_allocators_by_their_owners)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Default_global_stack_memory<2, 32>>;
+    using Free_list = Free_list_allocator<Malloc_allocator, 16, 32, 2>;
+    using Nested = Fallback_allocator<Fallback_allocator<Stack, Free_list>, Malloc_allocator>;
+    Nested allocator{};
+
+    Block<void> b1 = allocator.allocate(32).value();
+    Block<void> b2 = allocator.allocate(32).value();
+    Block<void> b3 = allocator.allocate(32).value();
+    Block<void> b4 = allocator.allocate(64).value();
+
+    EXPECT_TRUE(Stack{}.owns(b1));
+    EXPECT_TRUE(Stack{}.owns(b2));
+    EXPECT_FALSE(Stack{}.owns(b3));
+    EXPECT_TRUE(allocator.owns(b3));
+    EXPECT_TRUE(allocator.owns(b4));
+
+    allocator.deallocate(b4);
+    allocator.deallocate(b3);
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    EXPECT_TRUE(b4.empty());
+    EXPECT_TRUE(b3.empty());
+    EXPECT_TRUE(b2.empty());
+    EXPECT_TRUE(b1.empty());
+
+    // Deallocated stack memory is reused
+    Block<void> b5 = allocator.allocate(32).value();
+    EXPECT_TRUE(Stack{}.owns(b5));
+    allocator.deallocate(b5);
+}
+
+TEST_F(Fallback_allocator_test, ignores_blocks_owned_by_neither_allocator)
+{
+    using namespace memoc;
+
+    Fallback_allocator<Stack_allocator<details::Default_global_stack_memory<1, 32>>, Malloc_allocator> allocator{};
+
+    std::uint8_t memory[64]{};
+    Block<void> foreign{ 64, memory };
+    EXPECT_FALSE(allocator.owns(foreign));
+    allocator.deallocate(foreign);
+    EXPECT_EQ(memory, foreign.data());
+}
+
+TEST_F(Fallback_allocator_test, warms_up_each_allocator_by_its_own_amount)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Default_global_stack_memory<1, 64>>;
+    using Free_list = Free_list_allocator<Malloc_allocator, 16, 32, 4>;
+    Fallback_allocator<Stack, Free_list> allocator{};
+
+    // Bytes of the stack and blocks of the free list
+    const auto [stack_bytes, free_list_blocks] = allocator.warm_up(64, 8);
+    EXPECT_EQ(64, stack_bytes);
+    EXPECT_EQ(4, free_list_blocks);
+
+    Fallback_chain<Stack, Free_list, Malloc_allocator> chain{};
+    const std::array<std::int64_t, 3> warmed = chain.warm_up(32, 2, 1024);
+    EXPECT_EQ(32, warmed[0]);
+    EXPECT_EQ(2, warmed[1]);
+    EXPECT_EQ(0, warmed[2]);
+}
+
+// Fallback_chain tests
+
+class Fallback_chain_test : public ::testing::Test {
+protected:
+    static constexpr memoc::Block<void>::Size_type size_ = 32;
+
+    using First = memoc::Stack_allocator<memoc::details::Default_global_stack_memory<1, size_>>;
+    using Second = memoc::Stack_allocator<memoc::details::Default_global_stack_memory<1, size_ * 2>>;
+    using Third = memoc::Free_list_allocator<memoc::Malloc_allocator, 16, size_, 2>;
+
+    using Allocator = memoc::Fallback_chain<First, Second, Third>;
+    Allocator allocator_{};
+};
+
+TEST_F(Fallback_chain_test, allocates_from_the_first_available_allocator_and_counts_hits)
+{
+    using namespace memoc;
+
+    Block<void> b1 = allocator_.allocate(size_).value();
+    Block<void> b2 = allocator_.allocate(size_).value();
+    Block<void> b3 = allocator_.allocate(size_).value();
+    Block<void> b4 = allocator_.allocate(size_).value();
+
+    EXPECT_EQ(First::id, b1.hint());
+    EXPECT_EQ(Second::id, b2.hint());
+    EXPECT_EQ(Second::id, b3.hint());
+    EXPECT_EQ(Malloc_allocator::id, b4.hint());
+    EXPECT_TRUE(allocator_.get<2>().owns(b4));
+    EXPECT_TRUE(allocator_.owns(b4));
+
+    EXPECT_EQ(1, allocator_.hits<0>());
+    EXPECT_EQ(2, allocator_.hits<1>());
+    EXPECT_EQ(1, allocator_.hits<2>());
+
+    allocator_.deallocate(b4);
+    allocator_.deallocate(b3);
+    allocator_.deallocate(b2);
+    allocator_.deallocate(b1);
+    EXPECT_TRUE(b4.empty());
+    EXPECT_TRUE(b1.empty());
+
+    // Deallocated memory is reused by its allocator
+    b1 = allocator_.allocate(size_ * 2).value();
+    EXPECT_EQ(Second::id, b1.hint());
+    EXPECT_EQ(3, allocator_.hits<1>());
+    allocator_.deallocate(b1);
+}
+
+TEST_F(Fallback_chain_test, returns_the_last_error_if_all_allocators_failed)
+{
+    using namespace memoc;
+
+    Fallback_chain<First, Null_allocator> empty_last{};
+    EXPECT_TRUE(empty_last.allocate(size_ * 2).value().empty());
+
+    Fallback_chain<First> single{};
+    EXPECT_EQ(Allocator_error::out_of_memory, single.allocate(size_ * 2).error());
+    EXPECT_EQ(Allocator_error::invalid_size, single.allocate(-1).error());
+    EXPECT_EQ(0, single.hits<0>());
+}
+
+TEST_F(Fallback_chain_test, deallocates_blocks_of_wrapping_allocators_by_their_owners)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Local_stack_memory<size_ * 2>>;
+    Memory_budget budget{ 1024 };
+    Fallback_chain<Stack, Budget_allocator<Stack>, Malloc_allocator> chain{ Stack{}, Budget_allocator<Stack>{ budget }, Malloc_allocator{} };
+
+    Block<void> b1 = chain.allocate(size_ * 2).value();
+    EXPECT_EQ(1, chain.hits<0>());
+
+    // The budget's blocks carry the hint of its stack
+    Block<void> b2 = chain.allocate(size_ * 2).value();
+    EXPECT_EQ(1, chain.hits<1>());
+    EXPECT_EQ(Stack::id, b2.hint());
+    EXPECT_EQ(size_ * 2, budget.in_use());
+
+    chain.deallocate(b2);
+    EXPECT_TRUE(b2.empty());
+    EXPECT_EQ(0, budget.in_use());
+    chain.deallocate(b1);
+    EXPECT_TRUE(b1.empty());
+
+    // Both stacks are empty again
+    b1 = chain.allocate(size_ * 2).value();
+    b2 = chain.allocate(size_ * 2).value();
+    EXPECT_EQ(2, chain.hits<0>());
+    EXPECT_EQ(2, chain.hits<1>());
+    chain.deallocate(b2);
+    chain.deallocate(b1);
+}
+
+TEST(Type_id_test, is_unique_per_type)
+{
+    using namespace memoc;
+
+    static_assert(type_id<int>() == type_id<int>());
+    static_assert(type_id<int>() != type_id<long>());
+    static_assert(type_id<Stack_allocator<details::Default_global_stack_memory<1, 2>>>() != type_id<Stack_allocator<details::Default_global_stack_memory<1, 4>>>());
+    static_assert(type_id<int>() >= 0);
+}
+
+// Segregator tests
+
+TEST(Segregator_test, dispatches_blocks_by_size)
+{
+    using namespace memoc;
+
+    Segregator<32, Stack_allocator<details::Local_stack_memory<64>>, Malloc_allocator> allocator{};
+
+    Block<void> b1 = allocator.allocate(32).value();
+    Block<void> b2 = allocator.allocate(33).value();
+    EXPECT_TRUE(allocator.small().owns(b1));
+    EXPECT_TRUE(allocator.large().owns(b2));
+    EXPECT_TRUE(allocator.owns(b1));
+    EXPECT_TRUE(allocator.owns(b2));
+    EXPECT_EQ(32, allocator.good_size(31));
+
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    EXPECT_TRUE(b1.empty());
+    EXPECT_TRUE(b2.empty());
+
+    static_assert(Allocator_traits<Segregator<32, Malloc_allocator, Mmap_allocator>>::is_thread_safe);
+    static_assert(Allocator_traits<Segregator<32, Malloc_allocator, Mmap_allocator>>::is_stateless);
+}
+
+// Lifetime_allocator tests
+
+namespace {
+    struct Frame_scratch {
+        static constexpr memoc::Lifetime lifetime = memoc::Lifetime::transient;
+    };
+}
+
+class Lifetime_allocator_test : public ::testing::Test {
+protected:
+    static constexpr memoc::Block<void>::Size_type size_ = 32;
+
+    using Transient = memoc::Ring_allocator<memoc::Malloc_allocator>;
+    using Persistent = memoc::Malloc_allocator;
+};
+
+TEST_F(Lifetime_allocator_test, routes_lifetime_classes_to_separate_allocators)
+{
+    using namespace memoc;
+
+    Lifetime_allocator<Transient, Persistent> allocator{};
+
+    Block<void> b1 = allocator.allocate(size_, Lifetime::transient).value();
+    Block<void> b2 = allocator.allocate<Frame_scratch>(size_).value();
+    Block<void> b3 = allocator.allocate(size_, Lifetime::persistent).value();
+    Block<void> b4 = allocator.allocate(size_).value();
+
+    EXPECT_TRUE(allocator.transient().owns(b1));
+    EXPECT_TRUE(allocator.transient().owns(b2));
+    EXPECT_FALSE(allocator.transient().owns(b3));
+    EXPECT_FALSE(allocator.transient().owns(b4));
+    EXPECT_TRUE(allocator.owns(b3));
+    EXPECT_LT(0, allocator.transient().used());
+
+    allocator.deallocate(b1);
+    allocator.deallocate(b2);
+    allocator.deallocate(b3);
+    allocator.deallocate(b4);
+
+    EXPECT_EQ(0, allocator.transient().used());
+    EXPECT_TRUE(b3.empty());
+}
+
+TEST_F(Lifetime_allocator_test, predicts_lifetimes_per_allocation_site)
+{
+    using namespace memoc;
+
+    static constexpr std::int64_t short_site = 0;
+    static constexpr std::int64_t long_site = 1;
+    Lifetime_predicting_allocator<Transient, Persistent, 2, 4> allocator{};
+
+    EXPECT_EQ(Lifetime::persistent, allocator.predict(short_site));
+    EXPECT_EQ(-1, allocator.average_lifetime(short_site));
+
+    Block<void> held = allocator.allocate(size_, long_site).value();
+    for (int i = 0; i < 8; ++i) {
+        Block<void> b = allocator.allocate(size_, short_site).value();
+        EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(b.data()) % alignof(std::max_align_t));
+        EXPECT_TRUE(allocator.owns(b));
+        allocator.deallocate(b);
+        EXPECT_TRUE(b.empty());
+    }
+    allocator.deallocate(held);
+
+    EXPECT_EQ(1, allocator.average_lifetime(short_site));
+    EXPECT_EQ(Lifetime::transient, allocator.predict(short_site));
+    EXPECT_EQ(9, allocator.average_lifetime(long_site));
+    EXPECT_EQ(Lifetime::persistent, allocator.predict(long_site));
+
+    // Unknown sites are not tracked
+    Block<void> b = allocator.allocate(size_).value();
+    Block<void> c = allocator.allocate(size_, 7).value();
+    allocator.deallocate(c);
+    allocator.deallocate(b);
+    EXPECT_EQ(Lifetime::persistent, allocator.predict(7));
+
+    EXPECT_EQ(Allocator_error::invalid_size, allocator.allocate(-1, short_site).error());
+    EXPECT_TRUE(allocator.allocate(0, short_site).value().empty());
+}
+
+TEST_F(Lifetime_allocator_test, predicting_allocator_does_not_read_foreign_blocks)
+{
+    using namespace memoc;
+
+    Lifetime_predicting_allocator<Transient, Persistent, 2, 4> predicting{};
+    Fallback_allocator<Lifetime_predicting_allocator<Transient, Persistent, 2, 4>, Malloc_allocator> allocator{};
+
+    // A header read before the foreign block would overflow the block
+    Block<void> foreign = Malloc_allocator{}.allocate(1).value();
+    EXPECT_FALSE(predicting.owns(foreign));
+    EXPECT_TRUE(allocator.owns(foreign));
+    allocator.deallocate(foreign);
+    EXPECT_TRUE(foreign.empty());
+
+    Block<void> b = predicting.allocate(size_).value();
+    EXPECT_TRUE(predicting.owns(b));
+    predicting.deallocate(b);
+    EXPECT_TRUE(b.empty());
+}
+
+// Budget_allocator tests
+
+class Budget_allocator_test : public ::testing::Test {
+protected:
+    using Parent = memoc::Malloc_allocator;
+
+    using Allocator = memoc::Budget_allocator<Parent>;
+};
+
+TEST_F(Budget_allocator_test, allocates_without_limits_when_has_no_budget)
+{
+    using namespace memoc;
+
+    Allocator allocator{};
+    EXPECT_EQ(nullptr, allocator.budget());
+
+    Block<void> b = allocator.allocate(64).value();
+    EXPECT_NE(nullptr, b.data());
+    EXPECT_TRUE(allocator.owns(b));
+
+    allocator.deallocate(b);
+    EXPECT_TRUE(b.empty());
+
+    EXPECT_EQ(Allocator_error::invalid_size, allocator.allocate(-1).error());
+}
+
+TEST_F(Budget_allocator_test, fails_with_out_of_memory_when_exceeding_hard_limit)
+{
+    using namespace memoc;
+
+    Memory_budget budget{ 64 };
+    Allocator allocator{ budget };
+
+    Block<void> b1 = allocator.allocate(48).value();
+    EXPECT_EQ(48, budget.in_use());
+
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(32).error());
+    EXPECT_EQ(48, budget.in_use());
+
+    Block<void> b2 = allocator.allocate(16).value();
+    EXPECT_EQ(64, budget.in_use());
+    EXPECT_EQ(64, budget.peak());
+
+    allocator.deallocate(b1);
+    allocator.deallocate(b2);
+    EXPECT_EQ(0, budget.in_use());
+    EXPECT_EQ(64, budget.peak());
+}
+
+TEST_F(Budget_allocator_test, calls_handler_once_when_crossing_soft_limit)
+{
+    using namespace memoc;
+
+    Memory_budget budget{ 128, 32 };
+    std::int64_t calls{ 0 };
+    budget.on_soft_limit([](Memory_budget&, void* context) noexcept { ++*static_cast<std::int64_t*>(context); }, &calls);
+
+    Allocator allocator{ budget };
+
+    Block<void> b1 = allocator.allocate(32).value();
+    EXPECT_EQ(0, calls);
+
+    Block<void> b2 = allocator.allocate(16).value();
+    EXPECT_EQ(1, calls);
+
+    Block<void> b3 = allocator.allocate(16).value();
+    EXPECT_EQ(1, calls);
+
+    allocator.deallocate(b2);
+    allocator.deallocate(b3);
+
+    Block<void> b4 = allocator.allocate(16).value();
+    EXPECT_EQ(2, calls);
+
+    allocator.deallocate(b1);
+    allocator.deallocate(b4);
+}
+
+TEST_F(Budget_allocator_test, child_budgets_roll_up_into_parent_budget)
+{
+    using namespace memoc;
+
+    Memory_budget process{ 96 };
+    Memory_budget tenant1{ 64, Memory_budget::unlimited, &process };
+    Memory_budget tenant2{ 64, Memory_budget::unlimited, &process };
+
+    Allocator a1{ tenant1 };
+    Allocator a2{ tenant2 };
+
+    Block<void> b1 = a1.allocate(64).value();
+    EXPECT_EQ(64, tenant1.in_use());
+    EXPECT_EQ(64, process.in_use());
+
+    // Within tenant2 limit but exceeds the process limit
+    EXPECT_EQ(Allocator_error::out_of_memory, a2.allocate(48).error());
+    EXPECT_EQ(0, tenant2.in_use());
+    EXPECT_EQ(64, process.in_use());
+
+    Block<void> b2 = a2.allocate(32).value();
+    EXPECT_EQ(32, tenant2.in_use());
+    EXPECT_EQ(96, process.in_use());
+
+    a1.deallocate(b1);
+    a2.deallocate(b2);
+    EXPECT_EQ(0, tenant1.in_use());
+    EXPECT_EQ(0, tenant2.in_use());
+    EXPECT_EQ(0, process.in_use());
+}
+
+TEST_F(Budget_allocator_test, releases_budget_when_internal_allocation_fails)
+{
+    using namespace memoc;
+
+    Memory_budget budget{ 64 };
+    Budget_allocator<Stack_allocator<details::Default_global_stack_memory<1, 16>>> allocator{ budget };
+
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(32).error());
+    EXPECT_EQ(0, budget.in_use());
+}
+
+// Allocator_observer tests
+
+namespace {
+    using Observed_allocator = memoc::Stack_allocator<memoc::details::Local_stack_memory<96>>;
+
+    struct Observed_events {
+        std::int64_t allocations{ 0 };
+        std::int64_t deallocations{ 0 };
+        std::int64_t failures{ 0 };
+        memoc::Block<void>::Size_type bytes{ 0 };
+    };
+
+    Observed_events observed_events{};
+}
+
+template <>
+struct memoc::details::Allocator_observer<Observed_allocator> {
+    static constexpr bool enabled = true;
+
+    static void on_allocate(const Observed_allocator&, const memoc::Block<void>& b) noexcept
+    {
+        ++observed_events.allocations;
+        observed_events.bytes += b.size();
+    }
+
+    static void on_deallocate(const Observed_allocator&, const memoc::Block<void>& b) noexcept
+    {
+        ++observed_events.deallocations;
+        observed_events.bytes -= b.size();
+    }
+
+    static void on_failure(const Observed_allocator&, memoc::Block<void>::Size_type, memoc::Allocator_error) noexcept
+    {
+        ++observed_events.failures;
+    }
+};
+
+TEST(Allocator_observer_test, observes_allocations_deallocations_and_failures)
+{
+    using namespace memoc;
+
+    observed_events = {};
+    Observed_allocator allocator{};
+
+    Block<void> b1 = allocator.allocate(64).value();
+    EXPECT_EQ(1, observed_events.allocations);
+    EXPECT_EQ(64, observed_events.bytes);
+
+    EXPECT_FALSE(allocator.allocate(64));
+    EXPECT_EQ(1, observed_events.failures);
+
+    // Empty blocks are not observed
+    Block<void> b2 = allocator.allocate(0).value();
+    allocator.deallocate(b2);
+    EXPECT_EQ(1, observed_events.allocations);
+    EXPECT_EQ(0, observed_events.deallocations);
+
+    allocator.deallocate(b1);
+    EXPECT_EQ(1, observed_events.deallocations);
+    EXPECT_EQ(0, observed_events.bytes);
+
+    // Other allocators, including the ones over the observed type, are not observed
+    Fallback_allocator<Observed_allocator, Malloc_allocator> fallback{};
+    Block<void> b3 = fallback.allocate(128).value();
+    fallback.deallocate(b3);
+    EXPECT_EQ(2, observed_events.failures);
+    EXPECT_EQ(1, observed_events.allocations);
+}
+
+namespace {
+    using Observed_budget_allocator = memoc::Budget_allocator<memoc::Stack_allocator<memoc::details::Local_stack_memory<128>>>;
+
+    std::int64_t observed_budget_failures{ 0 };
+    std::int64_t observed_budget_deallocations{ 0 };
+}
+
+template <>
+struct memoc::details::Allocator_observer<Observed_budget_allocator> {
+    static constexpr bool enabled = true;
+
+    static void on_allocate(const Observed_budget_allocator&, const memoc::Block<void>&) noexcept {}
+
+    static void on_deallocate(const Observed_budget_allocator&, const memoc::Block<void>&) noexcept
+    {
+        ++observed_budget_deallocations;
+    }
+
+    static void on_failure(const Observed_budget_allocator&, memoc::Block<void>::Size_type, memoc::Allocator_error e) noexcept
+    {
+        if (e == memoc::Allocator_error::out_of_memory) {
+            ++observed_budget_failures;
+        }
+    }
+};
+
+TEST(Allocator_observer_test, observes_wrapping_allocators)
+{
+    using namespace memoc;
+
+    observed_budget_failures = 0;
+    observed_budget_deallocations = 0;
+
+    Memory_budget budget{ 64 };
+    Observed_budget_allocator allocator{ budget };
+
+    Block<void> b = allocator.allocate(64).value();
+    EXPECT_FALSE(allocator.allocate(1));
+    EXPECT_EQ(1, observed_budget_failures);
+
+    allocator.deallocate(b);
+    EXPECT_EQ(1, observed_budget_deallocations);
+}
+
+namespace {
+    using Observed_site_allocator = memoc::Site_stats_allocator<memoc::Malloc_allocator, 16>;
+
+    std::int64_t observed_site_allocations{ 0 };
+    std::int64_t observed_site_deallocations{ 0 };
+}
+
+template <>
+struct memoc::details::Allocator_observer<Observed_site_allocator> {
+    static constexpr bool enabled = true;
+
+    static void on_allocate(const Observed_site_allocator&, const memoc::Block<void>&) noexcept
+    {
+        ++observed_site_allocations;
+    }
+
+    static void on_deallocate(const Observed_site_allocator&, const memoc::Block<void>&) noexcept
+    {
+        ++observed_site_deallocations;
+    }
+
+    static void on_failure(const Observed_site_allocator&, memoc::Block<void>::Size_type, memoc::Allocator_error) noexcept {}
+};
+
+TEST(Allocator_observer_test, observes_site_stats_allocators)
+{
+    using namespace memoc;
+
+    observed_site_allocations = 0;
+    observed_site_deallocations = 0;
+
+    Observed_site_allocator allocator{};
+    Block<void> b = allocate_at(allocator, 8).value();
+    EXPECT_EQ(1, observed_site_allocations);
+    allocator.deallocate(b);
+    EXPECT_EQ(1, observed_site_deallocations);
+
+    Observed_site_allocator::reset();
+}
+
+// No_alloc_scope tests
+
+TEST(No_alloc_scope_test, counts_system_allocations_of_the_thread_in_scope)
+{
+    using namespace memoc;
+
+    Free_list_allocator<Malloc_allocator, 16, 64, 4> allocator{};
+    Block<void> b = allocator.allocate(32).value();
+    allocator.deallocate(b);
+    EXPECT_FALSE(No_alloc_scope::active());
+
+    {
+        No_alloc_scope scope{};
+        EXPECT_TRUE(No_alloc_scope::active());
+
+        // Reused by the free list
+        b = allocator.allocate(32).value();
+        allocator.deallocate(b);
+        EXPECT_EQ(0, scope.allocations());
+
+        b = allocator.allocate(100).value();
+        allocator.deallocate(b);
+        EXPECT_EQ(1, scope.allocations());
+
+        {
+            No_alloc_scope nested{};
+            Buffer<int> buffer{ 4 };
+            Unique_ptr<int> p = make_unique<int>(1);
+            EXPECT_EQ(2, nested.allocations());
+        }
+        EXPECT_EQ(3, scope.allocations());
+
+        std::thread t([]() {
+            Block<void> other = Malloc_allocator{}.allocate(8).value();
+            Malloc_allocator{}.deallocate(other);
+        });
+        t.join();
+        EXPECT_EQ(3, scope.allocations());
+    }
+    EXPECT_FALSE(No_alloc_scope::active());
+}
+
+TEST(No_alloc_scope_test, aborting_scope_aborts_on_allocation)
+{
+    using namespace memoc;
+
+    EXPECT_DEATH({
+        No_alloc_scope scope{ true };
+        No_alloc_scope nested{};
+        Block<void> b = Malloc_allocator{}.allocate(24).value();
+        Malloc_allocator{}.deallocate(b);
+    }, "allocation of 24 bytes in a No_alloc_scope");
+}
+
+// Allocator_traits tests
+
+TEST(Allocator_traits_test, detects_capabilities_and_properties)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Default_global_stack_memory<1, 64>>;
+    using Local_stack = Stack_allocator<details::Local_stack_memory<64>>;
+    using Free_list = Free_list_allocator<Malloc_allocator, 16, 32, 2>;
+
+    static_assert(Allocator_traits<Malloc_allocator>::can_reallocate);
+    static_assert(Allocator_traits<Malloc_allocator>::can_allocate_aligned);
+    static_assert(Allocator_traits<Malloc_allocator>::can_allocate_zeroed);
+    static_assert(!Allocator_traits<Malloc_allocator>::can_expand);
+    static_assert(!Allocator_traits<Malloc_allocator>::can_allocate_bulk);
+    static_assert(Allocator_traits<Malloc_allocator>::is_thread_safe);
+    static_assert(Allocator_traits<Malloc_allocator>::is_stateless);
+    static_assert(Allocator_traits<Malloc_allocator>::min_alignment == alignof(std::max_align_t));
+
+    static_assert(Allocator_traits<Stack>::can_expand);
+    static_assert(Allocator_traits<Stack>::is_stateless);
+    static_assert(!Allocator_traits<Stack>::is_thread_safe);
+    static_assert(Allocator_traits<Stack>::min_alignment == 1);
+    static_assert(!Allocator_traits<Local_stack>::is_stateless);
+
+    static_assert(!Allocator_traits<Free_list>::is_stateless);
+    static_assert(!Allocator_traits<Free_list>::can_reallocate);
+
+    // Composites propagate the capabilities and properties of their allocators
+    using Fallback = Fallback_allocator<Stack, Malloc_allocator>;
+    static_assert(Allocator_traits<Fallback>::can_expand);
+    static_assert(!Allocator_traits<Fallback>::can_allocate_zeroed);
+    static_assert(Allocator_traits<Fallback>::is_stateless);
+    static_assert(!Allocator_traits<Fallback>::is_thread_safe);
+    static_assert(Allocator_traits<Fallback>::min_alignment == 1);
+
+    using Chain = Fallback_chain<Malloc_allocator, Malloc_allocator>;
+    static_assert(Allocator_traits<Chain>::can_allocate_zeroed);
+    static_assert(Allocator_traits<Chain>::is_thread_safe);
+
+    using Shared = Shared_allocator<Free_list>;
+    static_assert(Allocator_traits<Shared>::is_stateless);
+    static_assert(Allocator_traits<Shared_allocator<Malloc_allocator>>::can_reallocate);
+}
+
+TEST(Allocator_traits_test, malloc_allocator_reallocates_and_allocates_aligned_and_zeroed_memory)
+{
+    using namespace memoc;
+
+    Malloc_allocator allocator{};
+
+    Block<void> b = allocator.allocate_zeroed(64).value();
+    for (std::int64_t i = 0; i < b.size(); ++i) {
+        EXPECT_EQ(0, static_cast<std::uint8_t*>(b.data())[i]);
+    }
+    static_cast<std::uint8_t*>(b.data())[0] = 42;
+
+    Block<void> r = allocator.reallocate(b, 4096).value();
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(4096, r.size());
+    EXPECT_EQ(42, static_cast<std::uint8_t*>(r.data())[0]);
+    EXPECT_TRUE(allocator.owns(r));
+    EXPECT_EQ(Allocator_error::invalid_size, allocator.reallocate(r, -1).error());
+    allocator.deallocate(r);
+
+    Block<void> a = allocator.allocate_aligned(100, 256).value();
+    EXPECT_EQ(100, a.size());
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(a.data()) % 256);
+    EXPECT_TRUE(allocator.owns(a));
+    allocator.deallocate(a);
+
+    EXPECT_EQ(Allocator_error::invalid_alignment, allocator.allocate_aligned(16, 3).error());
+}
+
+TEST(Allocator_traits_test, stack_allocator_expands_its_last_block)
+{
+    using namespace memoc;
+
+    Stack_allocator<details::Local_stack_memory<64>> allocator{};
+
+    Block<void> b1 = allocator.allocate(16).value();
+    Block<void> b2 = allocator.allocate(16).value();
+
+    EXPECT_FALSE(allocator.expand(b1, 16));
+    EXPECT_TRUE(allocator.expand(b2, 32));
+    EXPECT_EQ(48, b2.size());
+    EXPECT_FALSE(allocator.expand(b2, 2));
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(1).error());
+
+    EXPECT_TRUE(allocator.expand(b2, -40));
+    EXPECT_EQ(8, b2.size());
+    Block<void> b3 = allocator.allocate(40).value();
+    EXPECT_EQ(static_cast<std::uint8_t*>(b2.data()) + 8, b3.data());
+
+    allocator.deallocate(b3);
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    EXPECT_EQ(64, allocator.allocate(64).value().size());
+}
+
 // Allocators API tests
 
 class Any_allocator_test : public ::testing::Test {
 protected:
-    using Allocator = memoc::Malloc_allocator;
-    Allocator allocator_{ /*memoc::create<Allocator>()*/ };
+    using Allocator = memoc::Any_allocator;
+    Allocator allocator_{ memoc::Malloc_allocator{} };
 };
 
 TEST_F(Any_allocator_test, allocate_free_and_give_owning_indication_for_successfull_allocation)
@@ -733,3 +2607,60 @@ TEST_F(Any_allocator_test, returns_empty_non_owned_block_when_size_is_zero)
     EXPECT_TRUE(b.empty());
     EXPECT_FALSE(allocator_.owns(b));
 }
+
+TEST_F(Any_allocator_test, holds_allocators_of_any_size_and_exposes_their_type)
+{
+    using namespace memoc;
+
+    EXPECT_TRUE(allocator_.holds<Malloc_allocator>());
+    EXPECT_NE(nullptr, allocator_.target<Malloc_allocator>());
+    EXPECT_EQ(nullptr, allocator_.target<Null_allocator>());
+
+    // Larger than the inline storage
+    using Large = Lifetime_predicting_allocator<Malloc_allocator, Malloc_allocator, 16>;
+    static_assert(sizeof(Large) > Any_allocator::inline_size);
+    allocator_ = Any_allocator{ Large{} };
+    EXPECT_TRUE(allocator_.holds<Large>());
+
+    Block<void> b = allocator_.allocate(8).value();
+    EXPECT_TRUE(allocator_.owns(b));
+    EXPECT_EQ(Lifetime::persistent, allocator_.target<Large>()->predict(0));
+
+    Any_allocator copy{ allocator_ };
+    EXPECT_TRUE(copy.holds<Large>());
+    EXPECT_NE(allocator_.target<Large>(), copy.target<Large>());
+
+    Any_allocator moved{ std::move(allocator_) };
+    EXPECT_TRUE(moved.holds<Large>());
+    EXPECT_TRUE(allocator_.holds<Null_allocator>());
+    EXPECT_TRUE(allocator_.allocate(8).value().empty());
+
+    moved.deallocate(b);
+    EXPECT_TRUE(b.empty());
+
+    Any_allocator empty{};
+    EXPECT_TRUE(empty.holds<Null_allocator>());
+    static_assert(memoc::Allocator<Any_allocator>);
+}
+
+TEST_F(Any_allocator_test, selects_allocators_at_runtime)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<Static_arena<32, 1>>;
+    Any_allocator allocators[]{ Any_allocator{ Stack{} }, Any_allocator{ Malloc_allocator{} } };
+
+    Block<void> b1 = allocators[0].allocate(32).value();
+    EXPECT_EQ(Stack::id, b1.hint());
+    EXPECT_EQ(Allocator_error::out_of_memory, allocators[0].allocate(2).error());
+    Block<void> b2 = allocators[1].allocate(32).value();
+    EXPECT_EQ(Malloc_allocator::id, b2.hint());
+
+    std::swap(allocators[0], allocators[1]);
+    EXPECT_TRUE(allocators[1].owns(b1));
+    allocators[1].deallocate(b1);
+    allocators[0].deallocate(b2);
+    Block<void> b3 = allocators[1].allocate(32).value();
+    EXPECT_EQ(32, b3.size());
+    allocators[1].deallocate(b3);
+}
@@ -181,6 +181,39 @@ TEST(Allocated_buffer_test, is_copyable)
     EXPECT_EQ(buff2.size(), buff3.size());
 }
 
+TEST(Allocated_buffer_test, copy_assignment_reuses_or_resizes_memory_of_stateless_allocators)
+{
+    using namespace memoc;
+
+    const std::uint8_t data1[]{ 1, 2, 3, 4 };
+    const std::uint8_t data2[]{ 5, 6, 7, 8, 9, 10, 11, 12 };
+
+    Buffer<std::uint8_t, Malloc_allocator> buff1{ 4, data1 };
+    Buffer<std::uint8_t, Malloc_allocator> buff2{ 4 };
+    std::uint8_t* buff2_data = buff2.data();
+
+    buff2 = buff1;
+    EXPECT_EQ(buff2_data, buff2.data());
+    for (std::int64_t i = 0; i < buff2.size(); ++i) {
+        EXPECT_EQ(data1[i], buff2.data()[i]);
+    }
+
+    Buffer<std::uint8_t, Malloc_allocator> buff3{ 8, data2 };
+    buff2 = buff3;
+    EXPECT_EQ(8, buff2.size());
+    for (std::int64_t i = 0; i < buff2.size(); ++i) {
+        EXPECT_EQ(data2[i], buff2.data()[i]);
+    }
+
+    Buffer<void, Malloc_allocator> buff4{ 4, data1 };
+    Buffer<void, Malloc_allocator> buff5{ 8, data2 };
+    buff5 = buff4;
+    EXPECT_EQ(4, buff5.size());
+    for (std::int64_t i = 0; i < buff5.size(); ++i) {
+        EXPECT_EQ(data1[i], static_cast<std::uint8_t*>(buff5.data())[i]);
+    }
+}
+
 TEST(Allocated_buffer_test, is_moveable)
 {
     using namespace memoc;
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <fstream>
+
+#include <memoc/config.h>
+#include <memoc/allocators.h>
+
+// Allocator_config tests
+
+TEST(Allocator_config_test, parses_key_value_lines)
+{
+    using namespace memoc;
+
+    Allocator_config config = Allocator_config::parse(
+        "# free list\n"
+        "free_list_min_size = 16\n"
+        "  free_list_max_size=4k  \n"
+        "\n"
+        "allocator = malloc\n"
+        "free_list_min_size = 32\n").value();
+
+    EXPECT_EQ(32, config.get_int("free_list_min_size").value());
+    EXPECT_EQ(4096, config.get_int("free_list_max_size").value());
+    EXPECT_EQ("malloc", config.get("allocator").value());
+    EXPECT_EQ(Config_error::missing_key, config.get_int("stacks_count").error());
+    EXPECT_EQ(Config_error::invalid_value, config.get_int("allocator").error());
+    EXPECT_EQ(7, config.get_int("allocator", 7));
+    EXPECT_EQ(2, config.get_int("stacks_count", 2));
+
+    EXPECT_EQ(Config_error::invalid_syntax, Allocator_config::parse("free_list_min_size 16").error());
+    EXPECT_EQ(Config_error::invalid_syntax, Allocator_config::parse(" = 16").error());
+
+    EXPECT_EQ(std::int64_t{ 3 } << 20, Allocator_config::parse_int("3m").value());
+    EXPECT_EQ(std::int64_t{ 1 } << 30, Allocator_config::parse_int("1G").value());
+    EXPECT_EQ(Config_error::invalid_value, Allocator_config::parse_int("3x").error());
+    EXPECT_EQ(Config_error::invalid_value, Allocator_config::parse_int("9223372036854775807k").error());
+}
+
+TEST(Allocator_config_test, loads_files_and_environment_variables)
+{
+    using namespace memoc;
+
+    const std::string path = testing::TempDir() + "memoc_config_test.conf";
+    {
+        std::ofstream file(path);
+        file << "stack_buffer_size = 1k\nstacks_count = 2\n";
+    }
+    Allocator_config config = Allocator_config::from_file(path.c_str()).value();
+    std::remove(path.c_str());
+    EXPECT_EQ(1024, config.get_int("stack_buffer_size").value());
+
+    EXPECT_EQ(Config_error::unreadable_file, Allocator_config::from_file(path.c_str()).error());
+
+    setenv("MEMOC_TEST_STACKS_COUNT", "4", 1);
+    config.merge(Allocator_config::from_environment("MEMOC_TEST_"));
+    unsetenv("MEMOC_TEST_STACKS_COUNT");
+    EXPECT_EQ(4, config.get_int("stacks_count").value());
+    EXPECT_EQ(1024, config.get_int("stack_buffer_size").value());
+}
+
+// make_allocator tests
+
+TEST(Make_allocator_test, builds_allocators_from_specifications)
+{
+    using namespace memoc;
+
+    Allocator_config config = Allocator_config::parse(
+        "allocator = fallback(stack(1, $stack_buffer_size), free_list(16, 64, $max_list_size, malloc))\n"
+        "stack_buffer_size = 64\n"
+        "max_list_size = 8\n").value();
+
+    Any_allocator allocator = make_allocator(config).value();
+
+    Block<void> b1 = allocator.allocate(64).value();
+    Block<void> b2 = allocator.allocate(32).value();
+    EXPECT_TRUE(allocator.owns(b1));
+    EXPECT_TRUE(allocator.owns(b2));
+    void* p2 = b2.data();
+    allocator.deallocate(b2);
+
+    // The listed block is reused
+    Block<void> b3 = allocator.allocate(48).value();
+    EXPECT_EQ(p2, b3.data());
+    allocator.deallocate(b3);
+    allocator.deallocate(b1);
+
+    Any_allocator synchronized = make_allocator(" synchronized ( mmap ) ").value();
+    Block<void> b4 = synchronized.allocate(100).value();
+    EXPECT_TRUE(synchronized.owns(b4));
+    synchronized.deallocate(b4);
+
+    EXPECT_EQ(Config_error::unknown_allocator, make_allocator("jemalloc").error());
+    EXPECT_EQ(Config_error::invalid_syntax, make_allocator("fallback(malloc)").error());
+    EXPECT_EQ(Config_error::invalid_syntax, make_allocator("malloc malloc").error());
+    EXPECT_EQ(Config_error::invalid_value, make_allocator("stack(1, 3)").error());
+    EXPECT_EQ(Config_error::invalid_value, make_allocator("free_list(16, 8, 2, malloc)").error());
+    EXPECT_EQ(Config_error::missing_key, make_allocator("stack(1, $stack_buffer_size)").error());
+    EXPECT_EQ(Config_error::missing_key, make_allocator(Allocator_config{}).error());
+}
+
+TEST(Make_allocator_test, composes_leaf_allocators_without_type_erasure)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<Runtime_stack_memory>;
+
+    Any_allocator free_list = make_allocator("free_list(16, 64, 8, malloc)").value();
+    EXPECT_NE(nullptr, free_list.target<Runtime_free_list_allocator<Malloc_allocator>>());
+
+    Any_allocator fallback = make_allocator("fallback(stack(1, 64), mmap)").value();
+    EXPECT_NE(nullptr, (fallback.target<Fallback_allocator<Stack, Mmap_allocator>>()));
+
+    Any_allocator synchronized = make_allocator("synchronized(stack(1, 64))").value();
+    EXPECT_NE(nullptr, synchronized.target<Synchronized_allocator<Stack>>());
+
+    // Composite internal allocators are held by an Any_allocator
+    Any_allocator nested = make_allocator("fallback(stack(1, 64), free_list(16, 64, 8, malloc))").value();
+    const auto* f = nested.target<Fallback_allocator<Stack, Any_allocator>>();
+    ASSERT_NE(nullptr, f);
+    Block<void> b = nested.allocate(128).value();
+    EXPECT_TRUE(nested.owns(b));
+    nested.deallocate(b);
+}
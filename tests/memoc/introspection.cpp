@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+#include <memoc/introspection.h>
+#include <memoc/allocators.h>
+#include <memoc/blocks.h>
+
+// Allocator introspection tests
+
+namespace {
+    struct Opaque_allocator {
+        [[nodiscard]] oc::Expected<memoc::Block<void>, memoc::Allocator_error> allocate(memoc::Block<void>::Size_type s) noexcept
+        {
+            return memoc::Malloc_allocator{}.allocate(s);
+        }
+
+        void deallocate(memoc::Block<void>& b) noexcept
+        {
+            memoc::Malloc_allocator{}.deallocate(b);
+        }
+
+        [[nodiscard]] bool owns(const memoc::Block<void>& b) const noexcept
+        {
+            return memoc::Malloc_allocator{}.owns(b);
+        }
+    };
+}
+
+TEST(Allocator_introspection_test, describes_the_usage_of_each_layer)
+{
+    using namespace memoc;
+
+    using Free_list = Free_list_allocator<Shared_allocator<Malloc_allocator>, 16, 64, 4>;
+    Fallback_allocator<Stack_allocator<details::Local_stack_memory<64>>, Free_list> allocator{};
+
+    Block<void> b1 = allocator.allocate(32).value();
+    Block<void> b2 = allocator.allocate(48).value();
+    Block<void> b3 = allocator.allocate(40).value();
+    allocator.deallocate(b3);
+
+    Allocator_info info = describe(allocator);
+    EXPECT_EQ("", info.role);
+    EXPECT_EQ("Fallback_allocator", info.type);
+    EXPECT_EQ(-1, info.usage.bytes_in_use);
+    ASSERT_EQ(2, info.children.size());
+
+    const Allocator_info& primary = info.children[0];
+    EXPECT_EQ("primary", primary.role);
+    EXPECT_EQ("Stack_allocator", primary.type);
+    EXPECT_EQ(32, primary.usage.bytes_in_use);
+
+    const Allocator_info& fallback = info.children[1];
+    EXPECT_EQ("fallback", fallback.role);
+    EXPECT_EQ("Free_list_allocator", fallback.type);
+    ASSERT_EQ(3, fallback.parameters.size());
+    EXPECT_EQ("max_size", fallback.parameters[1].first);
+    EXPECT_EQ(64, fallback.parameters[1].second);
+    EXPECT_EQ(64, fallback.usage.bytes_cached);
+    EXPECT_EQ(1, fallback.usage.blocks_cached);
+    ASSERT_EQ(1, fallback.children.size());
+    EXPECT_EQ("Shared_allocator", fallback.children[0].type);
+    EXPECT_EQ("Malloc_allocator", fallback.children[0].children[0].type);
+
+    EXPECT_EQ(
+        "Fallback_allocator\n"
+        "  primary: Stack_allocator capacity=64 bytes_in_use=32\n"
+        "  fallback: Free_list_allocator min_size=16 max_size=64 max_list_size=4 bytes_cached=64 blocks_cached=1\n"
+        "    internal: Shared_allocator id=-1\n"
+        "      internal: Malloc_allocator\n",
+        to_text(info));
+
+    EXPECT_EQ(
+        "{\"role\":\"\",\"type\":\"Fallback_allocator\",\"parameters\":{},\"usage\":{},\"children\":["
+        "{\"role\":\"primary\",\"type\":\"Stack_allocator\",\"parameters\":{\"capacity\":64},\"usage\":{\"bytes_in_use\":32},\"children\":[]},"
+        "{\"role\":\"fallback\",\"type\":\"Free_list_allocator\",\"parameters\":{\"min_size\":16,\"max_size\":64,\"max_list_size\":4},"
+        "\"usage\":{\"bytes_cached\":64,\"blocks_cached\":1},\"children\":["
+        "{\"role\":\"internal\",\"type\":\"Shared_allocator\",\"parameters\":{\"id\":-1},\"usage\":{},\"children\":["
+        "{\"role\":\"internal\",\"type\":\"Malloc_allocator\",\"parameters\":{},\"usage\":{},\"children\":[]}]}]}]}",
+        to_json(info));
+
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    EXPECT_EQ(0, describe(allocator).children[0].usage.bytes_in_use);
+}
+
+TEST(Allocator_introspection_test, describes_held_and_unknown_allocators)
+{
+    using namespace memoc;
+
+    Any_allocator any{ Monotonic_allocator<Opaque_allocator, 1024>{} };
+    Block<void> b = any.allocate(100).value();
+
+    Allocator_info info = describe(any);
+    EXPECT_EQ("Any_allocator", info.type);
+    ASSERT_EQ(1, info.children.size());
+
+    const Allocator_info& monotonic = info.children[0];
+    EXPECT_EQ("target", monotonic.role);
+    EXPECT_EQ("Monotonic_allocator", monotonic.type);
+    EXPECT_EQ(112, monotonic.usage.bytes_in_use);
+    EXPECT_EQ(1024, monotonic.usage.bytes_in_use + monotonic.usage.bytes_cached + monotonic.usage.bytes_overhead);
+    ASSERT_EQ(1, monotonic.children.size());
+    EXPECT_EQ("unknown", monotonic.children[0].type);
+    EXPECT_TRUE(monotonic.children[0].children.empty());
+
+    any.deallocate(b);
+}
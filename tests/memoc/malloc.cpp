@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <memoc/malloc.h>
+#include <memoc/allocators.h>
+
+// Malloc_interface tests
+
+class Malloc_interface_test : public ::testing::Test {
+protected:
+    using Allocator = memoc::Segregator<128, memoc::Bucketizer<memoc::Malloc_allocator, 16, 128, 4>, memoc::Malloc_allocator>;
+    memoc::Malloc_interface<Allocator> interface_{};
+};
+
+TEST_F(Malloc_interface_test, allocates_and_frees_blocks)
+{
+    void* p = interface_.malloc(10);
+    EXPECT_NE(nullptr, p);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p) % alignof(std::max_align_t));
+    // The block of 10 bytes and the header are served by the 32 bytes class
+    EXPECT_EQ(16, interface_.usable_size(p));
+    std::memset(p, 1, interface_.usable_size(p));
+    interface_.free(p);
+
+    void* z = interface_.malloc(0);
+    EXPECT_NE(nullptr, z);
+    interface_.free(z);
+
+    interface_.free(nullptr);
+    EXPECT_EQ(0, interface_.usable_size(nullptr));
+}
+
+TEST_F(Malloc_interface_test, allocates_zeroed_blocks)
+{
+    void* p = interface_.malloc(64);
+    std::memset(p, 1, 64);
+    interface_.free(p);
+
+    std::uint8_t* z = static_cast<std::uint8_t*>(interface_.calloc(8, 8));
+    for (std::size_t i = 0; i < 64; ++i) {
+        EXPECT_EQ(0, z[i]);
+    }
+    interface_.free(z);
+
+    EXPECT_EQ(nullptr, interface_.calloc(std::numeric_limits<std::size_t>::max(), 2));
+}
+
+TEST_F(Malloc_interface_test, allocates_aligned_blocks)
+{
+    void* p1 = interface_.aligned_alloc(64, 10);
+    void* p2 = interface_.aligned_alloc(4096, 200);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p1) % 64);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p2) % 4096);
+    EXPECT_GE(interface_.usable_size(p1), 10);
+    EXPECT_GE(interface_.usable_size(p2), 200);
+    interface_.free(p2);
+    interface_.free(p1);
+
+    EXPECT_EQ(nullptr, interface_.aligned_alloc(3, 10));
+}
+
+TEST_F(Malloc_interface_test, reallocates_blocks_in_place_if_possible)
+{
+    char* p = static_cast<char*>(interface_.malloc(20));
+    std::strcpy(p, "0123456789");
+
+    char* p1 = static_cast<char*>(interface_.realloc(p, 40));
+    EXPECT_EQ(p, p1);
+
+    char* p2 = static_cast<char*>(interface_.realloc(p1, 1000));
+    EXPECT_STREQ("0123456789", p2);
+    EXPECT_GE(interface_.usable_size(p2), 1000);
+
+    EXPECT_EQ(nullptr, interface_.realloc(p2, 0));
+
+    void* p3 = interface_.realloc(nullptr, 10);
+    EXPECT_NE(nullptr, p3);
+    interface_.free(p3);
+}
+
+// malloc replacement library tests
+
+TEST(Malloc_library_test, runs_unmodified_programs_when_preloaded)
+{
+#if defined(MEMOC_MALLOC_LIBRARY)
+    // The preloaded library serves the allocations of the shell and of the commands it runs
+    const std::string command = std::string("LD_PRELOAD=") + MEMOC_MALLOC_LIBRARY +
+        " sh -c 'seq 1 100000 | sort -r | head -n 1; grep -c memoc_malloc /proc/self/maps'";
+    FILE* f = popen(command.c_str(), "r");
+    ASSERT_NE(nullptr, f);
+
+    char max[32]{};
+    char maps[32]{};
+    EXPECT_NE(nullptr, std::fgets(max, sizeof(max), f));
+    EXPECT_NE(nullptr, std::fgets(maps, sizeof(maps), f));
+    EXPECT_EQ(0, pclose(f));
+
+    EXPECT_STREQ("99999\n", max);
+    EXPECT_GT(std::stoi(maps), 0);
+#else
+    GTEST_SKIP() << "The malloc library is not built";
+#endif
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <memoc/metrics.h>
+#include <memoc/allocators.h>
+#include <memoc/blocks.h>
+
+// Metrics_allocator tests
+
+TEST(Metrics_allocator_test, publishes_allocation_metrics)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    using Free_list = Free_list_allocator<Malloc_allocator, 16, 64, 4>;
+    Metrics_allocator<Free_list> allocator{ "pool", &registry };
+    ASSERT_NE(nullptr, allocator.metrics());
+
+    Block<void> b1 = allocator.allocate(32).value();
+    Block<void> b2 = allocator.allocate(100).value();
+    allocator.deallocate(b2);
+    EXPECT_FALSE(allocator.allocate(-1));
+
+    const Allocator_metrics& m = *allocator.metrics();
+    EXPECT_STREQ("pool", m.name);
+    EXPECT_EQ(32, m.bytes_in_use);
+    EXPECT_EQ(132, m.peak_bytes);
+    EXPECT_EQ(2, m.allocations);
+    EXPECT_EQ(1, m.deallocations);
+    EXPECT_EQ(1, m.failures);
+
+    allocator.deallocate(b1);
+    EXPECT_EQ(0, m.bytes_cached);
+    allocator.refresh_cache_metrics();
+    EXPECT_EQ(64, m.bytes_cached);
+    EXPECT_EQ(1, m.blocks_cached);
+
+    {
+        Metrics_allocator<Free_list> copy{ allocator };
+        Block<void> b = copy.allocate(16).value();
+        EXPECT_EQ(16, m.bytes_in_use);
+        copy.deallocate(b);
+    }
+    std::int64_t registered = 0;
+    registry.for_each([&](const Allocator_metrics&) { ++registered; });
+    EXPECT_EQ(1, registered);
+}
+
+TEST(Metrics_allocator_test, unregisters_and_reuses_metrics)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    const Allocator_metrics* first = nullptr;
+    {
+        Metrics_allocator<Malloc_allocator> allocator{ "first", &registry };
+        first = allocator.metrics();
+        Block<void> b = allocator.allocate(8).value();
+        allocator.deallocate(b);
+    }
+    EXPECT_EQ(std::string::npos, to_prometheus(registry).find("first"));
+
+    Metrics_allocator<Malloc_allocator> allocator{ "second", &registry };
+    EXPECT_EQ(first, allocator.metrics());
+    EXPECT_STREQ("second", allocator.metrics()->name);
+    EXPECT_EQ(0, allocator.metrics()->allocations);
+
+    Metrics_allocator<Malloc_allocator> unregistered{};
+    EXPECT_EQ(nullptr, unregistered.metrics());
+    Block<void> b = unregistered.allocate(8).value();
+    unregistered.deallocate(b);
+}
+
+TEST(Metrics_allocator_test, counts_allocations_of_all_threads)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    Metrics_allocator<Malloc_allocator> allocator{ "shared", &registry };
+
+    std::vector<std::thread> threads{};
+    for (std::int64_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            for (std::int64_t j = 0; j < 1000; ++j) {
+                Block<void> b = allocator.allocate(16).value();
+                allocator.deallocate(b);
+            }
+        });
+    }
+    for (std::int64_t i = 0; i < 100; ++i) {
+        EXPECT_FALSE(to_prometheus(registry).empty());
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(4000, allocator.metrics()->allocations);
+    EXPECT_EQ(4000, allocator.metrics()->deallocations);
+    EXPECT_EQ(0, allocator.metrics()->bytes_in_use);
+    EXPECT_LE(16, allocator.metrics()->peak_bytes);
+    EXPECT_GE(64, allocator.metrics()->peak_bytes);
+}
+
+TEST(Metrics_allocator_test, collects_names_of_metrics_reused_concurrently)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    const std::string names[2] = { std::string(Allocator_metrics::max_name_size, 'a'), std::string(Allocator_metrics::max_name_size, 'b') };
+
+    std::atomic<bool> done{ false };
+    std::thread t([&]() {
+        for (std::int64_t i = 0; !done.load(); ++i) {
+            Metrics_allocator<Malloc_allocator> allocator{ names[i % 2], &registry };
+        }
+    });
+    for (std::int64_t i = 0; i < 1000; ++i) {
+        registry.for_each([&](const Allocator_metrics& m) {
+            EXPECT_TRUE(m.name == names[0] || m.name == names[1]);
+        });
+    }
+    done.store(true);
+    t.join();
+}
+
+TEST(Metrics_allocator_test, forwards_the_call_site_to_its_internal_allocator)
+{
+    using namespace memoc;
+
+    using Sites = Site_stats_allocator<Malloc_allocator, 4, 1>;
+    Sites::reset();
+
+    Metrics_registry registry{};
+    Metrics_allocator<Sites> allocator{ "sites", &registry };
+    Block<void> b = allocator.allocate(8).value();
+    allocator.deallocate(b);
+
+    Sites::Site site{};
+    ASSERT_EQ(1, Sites::top(&site, 1));
+    EXPECT_EQ(__LINE__ - 5, static_cast<int>(site.location.line()));
+    EXPECT_STREQ(__FILE__, site.location.file_name());
+
+    Sites::reset();
+}
+
+// Metrics export tests
+
+TEST(Metrics_export_test, renders_prometheus_text_format)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    Metrics_allocator<Malloc_allocator> allocator{ "say \"hi\"", &registry };
+    Block<void> b = allocator.allocate(10).value();
+
+    const std::string text = to_prometheus(registry);
+    EXPECT_EQ(0, text.find(
+        "# HELP memoc_bytes_in_use Bytes allocated and not deallocated.\n"
+        "# TYPE memoc_bytes_in_use gauge\n"
+        "memoc_bytes_in_use{allocator=\"say \\\"hi\\\"\"} 10\n"
+        "# HELP memoc_peak_bytes Highest bytes in use.\n"));
+    EXPECT_NE(std::string::npos, text.find(
+        "# TYPE memoc_allocations_total counter\n"
+        "memoc_allocations_total{allocator=\"say \\\"hi\\\"\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("memoc_blocks_cached{allocator=\"say \\\"hi\\\"\"} 0\n"));
+
+    const std::string path = ::testing::TempDir() + "memoc_metrics.prom";
+    ASSERT_TRUE(write_prometheus(path.c_str(), registry));
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(nullptr, file);
+    std::string written(text.size() + 1, '\0');
+    written.resize(std::fread(written.data(), 1, written.size(), file));
+    std::fclose(file);
+    std::remove(path.c_str());
+    EXPECT_EQ(text, written);
+
+    EXPECT_FALSE(write_prometheus("/nonexistent/memoc_metrics.prom", registry));
+
+    allocator.deallocate(b);
+}
+
+TEST(Metrics_export_test, renders_openmetrics_text_format)
+{
+    using namespace memoc;
+
+    Metrics_registry registry{};
+    Metrics_allocator<Malloc_allocator> allocator{ "pool", &registry };
+    Block<void> b = allocator.allocate(10).value();
+
+    const std::string text = to_openmetrics(registry);
+    EXPECT_EQ(0, text.find(
+        "# HELP memoc_bytes_in_use Bytes allocated and not deallocated.\n"
+        "# TYPE memoc_bytes_in_use gauge\n"
+        "memoc_bytes_in_use{allocator=\"pool\"} 10\n"));
+    EXPECT_NE(std::string::npos, text.find(
+        "# HELP memoc_allocations Successful allocations of non empty blocks.\n"
+        "# TYPE memoc_allocations counter\n"
+        "memoc_allocations_total{allocator=\"pool\"} 1\n"));
+    EXPECT_EQ(std::string::npos, text.find("# TYPE memoc_allocations_total"));
+    EXPECT_EQ(text.size() - 6, text.find("# EOF\n"));
+
+    allocator.deallocate(b);
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
 #include <utility>
+#include <thread>
+#include <vector>
 
 #include <memoc/pointers.h>
 #include <memoc/allocators.h>
@@ -657,6 +659,43 @@ TEST(LW_Shared_ptr, from_Unique_ptr)
 
 
 
+TEST(LW_Shared_ptr, stateless_allocator_takes_no_space)
+{
+    using namespace memoc;
+
+    static_assert(Allocator_traits<Malloc_allocator>::is_stateless);
+    EXPECT_EQ(2 * sizeof(void*), sizeof(Shared_ptr<int, Malloc_allocator>));
+    EXPECT_EQ(sizeof(void*), sizeof(Unique_ptr<int, Malloc_allocator>));
+}
+
+TEST(LW_Shared_ptr, counts_references_atomically_for_thread_safe_allocators)
+{
+    using namespace memoc;
+
+    static_assert(Allocator_traits<Malloc_allocator>::is_thread_safe);
+    Shared_ptr<int> sp = make_shared<int>(100);
+    Weak_ptr<int> wp{ sp };
+
+    std::vector<std::thread> threads{};
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&sp, &wp]() {
+            for (int j = 0; j < 10000; ++j) {
+                Shared_ptr<int> copy{ sp };
+                Shared_ptr<int> locked{ wp.lock() };
+                Weak_ptr<int> weak{ copy };
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(1, sp.use_count());
+
+    sp.reset();
+    EXPECT_TRUE(wp.expired());
+    EXPECT_FALSE(wp.lock());
+}
+
 TEST(LW_Weak_ptr, construction)
 {
     using namespace memoc;
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include <memoc/pools.h>
+#include <memoc/buffers.h>
+#include <memoc/allocators.h>
+
+// Object_pool tests
+
+namespace {
+    struct Parser {
+        Parser(std::int64_t capacity = 64)
+            : scratch(capacity) {}
+
+        void reset()
+        {
+            ++resets;
+            position = 0;
+        }
+
+        memoc::Buffer<std::uint8_t> scratch;
+        std::int64_t position{ 0 };
+        std::int64_t resets{ 0 };
+    };
+
+    struct Counted {
+        Counted() { ++constructions; }
+        ~Counted() { ++destructions; }
+
+        inline static std::int64_t constructions{ 0 };
+        inline static std::int64_t destructions{ 0 };
+    };
+
+    struct Threaded {
+        std::int64_t value{ 0 };
+    };
+}
+
+TEST(Object_pool_test, recycles_reset_objects_and_keeps_their_buffers)
+{
+    using namespace memoc;
+
+    Object_pool<Parser> pool{};
+
+    std::uint8_t* scratch_data{ nullptr };
+    Parser* address{ nullptr };
+    {
+        Object_pool<Parser>::Handle p = pool.acquire(128);
+        EXPECT_TRUE(p);
+        EXPECT_EQ(128, p->scratch.size());
+        p->position = 10;
+        scratch_data = p->scratch.data();
+        address = p.get();
+    }
+    EXPECT_EQ(1, pool.created());
+
+    Object_pool<Parser>::Handle p = pool.acquire();
+    EXPECT_EQ(address, p.get());
+    EXPECT_EQ(1, p->resets);
+    EXPECT_EQ(0, p->position);
+    EXPECT_EQ(128, p->scratch.size());
+    EXPECT_EQ(scratch_data, p->scratch.data());
+    EXPECT_EQ(1, pool.created());
+
+    Object_pool<Parser>::Handle moved{ std::move(p) };
+    EXPECT_FALSE(p);
+    EXPECT_EQ(address, moved.get());
+
+    moved.reset();
+    EXPECT_FALSE(moved);
+}
+
+TEST(Object_pool_test, destroys_objects_beyond_max_idle)
+{
+    using namespace memoc;
+
+    Counted::constructions = Counted::destructions = 0;
+    {
+        Object_pool<Counted, Malloc_allocator, 2, 0> pool{};
+        {
+            auto h1 = pool.acquire();
+            auto h2 = pool.acquire();
+            auto h3 = pool.acquire();
+            EXPECT_EQ(3, pool.created());
+        }
+        EXPECT_EQ(2, pool.idle_count());
+        EXPECT_EQ(3, Counted::constructions);
+        EXPECT_EQ(1, Counted::destructions);
+
+        auto h4 = pool.acquire();
+        EXPECT_EQ(1, pool.idle_count());
+        EXPECT_EQ(3, pool.created());
+    }
+    EXPECT_EQ(3, Counted::destructions);
+}
+
+TEST(Object_pool_test, objects_released_by_other_threads_return_to_the_pool)
+{
+    using namespace memoc;
+
+    Object_pool<Threaded, Malloc_allocator, 4, 1> pool{};
+
+    Object_pool<Threaded, Malloc_allocator, 4, 1>::Handle h1 = pool.acquire();
+    Object_pool<Threaded, Malloc_allocator, 4, 1>::Handle h2 = pool.acquire();
+    Threaded* a1 = h1.get();
+    Threaded* a2 = h2.get();
+
+    std::thread t([&]() {
+        // The first object is cached by the releasing thread and returned to the pool when the thread exits
+        h1.reset();
+        h2.reset();
+    });
+    t.join();
+
+    EXPECT_EQ(2, pool.idle_count());
+    auto h3 = pool.acquire();
+    EXPECT_EQ(a1, h3.get());
+    auto h4 = pool.acquire();
+    EXPECT_EQ(a2, h4.get());
+    EXPECT_EQ(2, pool.created());
+}
+
+TEST(Object_pool_test, pools_of_the_same_type_do_not_share_cached_objects)
+{
+    using namespace memoc;
+
+    Object_pool<Threaded, Malloc_allocator, 0, 4> pool1{};
+    Object_pool<Threaded, Malloc_allocator, 0, 4> pool2{};
+
+    Threaded* address{ nullptr };
+    {
+        auto h = pool1.acquire();
+        address = h.get();
+    }
+
+    auto h2 = pool2.acquire();
+    EXPECT_NE(address, h2.get());
+    EXPECT_EQ(1, pool2.created());
+
+    auto h1 = pool1.acquire();
+    EXPECT_EQ(address, h1.get());
+    EXPECT_EQ(1, pool1.created());
+}
+
+TEST(Object_pool_test, destroys_objects_cached_by_running_threads_with_its_allocator)
+{
+    using namespace memoc;
+
+    Memory_budget budget{ 1024 };
+    std::atomic<int> step{ 0 };
+    std::thread t;
+    {
+        Object_pool<Threaded, Budget_allocator<Malloc_allocator>, 0, 4> pool{ Budget_allocator<Malloc_allocator>{ budget } };
+        auto h1 = pool.acquire();
+        auto h2 = pool.acquire();
+        EXPECT_LT(0, budget.in_use());
+
+        t = std::thread([&]() {
+            // Cached by this thread, which is still running when the pool is destructed
+            h1.reset();
+            step = 1;
+            while (step != 2) {
+                std::this_thread::yield();
+            }
+        });
+        while (step != 1) {
+            std::this_thread::yield();
+        }
+        h2.reset();
+    }
+    EXPECT_EQ(0, budget.in_use());
+    step = 2;
+    t.join();
+    EXPECT_EQ(0, budget.in_use());
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory_resource>
+
+#include <memoc/resources.h>
+#include <memoc/allocators.h>
+#include <memoc/buffers.h>
+
+// Memory_resource_adapter tests
+
+TEST(Memory_resource_adapter_test, serves_pmr_containers)
+{
+    using namespace memoc;
+
+    Memory_resource_adapter<Free_list_allocator<Malloc_allocator, 16, 64, 8>> resource{};
+
+    std::pmr::vector<std::pmr::string> v{ &resource };
+    for (int i = 0; i < 64; ++i) {
+        v.emplace_back(std::to_string(i) + " is a string long enough to be allocated");
+    }
+    for (int i = 0; i < 64; ++i) {
+        EXPECT_EQ(std::to_string(i) + " is a string long enough to be allocated", std::string(v[i]));
+    }
+    EXPECT_EQ(&resource, v.get_allocator().resource());
+    EXPECT_EQ(&resource, v[0].get_allocator().resource());
+}
+
+TEST(Memory_resource_adapter_test, aligns_allocations_above_the_allocator_alignment)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Local_stack_memory<256>>;
+    Memory_resource_adapter<Stack> resource{};
+
+    void* p1 = resource.allocate(10, 64);
+    void* p2 = resource.allocate(3, 32);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p1) % 64);
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p2) % 32);
+    EXPECT_TRUE(resource.allocator().owns(Block<void>{ 10, p1 }));
+
+    resource.deallocate(p2, 3, 32);
+    resource.deallocate(p1, 10, 64);
+
+    // All the stack memory is available again
+    Block<void> b = resource.allocator().allocate(256).value();
+    resource.allocator().deallocate(b);
+
+    EXPECT_THROW(static_cast<void>(resource.allocate(512, 2)), std::bad_alloc);
+}
+
+TEST(Memory_resource_adapter_test, deallocates_blocks_with_their_hints)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Local_stack_memory<256>>;
+    using Chain = Fallback_chain<Malloc_allocator, Stack>;
+    Memory_resource_adapter<Chain> resource{};
+
+    // Malloc's blocks are dispatched by their hint and do not reach the stack
+    for (int i = 0; i < 8; ++i) {
+        void* p1 = resource.allocate(24, 1);
+        void* p2 = resource.allocate(100, 64);
+        EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p2) % 64);
+        resource.deallocate(p1, 24, 1);
+        resource.deallocate(p2, 100, 64);
+    }
+    EXPECT_EQ(16, resource.allocator().hits<0>());
+}
+
+TEST(Memory_resource_adapter_test, pads_small_alignments_by_their_offset_only)
+{
+    using namespace memoc;
+
+    using Stack = Stack_allocator<details::Local_stack_memory<256>>;
+    Memory_resource_adapter<Stack> resource{};
+
+    void* ps[16]{};
+    for (void*& p : ps) {
+        p = resource.allocate(10, 2);
+        EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(p) % 2);
+    }
+    for (int i = 15; i >= 0; --i) {
+        resource.deallocate(ps[i], 10, 2);
+    }
+
+    Block<void> b = resource.allocator().allocate(256).value();
+    resource.allocator().deallocate(b);
+}
+
+TEST(Memory_resource_adapter_test, is_equal_to_resources_of_stateless_allocators_of_the_same_type)
+{
+    using namespace memoc;
+
+    Memory_resource_adapter<Malloc_allocator> r1{};
+    Memory_resource_adapter<Malloc_allocator> r2{};
+    Memory_resource_adapter<Free_list_allocator<Malloc_allocator, 16, 64, 8>> r3{};
+    Memory_resource_adapter<Free_list_allocator<Malloc_allocator, 16, 64, 8>> r4{};
+
+    EXPECT_TRUE(r1.is_equal(r2));
+    EXPECT_FALSE(r1.is_equal(r3));
+    EXPECT_TRUE(r3.is_equal(r3));
+    EXPECT_FALSE(r3.is_equal(r4));
+}
+
+// Memory_resource_allocator tests
+
+TEST(Memory_resource_allocator_test, allocates_from_a_memory_resource)
+{
+    using namespace memoc;
+
+    std::uint8_t memory[256]{};
+    std::pmr::monotonic_buffer_resource resource{ memory, sizeof(memory), std::pmr::null_memory_resource() };
+    Memory_resource_allocator allocator{ &resource };
+
+    Block<void> b = allocator.allocate(64).value();
+    EXPECT_GE(static_cast<std::uint8_t*>(b.data()), memory);
+    EXPECT_LT(static_cast<std::uint8_t*>(b.data()), memory + sizeof(memory));
+    EXPECT_TRUE(allocator.owns(b));
+    EXPECT_FALSE(Memory_resource_allocator{}.owns(b));
+
+    EXPECT_EQ(Allocator_error::out_of_memory, allocator.allocate(512).error());
+    EXPECT_EQ(Allocator_error::invalid_size, allocator.allocate(-1).error());
+    EXPECT_TRUE(allocator.allocate(0).value().empty());
+
+    allocator.deallocate(b);
+    EXPECT_TRUE(b.empty());
+
+    static_assert(Allocator<Memory_resource_allocator>);
+    EXPECT_EQ(std::pmr::get_default_resource(), Memory_resource_allocator{}.resource());
+}
+
+TEST(Memory_resource_allocator_test, serves_as_the_last_member_of_a_fallback_chain)
+{
+    using namespace memoc;
+
+    Fallback_chain<Stack_allocator<Static_arena<16, 2>>, Memory_resource_allocator> allocator{};
+
+    Buffer<std::int64_t, Fallback_chain<Stack_allocator<Static_arena<16, 2>>, Memory_resource_allocator>> buffer{ 16 };
+    EXPECT_EQ(16, buffer.size());
+
+    Block<void> b1 = allocator.allocate(16).value();
+    Block<void> b2 = allocator.allocate(16).value();
+    EXPECT_TRUE(allocator.get<0>().owns(b1));
+    EXPECT_TRUE(allocator.get<1>().owns(b2));
+
+    allocator.deallocate(b2);
+    allocator.deallocate(b1);
+    EXPECT_EQ(1, allocator.hits<0>());
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <memoc/slot_maps.h>
+#include <memoc/allocators.h>
+#include <memoc/blocks.h>
+
+// Slot_map tests
+
+TEST(Slot_map_test, is_empty_when_initialized)
+{
+    using namespace memoc;
+
+    Slot_map<int> m{};
+
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(0, m.size());
+    EXPECT_TRUE(m.block().empty());
+    EXPECT_FALSE(m.contains(Slot_map<int>::Handle{}));
+    EXPECT_EQ(nullptr, m.get(Slot_map<int>::Handle{}));
+}
+
+TEST(Slot_map_test, inserts_and_finds_values_by_handle)
+{
+    using namespace memoc;
+
+    Slot_map<int> m{};
+
+    std::vector<Slot_map<int>::Handle> handles{};
+    for (int i = 0; i < 100; ++i) {
+        handles.push_back(m.insert(i));
+    }
+
+    EXPECT_EQ(100, m.size());
+    EXPECT_GE(m.capacity(), 100);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(m.contains(handles[i]));
+        EXPECT_EQ(i, *m.get(handles[i]));
+    }
+}
+
+TEST(Slot_map_test, inserts_its_own_values_when_growing)
+{
+    using namespace memoc;
+
+    Slot_map<std::string> m{};
+    const std::string value(64, 'a');
+    Slot_map<std::string>::Handle h = m.insert(value);
+    while (m.size() < m.capacity()) {
+        m.insert(std::string(64, 'b'));
+    }
+
+    Slot_map<std::string>::Handle copied = m.insert(*m.get(h));
+    EXPECT_EQ(value, *m.get(copied));
+    while (m.size() < m.capacity()) {
+        m.insert(std::string(64, 'b'));
+    }
+
+    Slot_map<std::string>::Handle moved = m.insert(std::move(*m.get(h)));
+    EXPECT_EQ(value, *m.get(moved));
+    EXPECT_EQ(value, *m.get(copied));
+}
+
+TEST(Slot_map_test, erase_keeps_values_dense_and_other_handles_valid)
+{
+    using namespace memoc;
+
+    Slot_map<std::string> m{};
+
+    Slot_map<std::string>::Handle h1 = m.insert(std::string("first"));
+    Slot_map<std::string>::Handle h2 = m.insert(std::string("second"));
+    Slot_map<std::string>::Handle h3 = m.insert(std::string("third"));
+
+    EXPECT_TRUE(m.erase(h1));
+    EXPECT_FALSE(m.erase(h1));
+    EXPECT_EQ(2, m.size());
+
+    // The last value was moved into the erased position
+    Block<std::string> b = m.block();
+    EXPECT_EQ(2, b.size());
+    EXPECT_EQ("third", b[0]);
+    EXPECT_EQ("second", b[1]);
+    EXPECT_EQ(h3, m.handle_at(0));
+    EXPECT_EQ(h2, m.handle_at(1));
+
+    EXPECT_EQ("second", *m.get(h2));
+    EXPECT_EQ("third", *m.get(h3));
+
+    std::int64_t count{ 0 };
+    for (const std::string& s : m) {
+        EXPECT_FALSE(s.empty());
+        ++count;
+    }
+    EXPECT_EQ(2, count);
+}
+
+TEST(Slot_map_test, detects_stale_handles_when_slots_are_reused)
+{
+    using namespace memoc;
+
+    Slot_map<int> m{};
+
+    Slot_map<int>::Handle h1 = m.insert(1);
+    EXPECT_TRUE(m.erase(h1));
+
+    Slot_map<int>::Handle h2 = m.insert(2);
+    EXPECT_EQ(h1.index, h2.index);
+    EXPECT_NE(h1.generation, h2.generation);
+
+    EXPECT_FALSE(m.contains(h1));
+    EXPECT_EQ(nullptr, m.get(h1));
+    EXPECT_EQ(2, *m.get(h2));
+
+    m.clear();
+    EXPECT_TRUE(m.empty());
+    EXPECT_FALSE(m.contains(h2));
+}
+
+TEST(Slot_map_test, is_copyable_and_moveable)
+{
+    using namespace memoc;
+
+    Slot_map<int> m1{};
+    Slot_map<int>::Handle h = m1.insert(7);
+
+    Slot_map<int> m2{ m1 };
+    EXPECT_EQ(7, *m2.get(h));
+    EXPECT_NE(m1.data(), m2.data());
+
+    Slot_map<int> m3{ std::move(m1) };
+    EXPECT_EQ(7, *m3.get(h));
+}
+
+TEST(Slot_map_test, copies_non_trivial_values)
+{
+    using namespace memoc;
+
+    const std::string value(100, 'x');
+    Slot_map<std::string> m1{};
+    Slot_map<std::string>::Handle h = m1.insert(value);
+
+    Slot_map<std::string> m2{ m1 };
+    EXPECT_EQ(value, *m2.get(h));
+
+    Slot_map<std::string> m3{};
+    m3.insert(std::string(50, 'y'));
+    m3 = m1;
+    EXPECT_EQ(value, *m3.get(h));
+    EXPECT_EQ(1, m3.size());
+
+    m1.erase(h);
+    EXPECT_EQ(value, *m2.get(h));
+    EXPECT_EQ(value, *m3.get(h));
+}
+
+namespace {
+    std::int64_t allocations_until_failure{ -1 };
+
+    struct Failing_allocator {
+        [[nodiscard]] oc::Expected<memoc::Block<void>, memoc::Allocator_error> allocate(memoc::Block<void>::Size_type s) noexcept
+        {
+            if (allocations_until_failure == 0) {
+                return oc::Unexpected(memoc::Allocator_error::out_of_memory);
+            }
+            if (allocations_until_failure > 0) {
+                --allocations_until_failure;
+            }
+            return memoc::Malloc_allocator{}.allocate(s);
+        }
+
+        void deallocate(memoc::Block<void>& b) noexcept
+        {
+            memoc::Malloc_allocator{}.deallocate(b);
+        }
+
+        [[nodiscard]] bool owns(const memoc::Block<void>& b) const noexcept
+        {
+            return memoc::Malloc_allocator{}.owns(b);
+        }
+    };
+}
+
+TEST(Slot_map_test, is_unchanged_if_growing_fails)
+{
+    using namespace memoc;
+
+    Slot_map<int, Failing_allocator> m{};
+    std::vector<Slot_map<int, Failing_allocator>::Handle> handles{};
+    for (int i = 0; i < 8; ++i) {
+        handles.push_back(m.insert(i));
+    }
+    const std::int64_t capacity = m.capacity();
+    ASSERT_EQ(8, capacity);
+
+    // The last of the grown buffers fails to allocate
+    allocations_until_failure = 2;
+    EXPECT_ANY_THROW(m.insert(8));
+    allocations_until_failure = -1;
+    EXPECT_EQ(capacity, m.capacity());
+    EXPECT_EQ(8, m.size());
+
+    handles.push_back(m.insert(8));
+    for (int i = 0; i < 9; ++i) {
+        EXPECT_EQ(i, *m.get(handles[i]));
+    }
+}